@@ -0,0 +1,564 @@
+/**
+ * @file
+ * @brief Benchmark crond.
+ * @author James Humphrey (humphreyj@somnisoft.com)
+ *
+ * Each result gets printed to STDOUT as a line with four tab-separated
+ * fields: the benchmark name, the number of crontab lines or jobs, the
+ * measured value, and its unit. Lines starting with # are comments.
+ *
+ * crond runs in a child process with its HOME set to a temporary
+ * directory, replaying the jobs on the virtual clock started by -w. The
+ * dry run mode started by -n measures the scheduler without starting the
+ * jobs. The jobs that do run have their output mailed through a mailx
+ * script in the same directory that discards the mail. Before it exits,
+ * the script records the peak memory and CPU time of its parent, the job
+ * monitor that captured the output.
+ *
+ * This software has been placed into the public domain using CC0.
+ */
+
+#include <sys/resource.h>
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/crond.h"
+#include "../test/test.h"
+
+/**
+ * Parse the crontab lines at least this many times in total.
+ */
+#define BENCH_PARSE_MIN_LINES 1000000
+
+/**
+ * First minute replayed by crond.
+ */
+#define BENCH_START "2024-01-01T00:00"
+
+/**
+ * Number of jobs started in each minute by the spawn and output
+ * benchmarks.
+ */
+#define BENCH_JOBS 50
+
+/**
+ * Number of minutes replayed by the spawn and output benchmarks.
+ */
+#define BENCH_MINUTES 10
+
+/**
+ * Temporary directory used as HOME by crond.
+ */
+static char g_bench_dir[] = "/tmp/cron-bench-XXXXXX";
+
+/**
+ * Crontab file read by crond.
+ */
+static char g_bench_crontab[sizeof(g_bench_dir) + sizeof("/.config/.crontab")];
+
+/**
+ * File with a line for each job monitor written by the mailx script.
+ */
+static char g_bench_jobmon[sizeof(g_bench_dir) + sizeof("/jobmon.txt")];
+
+/**
+ * Peak memory of crond in KiB with an empty crontab.
+ */
+static unsigned long g_bench_rss_base_kib;
+
+/**
+ * Resources used by a crond process.
+ */
+struct bench_usage{
+  /**
+   * Wall time in microseconds.
+   */
+  unsigned long wall_usec;
+
+  /**
+   * Maximum resident set size in KiB.
+   */
+  unsigned long maxrss_kib;
+};
+
+/**
+ * Get the number of microseconds since a time.
+ *
+ * @param[in] start CLOCK_MONOTONIC time.
+ * @return          Microseconds elapsed since @p start.
+ */
+static unsigned long
+bench_usec_since(const struct timespec *const start){
+  struct timespec now;
+
+  assert(clock_gettime(CLOCK_MONOTONIC, &now) == 0);
+  return (unsigned long)(now.tv_sec - start->tv_sec) * 1000000UL +
+         (unsigned long)(now.tv_nsec / 1000) -
+         (unsigned long)(start->tv_nsec / 1000);
+}
+
+/**
+ * Print a result line.
+ *
+ * @param[in] name  Benchmark name.
+ * @param[in] lines Number of crontab lines or jobs.
+ * @param[in] value Measured value.
+ * @param[in] unit  Unit of @p value.
+ */
+static void
+bench_print(const char *const name,
+            const size_t lines,
+            const unsigned long value,
+            const char *const unit){
+  assert(printf("%s\t%lu\t%lu\t%s\n",
+                name,
+                (unsigned long)lines,
+                value,
+                unit) > 0);
+  assert(fflush(stdout) == 0);
+}
+
+/**
+ * Read the lines of a crontab file.
+ *
+ * @param[in]  path      Crontab file.
+ * @param[out] num_lines Number of lines read.
+ * @return               Lines without the newline characters. Free each
+ *                       line and the list when finished.
+ */
+static char **
+bench_lines_load(const char *const path,
+                 size_t *const num_lines){
+  FILE *fp;
+  char **lines;
+  char *line;
+  size_t len;
+  ssize_t read;
+  size_t max_lines;
+
+  fp = fopen(path, "r");
+  assert(fp);
+  lines = NULL;
+  max_lines = 0;
+  *num_lines = 0;
+  line = NULL;
+  len = 0;
+  while((read = getline(&line, &len, fp)) != -1){
+    if(read && line[read - 1] == '\n'){
+      line[read - 1] = '\0';
+    }
+    if(*num_lines == max_lines){
+      max_lines = max_lines ? max_lines * 2 : 1024;
+      lines = realloc(lines, max_lines * sizeof(*lines));
+      assert(lines);
+    }
+    lines[*num_lines] = line;
+    *num_lines += 1;
+    line = NULL;
+    len = 0;
+  }
+  free(line);
+  assert(ferror(fp) == 0);
+  assert(fclose(fp) == 0);
+  return lines;
+}
+
+/**
+ * Write the crontab file read by crond.
+ *
+ * @param[in] lines     Crontab lines.
+ * @param[in] num_lines Number of lines in @p lines.
+ */
+static void
+bench_crontab_write(char *const *const lines,
+                    const size_t num_lines){
+  FILE *fp;
+  size_t i;
+
+  fp = fopen(g_bench_crontab, "w");
+  assert(fp);
+  for(i = 0; i < num_lines; i++){
+    assert(fprintf(fp, "%s\n", lines[i]) >= 0);
+  }
+  assert(fclose(fp) == 0);
+}
+
+/**
+ * Write a crontab file with the same job repeated.
+ *
+ * @param[in] command Command run every minute.
+ * @param[in] count   Number of jobs.
+ */
+static void
+bench_crontab_repeat(const char *const command,
+                     const size_t count){
+  FILE *fp;
+  size_t i;
+
+  fp = fopen(g_bench_crontab, "w");
+  assert(fp);
+  for(i = 0; i < count; i++){
+    assert(fprintf(fp, "* * * * * %s\n", command) >= 0);
+  }
+  assert(fclose(fp) == 0);
+}
+
+/**
+ * Run crond in a child process on the virtual clock.
+ *
+ * @param[in]  end     Last minute replayed, see @ref BENCH_START.
+ * @param[in]  dry_run Set to true to record the jobs instead of running
+ *                     them.
+ * @param[out] usage   Resources used by crond.
+ */
+static void
+bench_crond(const char *const end,
+            const bool dry_run,
+            struct bench_usage *const usage){
+  char range[64];
+  char *argv[6];
+  struct timespec start;
+  struct rusage rusage;
+  pid_t pid;
+  int status;
+  int argc;
+
+  assert(snprintf(range, sizeof(range), "%s,%s", BENCH_START, end) > 0);
+  assert(clock_gettime(CLOCK_MONOTONIC, &start) == 0);
+  pid = fork();
+  assert(pid >= 0);
+  if(pid == 0){
+    argc = 0;
+    argv[argc++] = strdup("crond");
+    if(dry_run){
+      argv[argc++] = strdup("-n");
+      argv[argc++] = strdup("/dev/null");
+    }
+    argv[argc++] = strdup("-w");
+    argv[argc++] = strdup(range);
+    argv[argc] = NULL;
+    if(freopen("/dev/null", "w", stderr) == NULL){
+      exit(EXIT_FAILURE);
+    }
+    exit(crond_main(argc, argv));
+  }
+  assert(wait4(pid, &status, 0, &rusage) == pid);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  usage->wall_usec = bench_usec_since(&start);
+  usage->maxrss_kib = (unsigned long)rusage.ru_maxrss;
+}
+
+/**
+ * Measure @ref crond_crontab_parse_line.
+ *
+ * @param[in] lines     Crontab lines.
+ * @param[in] num_lines Number of lines in @p lines.
+ */
+static void
+bench_parse_line(char *const *const lines,
+                 const size_t num_lines){
+  struct crond crond;
+  struct timespec start;
+  size_t rounds;
+  size_t round;
+  size_t i;
+
+  rounds = BENCH_PARSE_MIN_LINES / num_lines + 1;
+  assert(clock_gettime(CLOCK_MONOTONIC, &start) == 0);
+  for(round = 0; round < rounds; round++){
+    memset(&crond, 0, sizeof(crond));
+    for(i = 0; i < num_lines; i++){
+      crond_crontab_parse_line(&crond, lines[i], 0, 0);
+    }
+    crond_job_list_free(&crond, true, SIZE_MAX);
+  }
+  bench_print("parse_line",
+              num_lines,
+              bench_usec_since(&start) * 1000 / (rounds * num_lines),
+              "ns/line");
+}
+
+/**
+ * Measure the memory used by each job with @ref crond_mem_count.
+ *
+ * @param[in] lines     Crontab lines.
+ * @param[in] num_lines Number of lines in @p lines.
+ * @return              Number of jobs in @p lines.
+ */
+static size_t
+bench_mem(char *const *const lines,
+          const size_t num_lines){
+  struct crond crond;
+  struct crond_mem mem;
+  size_t num_jobs;
+  size_t i;
+
+  memset(&crond, 0, sizeof(crond));
+  for(i = 0; i < num_lines; i++){
+    crond_crontab_parse_line(&crond, lines[i], 0, 0);
+  }
+  crond_mem_count(&crond, &mem);
+  num_jobs = crond.num_jobs - crond.num_job_free;
+  crond_job_list_free(&crond, true, SIZE_MAX);
+  assert(num_jobs);
+  bench_print("mem_jobs", num_lines, mem.jobs / num_jobs, "B/job");
+  bench_print("mem_schedules", num_lines, mem.schedules / num_jobs, "B/job");
+  bench_print("mem_commands", num_lines, mem.commands / num_jobs, "B/job");
+  bench_print("mem_stdin", num_lines, mem.stdin_lines / num_jobs, "B/job");
+  return num_jobs;
+}
+
+/**
+ * Measure loading a crontab file and checking its jobs once a minute.
+ *
+ * The reload time includes starting crond and checking the jobs of the
+ * first minute. The tick time gets measured by replaying a whole day and
+ * subtracting the reload time. The peak memory of crond with an empty
+ * crontab gets subtracted from its peak memory to get the memory per 1000
+ * jobs.
+ *
+ * @param[in] lines     Crontab lines.
+ * @param[in] num_lines Number of lines in @p lines.
+ * @param[in] num_jobs  Number of jobs in @p lines.
+ */
+static void
+bench_schedule(char *const *const lines,
+               const size_t num_lines,
+               const size_t num_jobs){
+  struct bench_usage usage_reload;
+  struct bench_usage usage_day;
+  unsigned long tick_usec;
+
+  bench_crontab_write(lines, num_lines);
+  bench_crond(BENCH_START, true, &usage_reload);
+  bench_crond("2024-01-01T23:59", true, &usage_day);
+  tick_usec = 0;
+  if(usage_day.wall_usec > usage_reload.wall_usec){
+    tick_usec = (usage_day.wall_usec - usage_reload.wall_usec) / (24 * 60 - 1);
+  }
+  bench_print("reload", num_lines, usage_reload.wall_usec, "us");
+  bench_print("tick", num_lines, tick_usec, "us/tick");
+  bench_print("maxrss", num_lines, usage_day.maxrss_kib, "KiB");
+  bench_print("rss_per_1k",
+              num_lines,
+              usage_day.maxrss_kib > g_bench_rss_base_kib ?
+              (usage_day.maxrss_kib - g_bench_rss_base_kib) * 1000 / num_jobs :
+              0,
+              "KiB/1k_jobs");
+}
+
+/**
+ * Measure the time taken to start jobs that exit right away.
+ */
+static void
+bench_spawn(void){
+  struct bench_usage usage;
+
+  bench_crontab_repeat("true", BENCH_JOBS);
+  bench_crond("2024-01-01T00:09", false, &usage);
+  bench_print("spawn",
+              BENCH_JOBS,
+              usage.wall_usec / (BENCH_JOBS * BENCH_MINUTES),
+              "us/job");
+}
+
+/**
+ * Read the job monitor resources recorded by the mailx script.
+ *
+ * Each line contains the peak resident set size of a job monitor in KiB
+ * and its CPU time in clock ticks.
+ *
+ * @param[out] maxrss_kib Largest peak resident set size.
+ * @param[out] cpu_usec   Total CPU time in microseconds.
+ * @return                Number of job monitors read.
+ */
+static unsigned long
+bench_jobmon_load(unsigned long *const maxrss_kib,
+                  unsigned long *const cpu_usec){
+  FILE *fp;
+  unsigned long rss_kib;
+  unsigned long ticks;
+  unsigned long total_ticks;
+  unsigned long num_jobmon;
+
+  *maxrss_kib = 0;
+  total_ticks = 0;
+  num_jobmon = 0;
+  fp = fopen(g_bench_jobmon, "r");
+  if(fp){
+    while(fscanf(fp, "%lu %lu", &rss_kib, &ticks) == 2){
+      if(rss_kib > *maxrss_kib){
+        *maxrss_kib = rss_kib;
+      }
+      total_ticks += ticks;
+      num_jobmon += 1;
+    }
+    assert(ferror(fp) == 0);
+    assert(fclose(fp) == 0);
+    assert(remove(g_bench_jobmon) == 0);
+  }
+  *cpu_usec = total_ticks * 1000000UL / (unsigned long)sysconf(_SC_CLK_TCK);
+  return num_jobmon;
+}
+
+/**
+ * Measure the throughput of capturing job output and mailing it.
+ *
+ * Also prints the largest peak memory of the job monitors and their
+ * average CPU time, which should not grow with the size of the output.
+ * Jobs without output do not start mailx, so only their time per job gets
+ * printed.
+ *
+ * @param[in] name    Benchmark name.
+ * @param[in] bytes   Number of bytes printed by each job.
+ * @param[in] jobs    Number of jobs started each minute.
+ * @param[in] minutes Number of minutes replayed.
+ */
+static void
+bench_output(const char *const name,
+             const unsigned long bytes,
+             const unsigned long jobs,
+             const unsigned long minutes){
+  char command[64];
+  char end[sizeof(BENCH_START)];
+  char result[64];
+  struct bench_usage usage;
+  unsigned long maxrss_kib;
+  unsigned long cpu_usec;
+  unsigned long num_jobmon;
+
+  assert(snprintf(command,
+                  sizeof(command),
+                  "head -c %lu /dev/zero",
+                  bytes) > 0);
+  assert(snprintf(end, sizeof(end), "2024-01-01T00:%02lu", minutes - 1) > 0);
+  bench_crontab_repeat(command, jobs);
+  bench_crond(end, false, &usage);
+  num_jobmon = bench_jobmon_load(&maxrss_kib, &cpu_usec);
+  if(bytes){
+    bench_print(name,
+                jobs,
+                bytes / 1024 * jobs * minutes * 1000 /
+                (usage.wall_usec / 1000 + 1),
+                "KiB/s");
+    assert(num_jobmon == jobs * minutes);
+    assert(snprintf(result, sizeof(result), "%s_jobmon_rss", name) > 0);
+    bench_print(result, jobs, maxrss_kib, "KiB");
+    assert(snprintf(result, sizeof(result), "%s_jobmon_cpu", name) > 0);
+    bench_print(result, jobs, cpu_usec / num_jobmon, "us/job");
+  }
+  else{
+    bench_print(name, jobs, usage.wall_usec / (jobs * minutes), "us/job");
+  }
+}
+
+/**
+ * Create the temporary HOME directory and the mailx script.
+ */
+static void
+bench_setup(void){
+  char path[sizeof(g_bench_dir) + sizeof("/.config")];
+  char *env_path;
+  char *new_path;
+  FILE *fp;
+
+  assert(mkdtemp(g_bench_dir));
+  assert(setenv("HOME", g_bench_dir, 1) == 0);
+  assert(setenv("TZ", "UTC", 1) == 0);
+  assert(snprintf(path, sizeof(path), "%s/.config", g_bench_dir) > 0);
+  assert(mkdir(path, S_IRWXU) == 0);
+  assert(snprintf(g_bench_crontab,
+                  sizeof(g_bench_crontab),
+                  "%s/.config/.crontab",
+                  g_bench_dir) > 0);
+
+  assert(snprintf(path, sizeof(path), "%s/mailx", g_bench_dir) > 0);
+  fp = fopen(path, "w");
+  assert(fp);
+  assert(snprintf(g_bench_jobmon,
+                  sizeof(g_bench_jobmon),
+                  "%s/jobmon.txt",
+                  g_bench_dir) > 0);
+  /* Fields 14 and 15 of the stat file contain the user and system time. */
+  assert(fprintf(fp,
+                 "#!/bin/sh\n"
+                 "cat > /dev/null\n"
+                 "set -- $(sed 's/.*) //' /proc/$PPID/stat)\n"
+                 "rss=$(sed -n 's/^VmHWM:[^0-9]*\\([0-9]*\\).*/\\1/p'"
+                 " /proc/$PPID/status)\n"
+                 "echo \"$rss $((${12} + ${13}))\" >> %s\n",
+                 g_bench_jobmon) > 0);
+  assert(fclose(fp) == 0);
+  assert(chmod(path, S_IRWXU) == 0);
+
+  env_path = getenv("PATH");
+  assert(env_path);
+  new_path = malloc(strlen(g_bench_dir) + strlen(env_path) + 2);
+  assert(new_path);
+  assert(sprintf(new_path, "%s:%s", g_bench_dir, env_path) > 0);
+  assert(setenv("PATH", new_path, 1) == 0);
+  free(new_path);
+}
+
+/**
+ * Remove the temporary HOME directory.
+ */
+static void
+bench_cleanup(void){
+  char command[sizeof(g_bench_dir) + sizeof("rm -rf ")];
+
+  assert(snprintf(command, sizeof(command), "rm -rf %s", g_bench_dir) > 0);
+  assert(system(command) == 0);
+}
+
+/**
+ * Run the benchmarks.
+ *
+ * Usage: bench FILE...
+ *
+ * The parse, reload, and tick benchmarks run for each crontab FILE, like
+ * the ones printed by crontab-gen. The spawn and output benchmarks run
+ * once, using crontabs that start @ref BENCH_JOBS jobs every minute. The
+ * output benchmarks with 1 MiB and 1 GiB jobs replay fewer jobs.
+ *
+ * @param[in] argc Number of arguments in @p argv.
+ * @param[in] argv Command line arguments.
+ * @retval    0    All benchmarks ran.
+ */
+int
+main(int argc,
+     char *argv[]){
+  char **lines;
+  size_t num_lines;
+  size_t num_jobs;
+  size_t i;
+  int argi;
+  struct bench_usage usage;
+
+  assert(argc > 1);
+  bench_setup();
+  bench_crontab_write(NULL, 0);
+  bench_crond(BENCH_START, true, &usage);
+  g_bench_rss_base_kib = usage.maxrss_kib;
+  assert(printf("# benchmark\tlines\tvalue\tunit\n") > 0);
+  for(argi = 1; argi < argc; argi++){
+    lines = bench_lines_load(argv[argi], &num_lines);
+    assert(num_lines);
+    bench_parse_line(lines, num_lines);
+    num_jobs = bench_mem(lines, num_lines);
+    bench_schedule(lines, num_lines, num_jobs);
+    for(i = 0; i < num_lines; i++){
+      free(lines[i]);
+    }
+    free(lines);
+  }
+  bench_spawn();
+  bench_output("output_0", 0, BENCH_JOBS, BENCH_MINUTES);
+  bench_output("output_1k", 1024UL, BENCH_JOBS, BENCH_MINUTES);
+  bench_output("output_1m", 1024UL * 1024, BENCH_JOBS, 1);
+  bench_output("output_1g", 1024UL * 1024 * 1024, 1, 1);
+  bench_cleanup();
+  return 0;
+}
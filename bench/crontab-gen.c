@@ -0,0 +1,222 @@
+/**
+ * @file
+ * @brief Generate synthetic crontab files for benchmarks.
+ * @author James Humphrey (humphreyj@somnisoft.com)
+ *
+ * The jobs mix the schedules and commands found in real crontab files:
+ * single times, lists, ranges, every minute, the @@ special schedules, long
+ * commands, and commands that pass lines through STDIN with %. Comments
+ * and blank lines appear between the jobs. The commands only run true, so
+ * the crontab can get loaded by crond without side effects.
+ *
+ * This software has been placed into the public domain using CC0.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * The @@ special schedules.
+ */
+static const char *const
+g_gen_special[] = {
+  "@hourly",
+  "@daily",
+  "@midnight",
+  "@weekly",
+  "@monthly",
+  "@yearly"
+};
+
+/**
+ * Pseudo-random number generator state.
+ */
+static unsigned long g_gen_state;
+
+/**
+ * Get the next pseudo-random number.
+ *
+ * A fixed linear congruential generator gives the same crontab for the
+ * same seed on every platform.
+ *
+ * @param[in] max Upper bound, exclusive.
+ * @return        Number in the range [0, @p max).
+ */
+static unsigned long
+gen_rand(const unsigned long max){
+  g_gen_state = (g_gen_state * 1103515245UL + 12345UL) & 0x7fffffffUL;
+  return (g_gen_state >> 8) % max;
+}
+
+/**
+ * Print a list of evenly spaced values like 0,15,30,45.
+ *
+ * @param[in] min Lower bound of the values.
+ * @param[in] max Upper bound of the values, exclusive.
+ */
+static void
+gen_list(const unsigned long min,
+         const unsigned long max){
+  unsigned long value;
+  unsigned long count;
+  unsigned long i;
+
+  count = 2 + gen_rand(3);
+  value = min + gen_rand((max - min) / count);
+  for(i = 0; i < count; i++){
+    printf("%s%lu", i ? "," : "", value);
+    value += (max - min) / count;
+  }
+}
+
+/**
+ * Print a range of values like 9-17.
+ *
+ * @param[in] min Lower bound of the values.
+ * @param[in] max Upper bound of the values, exclusive.
+ */
+static void
+gen_range(const unsigned long min,
+          const unsigned long max){
+  unsigned long first;
+
+  first = min + gen_rand(max - min - 1);
+  printf("%lu-%lu", first, first + 1 + gen_rand(max - first - 1));
+}
+
+/**
+ * Print the schedule of a job.
+ *
+ * @param[in] kind Number in the range [0, 100) that picks the kind of
+ *                 schedule.
+ */
+static void
+gen_schedule(const unsigned long kind){
+  if(kind < 40){
+    printf("%lu %lu * * *", gen_rand(60), gen_rand(24));
+  }
+  else if(kind < 55){
+    gen_list(0, 60);
+    fputs(" * * * *", stdout);
+  }
+  else if(kind < 70){
+    printf("%lu ", gen_rand(60));
+    gen_range(0, 24);
+    fputs(" * * ", stdout);
+    gen_range(0, 7);
+  }
+  else if(kind < 80){
+    printf("%lu %lu ", gen_rand(60), gen_rand(24));
+    gen_list(1, 29);
+    fputs(" ", stdout);
+    gen_range(1, 13);
+    fputs(" *", stdout);
+  }
+  else if(kind < 85){
+    fputs("* * * * *", stdout);
+  }
+  else{
+    fputs(g_gen_special[gen_rand(sizeof(g_gen_special) /
+                                 sizeof(g_gen_special[0]))],
+          stdout);
+  }
+}
+
+/**
+ * Print the command of a job.
+ *
+ * @param[in] job Job number.
+ */
+static void
+gen_command(const unsigned long job){
+  const unsigned long kind = gen_rand(100);
+
+  if(kind < 70){
+    printf("true job-%lu", job);
+  }
+  else if(kind < 90){
+    printf("true --input /var/lib/bench/job-%lu/input.csv"
+           " --output /var/lib/bench/job-%lu/output.csv"
+           " --log /var/log/bench/job-%lu.log"
+           " --retries 3 --timeout 300 --verbose",
+           job,
+           job,
+           job);
+  }
+  else{
+    printf("true job-%lu%%first line%%second line%%third line", job);
+  }
+}
+
+/**
+ * Generate a synthetic crontab file.
+ *
+ * Usage: crontab-gen [-s seed] count
+ *
+ * Print a crontab with @p count lines to STDOUT. About one line in twenty
+ * is a comment or a blank line, and the rest are jobs.
+ *
+ * @param[in] argc Number of arguments in @p argv.
+ * @param[in] argv Command line arguments.
+ * @retval    0    Printed the crontab.
+ * @retval    1    Invalid arguments or failed to write the crontab.
+ */
+int
+main(int argc,
+     char *argv[]){
+  unsigned long count;
+  unsigned long i;
+  unsigned long kind;
+  char *ep;
+  int c;
+  int rc;
+
+  rc = 0;
+  g_gen_state = 1;
+  while((c = getopt(argc, argv, "s:")) != -1){
+    if(c == 's'){
+      g_gen_state = strtoul(optarg, &ep, 10);
+      if(*ep){
+        rc = 1;
+      }
+    }
+    else{
+      rc = 1;
+    }
+  }
+  count = 0;
+  if(rc == 0 && optind + 1 == argc){
+    errno = 0;
+    count = strtoul(argv[optind], &ep, 10);
+    if(errno || *ep || *argv[optind] == '\0'){
+      rc = 1;
+    }
+  }
+  else{
+    rc = 1;
+  }
+  if(rc){
+    fputs("usage: crontab-gen [-s seed] count\n", stderr);
+  }
+  for(i = 0; i < count; i++){
+    kind = gen_rand(100);
+    if(kind < 3){
+      printf("# Synthetic job group %lu\n", i);
+    }
+    else if(kind < 5){
+      putchar('\n');
+    }
+    else{
+      gen_schedule(gen_rand(100));
+      putchar(' ');
+      gen_command(i);
+      putchar('\n');
+    }
+  }
+  if(fflush(stdout) != 0){
+    rc = 1;
+  }
+  return rc;
+}
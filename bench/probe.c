@@ -0,0 +1,57 @@
+/**
+ * @file
+ * @brief Record the time a job started.
+ * @author James Humphrey (humphreyj@somnisoft.com)
+ *
+ * This runs as the job command of the stress harness, so it does as little
+ * as possible before reading the clock.
+ *
+ * This software has been placed into the public domain using CC0.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Append the start time of this process to a log file.
+ *
+ * Usage: probe FILE
+ *
+ * The line contains the minute since the epoch and the number of
+ * microseconds since the start of that minute. A single write to a file
+ * opened in append mode keeps the lines of concurrent probes apart.
+ *
+ * @param[in] argc Number of arguments in @p argv.
+ * @param[in] argv Command line arguments.
+ * @retval    0    Recorded the start time.
+ * @retval    1    Failed to record the start time.
+ */
+int
+main(int argc,
+     char *argv[]){
+  struct timespec ts;
+  char line[64];
+  int len;
+  int fd;
+  int rc;
+
+  rc = 1;
+  if(argc == 2 && clock_gettime(CLOCK_REALTIME, &ts) == 0){
+    len = sprintf(line,
+                  "%ld %ld\n",
+                  (long)(ts.tv_sec / 60),
+                  (long)(ts.tv_sec % 60) * 1000000L + ts.tv_nsec / 1000);
+    fd = open(argv[1], O_WRONLY | O_APPEND | O_CREAT, 0600);
+    if(fd >= 0){
+      if(write(fd, line, (size_t)len) == len){
+        rc = 0;
+      }
+      if(close(fd) != 0){
+        rc = 1;
+      }
+    }
+  }
+  return rc;
+}
@@ -0,0 +1,325 @@
+/**
+ * @file
+ * @brief Measure how late crond starts a burst of jobs.
+ * @author James Humphrey (humphreyj@somnisoft.com)
+ *
+ * The harness installs a crontab where every job runs each minute, so all
+ * of them become due at the same time. Each job runs the probe program,
+ * which logs how long after the start of the minute it started. crond runs
+ * on the real clock for a few minutes in a child process with its HOME
+ * set to a temporary directory.
+ *
+ * The results get printed like the ones of bench/bench.c. The lateness
+ * only includes the probes of the minutes after crond started, since crond
+ * also runs the jobs of the minute it starts in right away. The number of
+ * processes counts every process created on the host while crond ran, so
+ * it includes the jobs of that first minute.
+ *
+ * This software has been placed into the public domain using CC0.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/crond.h"
+#include "../test/test.h"
+
+/**
+ * Number of seconds to wait for the jobs of the last minute to finish.
+ */
+#define STRESS_GRACE_SEC 10
+
+/**
+ * Maximum number of extra options passed to crond.
+ */
+#define STRESS_MAX_OPTIONS 16
+
+/**
+ * Temporary directory used as HOME by crond.
+ */
+static char g_stress_dir[] = "/tmp/cron-stress-XXXXXX";
+
+/**
+ * Log file written by the probes.
+ */
+static char g_stress_log[sizeof(g_stress_dir) + sizeof("/probe.log")];
+
+/**
+ * Print a result line in the format of bench/bench.c.
+ *
+ * @param[in] name  Benchmark name.
+ * @param[in] jobs  Number of jobs.
+ * @param[in] value Measured value.
+ * @param[in] unit  Unit of @p value.
+ */
+static void
+stress_print(const char *const name,
+             const unsigned long jobs,
+             const unsigned long value,
+             const char *const unit){
+  assert(printf("%s\t%lu\t%lu\t%s\n", name, jobs, value, unit) > 0);
+}
+
+/**
+ * Get the number of processes created on the host since it booted.
+ *
+ * @return Value of the processes line in /proc/stat.
+ */
+static unsigned long
+stress_num_forks(void){
+  FILE *fp;
+  char line[256];
+  unsigned long forks;
+
+  forks = 0;
+  fp = fopen("/proc/stat", "r");
+  assert(fp);
+  while(fgets(line, sizeof(line), fp)){
+    if(sscanf(line, "processes %lu", &forks) == 1){
+      break;
+    }
+  }
+  assert(fclose(fp) == 0);
+  return forks;
+}
+
+/**
+ * Get the CPU time used by a process, without its child processes.
+ *
+ * @param[in] pid Process ID.
+ * @return        User and system CPU time in milliseconds.
+ */
+static unsigned long
+stress_cpu_msec(const pid_t pid){
+  char path[64];
+  char buf[1024];
+  FILE *fp;
+  size_t len;
+  const char *fields;
+  unsigned long utime;
+  unsigned long stime;
+
+  assert(snprintf(path, sizeof(path), "/proc/%ld/stat", (long)pid) > 0);
+  fp = fopen(path, "r");
+  assert(fp);
+  len = fread(buf, 1, sizeof(buf) - 1, fp);
+  assert(fclose(fp) == 0);
+  buf[len] = '\0';
+  /* The command name can contain spaces and parentheses. */
+  fields = strrchr(buf, ')');
+  assert(fields);
+  assert(sscanf(fields + 1,
+                " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                &utime,
+                &stime) == 2);
+  return (utime + stime) * 1000 / (unsigned long)sysconf(_SC_CLK_TCK);
+}
+
+/**
+ * Compare two lateness values for qsort.
+ *
+ * @param[in] a First value.
+ * @param[in] b Second value.
+ * @retval    <0 @p a is smaller.
+ * @retval    0  The values are equal.
+ * @retval    >0 @p a is larger.
+ */
+static int
+stress_compare(const void *const a,
+               const void *const b){
+  const unsigned long ua = *(const unsigned long *)a;
+  const unsigned long ub = *(const unsigned long *)b;
+
+  return (ua > ub) - (ua < ub);
+}
+
+/**
+ * Read the lateness of the probes that started in a range of minutes.
+ *
+ * @param[in]  first    First minute since the epoch.
+ * @param[in]  last     Last minute since the epoch.
+ * @param[out] num_runs Number of values read.
+ * @return              Sorted lateness values in microseconds. Free this
+ *                      when finished.
+ */
+static unsigned long *
+stress_log_load(const long first,
+                const long last,
+                size_t *const num_runs){
+  FILE *fp;
+  unsigned long *list;
+  size_t max_runs;
+  long minute;
+  unsigned long usec;
+
+  list = NULL;
+  max_runs = 0;
+  *num_runs = 0;
+  fp = fopen(g_stress_log, "r");
+  assert(fp);
+  while(fscanf(fp, "%ld %lu", &minute, &usec) == 2){
+    if(minute >= first && minute <= last){
+      if(*num_runs == max_runs){
+        max_runs = max_runs ? max_runs * 2 : 1024;
+        list = realloc(list, max_runs * sizeof(*list));
+        assert(list);
+      }
+      list[*num_runs] = usec;
+      *num_runs += 1;
+    }
+  }
+  assert(ferror(fp) == 0);
+  assert(fclose(fp) == 0);
+  if(*num_runs){
+    qsort(list, *num_runs, sizeof(*list), stress_compare);
+  }
+  return list;
+}
+
+/**
+ * Create the temporary HOME directory and the crontab.
+ *
+ * @param[in] probe Path to the probe program.
+ * @param[in] jobs  Number of jobs in the crontab.
+ */
+static void
+stress_setup(const char *const probe,
+             const unsigned long jobs){
+  char path[sizeof(g_stress_dir) + sizeof("/.config/.crontab")];
+  FILE *fp;
+  unsigned long i;
+
+  assert(mkdtemp(g_stress_dir));
+  assert(setenv("HOME", g_stress_dir, 1) == 0);
+  assert(snprintf(path, sizeof(path), "%s/.config", g_stress_dir) > 0);
+  assert(mkdir(path, S_IRWXU) == 0);
+  assert(snprintf(g_stress_log,
+                  sizeof(g_stress_log),
+                  "%s/probe.log",
+                  g_stress_dir) > 0);
+  assert(snprintf(path, sizeof(path), "%s/.config/.crontab", g_stress_dir) > 0);
+  fp = fopen(path, "w");
+  assert(fp);
+  for(i = 0; i < jobs; i++){
+    assert(fprintf(fp, "* * * * * %s %s\n", probe, g_stress_log) > 0);
+  }
+  assert(fclose(fp) == 0);
+}
+
+/**
+ * Remove the temporary HOME directory.
+ */
+static void
+stress_cleanup(void){
+  char command[sizeof(g_stress_dir) + sizeof("rm -rf ")];
+
+  assert(snprintf(command, sizeof(command), "rm -rf %s", g_stress_dir) > 0);
+  assert(system(command) == 0);
+}
+
+/**
+ * Run a burst of jobs every minute and report how late they started.
+ *
+ * Usage: stress [-j jobs] [-m minutes] probe [crond_option...]
+ *
+ *   - -j: Number of jobs started every minute. Defaults to 100.
+ *   - -m: Number of minutes to measure. Defaults to 3.
+ *
+ * The probe argument is the absolute path of the probe program. The
+ * remaining options get passed to crond, so that different settings like
+ * -u can get compared.
+ *
+ * @param[in] argc Number of arguments in @p argv.
+ * @param[in] argv Command line arguments.
+ * @retval    0    Measured the jobs.
+ * @retval    1    Invalid arguments.
+ */
+int
+main(int argc,
+     char *argv[]){
+  char *crond_argv[STRESS_MAX_OPTIONS + 2];
+  unsigned long jobs;
+  unsigned long minutes;
+  unsigned long forks;
+  unsigned long cpu_msec;
+  unsigned long *lateness;
+  size_t num_runs;
+  long first;
+  time_t end;
+  pid_t pid;
+  int status;
+  int crond_argc;
+  int c;
+  int rc;
+
+  rc = 0;
+  jobs = 100;
+  minutes = 3;
+  while((c = getopt(argc, argv, "+j:m:")) != -1){
+    if(c == 'j'){
+      jobs = strtoul(optarg, NULL, 10);
+    }
+    else if(c == 'm'){
+      minutes = strtoul(optarg, NULL, 10);
+    }
+    else{
+      rc = 1;
+    }
+  }
+  if(rc || optind >= argc || *argv[optind] != '/' || jobs == 0 ||
+     minutes == 0 || argc - optind - 1 > STRESS_MAX_OPTIONS){
+    fputs("usage: stress [-j jobs] [-m minutes] probe [crond_option...]\n",
+          stderr);
+    rc = 1;
+  }
+  else{
+    stress_setup(argv[optind], jobs);
+    crond_argc = 0;
+    crond_argv[crond_argc++] = strdup("crond");
+    for(c = optind + 1; c < argc; c++){
+      crond_argv[crond_argc++] = argv[c];
+    }
+    crond_argv[crond_argc] = NULL;
+    optind = 0;
+
+    first = (long)(time(NULL) / 60) + 1;
+    end = (time_t)(first + (long)minutes) * 60 + STRESS_GRACE_SEC;
+    forks = stress_num_forks();
+    pid = fork();
+    assert(pid >= 0);
+    if(pid == 0){
+      if(freopen("/dev/null", "w", stderr) == NULL){
+        exit(EXIT_FAILURE);
+      }
+      exit(crond_main(crond_argc, crond_argv));
+    }
+    while(time(NULL) < end){
+      sleep(1);
+    }
+    cpu_msec = stress_cpu_msec(pid);
+    assert(kill(pid, SIGTERM) == 0);
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    forks = stress_num_forks() - forks;
+
+    lateness = stress_log_load(first,
+                               first + (long)minutes - 1,
+                               &num_runs);
+    assert(num_runs);
+    assert(printf("# benchmark\tjobs\tvalue\tunit\n") > 0);
+    stress_print("burst_runs", jobs, (unsigned long)num_runs, "runs");
+    stress_print("burst_p50", jobs, lateness[num_runs / 2], "us");
+    stress_print("burst_p99",
+                 jobs,
+                 lateness[(num_runs - 1) * 99 / 100],
+                 "us");
+    stress_print("burst_max", jobs, lateness[num_runs - 1], "us");
+    stress_print("burst_processes", jobs, forks, "processes");
+    stress_print("burst_crond_cpu", jobs, cpu_msec, "ms");
+    free(lateness);
+    free(crond_argv[0]);
+    stress_cleanup();
+  }
+  return rc;
+}
@@ -78,31 +78,67 @@ cron_get_path_home(void){
 }
 
 char *
-cron_get_path_crontab(void){
+cron_get_path_crontab_home(const char *const path_home){
   const char *const PATH_CRONTAB = "/.config/.crontab";
-  char *path_home;
   size_t path_home_len;
   size_t path_crontab_rel_len;
   size_t alloc_len;
   char *path_crontab;
   char *path_copy;
 
+  path_crontab = NULL;
+  path_home_len = strlen(path_home);
+  path_crontab_rel_len = strlen(PATH_CRONTAB);
+  if(si_add_size_t(path_home_len,
+                   path_crontab_rel_len + 1,
+                   &alloc_len) == 0){
+    path_crontab = malloc(alloc_len);
+    if(path_crontab){
+      path_copy = stpcpy(path_crontab, path_home);
+      stpcpy(path_copy, PATH_CRONTAB);
+    }
+  }
+  return path_crontab;
+}
+
+char *
+cron_get_path_crontab(void){
+  char *path_home;
+  char *path_crontab;
+
   path_crontab = NULL;
   path_home = cron_get_path_home();
   if(path_home){
-    path_home_len = strlen(path_home);
-    path_crontab_rel_len = strlen(PATH_CRONTAB);
-    if(si_add_size_t(path_home_len,
-                     path_crontab_rel_len + 1,
-                     &alloc_len) == 0){
-      path_crontab = malloc(alloc_len);
-      if(path_crontab){
-        path_copy = stpcpy(path_crontab, path_home);
-        stpcpy(path_copy, PATH_CRONTAB);
-      }
-    }
+    path_crontab = cron_get_path_crontab_home(path_home);
     free(path_home);
   }
   return path_crontab;
 }
 
+/**
+ * Get the address of the crond control socket.
+ *
+ * @param[in]  path_crontab Path to crontab file.
+ * @param[out] addr         Store the socket address here.
+ * @retval     0            Successfully set @p addr.
+ * @retval     -1           The socket path does not fit in @p addr.
+ */
+int
+cron_get_control_addr(const char *const path_crontab,
+                      struct sockaddr_un *const addr){
+  int rc;
+  char *path_copy;
+
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if(strlen(path_crontab) + sizeof(CRON_CONTROL_SUFFIX) >
+     sizeof(addr->sun_path)){
+    rc = -1;
+  }
+  else{
+    path_copy = stpcpy(addr->sun_path, path_crontab);
+    stpcpy(path_copy, CRON_CONTROL_SUFFIX);
+    rc = 0;
+  }
+  return rc;
+}
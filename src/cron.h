@@ -10,8 +10,10 @@
 #ifndef CRON_COMMON_H
 #define CRON_COMMON_H
 
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 #include <errno.h>
 #include <stdarg.h>
@@ -49,6 +51,17 @@
  */
 #define CRON_READ_BUFFER_SZ 1000
 
+/**
+ * Append this to the crontab path to get the crond control socket path.
+ */
+#define CRON_CONTROL_SUFFIX ".sock"
+
+/**
+ * Maximum length of a request sent to the crond control socket, including
+ * the newline character.
+ */
+#define CRON_CONTROL_REQUEST_SZ 1024
+
 /**
  * Add two size_t values and check for wrap.
  *
@@ -90,6 +103,17 @@ si_mul_size_t(const size_t a,
 char *
 cron_get_path_home(void);
 
+/**
+ * Get path to the crontab file in a home directory.
+ *
+ * @param[in] path_home Home directory path.
+ * @retval    char*     Path to crontab file. The caller must free this when
+ *                      finished.
+ * @retval    NULL      Memory allocation failed.
+ */
+char *
+cron_get_path_crontab_home(const char *const path_home);
+
 /**
  * Get path to the crontab file of the current user.
  *
@@ -99,5 +123,20 @@ cron_get_path_home(void);
 char *
 cron_get_path_crontab(void);
 
+/**
+ * Get the address of the crond control socket.
+ *
+ * The control socket gets created next to the crontab file, using the
+ * crontab path with @ref CRON_CONTROL_SUFFIX appended.
+ *
+ * @param[in]  path_crontab Path to crontab file.
+ * @param[out] addr         Store the socket address here.
+ * @retval     0            Successfully set @p addr.
+ * @retval     -1           The socket path does not fit in @p addr.
+ */
+int
+cron_get_control_addr(const char *const path_crontab,
+                      struct sockaddr_un *const addr);
+
 #endif /* CRON_COMMON_H */
 
@@ -0,0 +1,693 @@
+/**
+ * @file
+ * @brief C++ interface to the cron expression library.
+ * @author James Humphrey (humphreyj@somnisoft.com)
+ *
+ * Header-only C++20 wrapper around @ref cron_expr. The parser and the
+ * search run in constant expressions and produce the same bitmasks as
+ * @ref cron_expr_compile, so expressions written as string literals get
+ * checked when the program compiles:
+ *
+ * @verbatim
+   using namespace cron::literals;
+
+   constexpr cron::expr nightly = "30 2 * * *"_cron;
+   constexpr cron::expr broken = "60 * * * *"_cron; // Does not compile.
+
+   for(std::chrono::sys_seconds t : nightly.after(now)){
+     ...
+   }
+ * @endverbatim
+ *
+ * All times are std::chrono::sys_seconds, so the wall times of the
+ * schedule are in UTC. Expressions only known at run time get compiled
+ * with @ref cron::expr::parse.
+ *
+ * This software has been placed into the public domain using CC0.
+ */
+#ifndef CRON_HPP
+#define CRON_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <string_view>
+
+#include "cron_expr.h"
+
+/**
+ * C++ interface to the cron expression library.
+ */
+namespace cron{
+
+/**
+ * Implementation details of @ref cron::expr.
+ */
+namespace detail{
+
+/**
+ * Called when a consteval expression fails to compile.
+ *
+ * This function is not constexpr, so calling it during constant
+ * evaluation turns an invalid expression into a compiler error.
+ */
+inline void
+invalid_cron_expression() noexcept{
+}
+
+/**
+ * Get a character of an expression, or '\0' past the end like the C
+ * library sees it.
+ *
+ * @param[in] str Cron expression.
+ * @param[in] i   Index into @p str.
+ * @return        Character at @p i, or '\0'.
+ */
+constexpr char
+at(const std::string_view str,
+   const std::size_t i) noexcept{
+  return i < str.size() ? str[i] : '\0';
+}
+
+/**
+ * Check if a bit is set in a field of @ref cron_expr.
+ *
+ * @param[in] field Field in @ref cron_expr.
+ * @param[in] i     Bit index.
+ * @return          True if the bit is set.
+ */
+constexpr bool
+bit_get(const unsigned char *const field,
+        const std::size_t i) noexcept{
+  return ((field[i / 8] >> (i % 8)) & 1) != 0;
+}
+
+/**
+ * Set a range of bits in a field of @ref cron_expr.
+ *
+ * @param[in,out] field Field in @ref cron_expr.
+ * @param[in]     start First bit index.
+ * @param[in]     end   Last bit index, inclusive.
+ */
+constexpr void
+bit_set_range(unsigned char *const field,
+              const std::size_t start,
+              const std::size_t end) noexcept{
+  for(std::size_t i = start; i <= end; i++){
+    field[i / 8] = static_cast<unsigned char>(field[i / 8] | (1 << (i % 8)));
+  }
+}
+
+/**
+ * Skip blank characters.
+ *
+ * @param[in]     str Cron expression.
+ * @param[in,out] i   Index into @p str, updated to point after the blanks.
+ * @return            Number of blank characters skipped.
+ */
+constexpr std::size_t
+parse_blank(const std::string_view str,
+            std::size_t &i) noexcept{
+  std::size_t num_blanks = 0;
+
+  while(at(str, i) == ' ' || at(str, i) == '\t'){
+    i += 1;
+    num_blanks += 1;
+  }
+  return num_blanks;
+}
+
+/**
+ * Parse a number of one or two digits.
+ *
+ * @param[in]     str Cron expression.
+ * @param[in,out] i   Index into @p str, updated to point after the digits.
+ * @param[out]    n   Parsed number.
+ * @return            True if @p str contains at least one digit at @p i.
+ */
+constexpr bool
+parse_number(const std::string_view str,
+             std::size_t &i,
+             std::size_t &n) noexcept{
+  std::size_t num_digits = 0;
+
+  n = 0;
+  while(num_digits < 2 && at(str, i) >= '0' && at(str, i) <= '9'){
+    n = n * 10 + static_cast<std::size_t>(at(str, i) - '0');
+    i += 1;
+    num_digits += 1;
+  }
+  return num_digits > 0;
+}
+
+/**
+ * Parse one of the fields in a cron expression, see cron_expr.c.
+ *
+ * @param[in]     str       Cron expression.
+ * @param[in,out] i         Index into @p str, updated to point to the next
+ *                          field.
+ * @param[out]    field     Field in @ref cron_expr.
+ * @param[in]     field_len Number of values in @p field.
+ * @param[in]     offset    Subtract this offset from fields with 1-based
+ *                          values.
+ * @param[in]     last      Set to true if the string can end after this
+ *                          field.
+ * @return                  True if the field is valid.
+ */
+constexpr bool
+parse_field(const std::string_view str,
+            std::size_t &i,
+            unsigned char *const field,
+            const std::size_t field_len,
+            const std::size_t offset,
+            const bool last) noexcept{
+  constexpr std::size_t NO_RANGE = static_cast<std::size_t>(-1);
+  bool has_comma = true;
+  std::size_t d1 = 0;
+  std::size_t d2 = 0;
+
+  if(at(str, i) == '*'){
+    i += 1;
+    bit_set_range(field, 0, field_len - 1);
+    has_comma = false;
+  }
+  while(has_comma){
+    if(!parse_number(str, i, d1)){
+      return false;
+    }
+    d1 -= offset;
+    d2 = NO_RANGE;
+    if(at(str, i) == '-'){
+      i += 1;
+      if(!parse_number(str, i, d2)){
+        return false;
+      }
+      d2 -= offset;
+    }
+    if(d1 >= field_len){
+      return false;
+    }
+    if(d2 == NO_RANGE){
+      bit_set_range(field, d1, d1);
+    }
+    else{
+      if(d1 > d2){
+        std::size_t swap = d1;
+        d1 = d2;
+        d2 = swap;
+      }
+      if(d2 >= field_len){
+        d2 = field_len - 1;
+      }
+      bit_set_range(field, d1, d2);
+    }
+    has_comma = at(str, i) == ',';
+    if(has_comma){
+      i += 1;
+    }
+  }
+  return parse_blank(str, i) > 0 || (last && at(str, i) == '\0');
+}
+
+/**
+ * Set all five fields of an expression to a fixed schedule.
+ *
+ * @param[out] e       See @ref cron_expr.
+ * @param[in]  minute  Minute, or -1 for every minute.
+ * @param[in]  hour    Hour, or -1 for every hour.
+ * @param[in]  day     Day of the month, or -1 for every day.
+ * @param[in]  month   Month, or -1 for every month.
+ * @param[in]  weekday Day of the week, or -1 for every day of the week.
+ */
+constexpr void
+set(::cron_expr &e,
+    const int minute,
+    const int hour,
+    const int day,
+    const int month,
+    const int weekday) noexcept{
+  bit_set_range(e.minute,
+                minute < 0 ? 0 : static_cast<std::size_t>(minute),
+                minute < 0 ? 59 : static_cast<std::size_t>(minute));
+  bit_set_range(e.hour,
+                hour < 0 ? 0 : static_cast<std::size_t>(hour),
+                hour < 0 ? 23 : static_cast<std::size_t>(hour));
+  bit_set_range(e.day,
+                day < 0 ? 0 : static_cast<std::size_t>(day - 1),
+                day < 0 ? 30 : static_cast<std::size_t>(day - 1));
+  bit_set_range(e.month,
+                month < 0 ? 0 : static_cast<std::size_t>(month - 1),
+                month < 0 ? 11 : static_cast<std::size_t>(month - 1));
+  bit_set_range(e.weekday,
+                weekday < 0 ? 0 : static_cast<std::size_t>(weekday),
+                weekday < 0 ? 6 : static_cast<std::size_t>(weekday));
+}
+
+/**
+ * Compile one of the special expressions like @@daily.
+ *
+ * @param[out]    e   See @ref cron_expr.
+ * @param[in]     str Cron expression.
+ * @param[in,out] i   Index into @p str after the @@ character, updated to
+ *                    point after the special expression.
+ * @return            True if the special expression is known.
+ */
+constexpr bool
+compile_special(::cron_expr &e,
+                const std::string_view str,
+                std::size_t &i) noexcept{
+  constexpr std::string_view SPECIAL[] = {
+    "yearly",
+    "annually",
+    "monthly",
+    "weekly",
+    "daily",
+    "midnight",
+    "hourly"
+  };
+  const std::string_view rest = str.substr(i);
+
+  for(std::size_t n = 0; n < std::size(SPECIAL); n++){
+    if(rest.starts_with(SPECIAL[n])){
+      i += SPECIAL[n].size();
+      if(n <= 1){
+        set(e, 0, 0, 1, 1, -1);
+      }
+      else if(n == 2){
+        set(e, 0, 0, 1, -1, -1);
+      }
+      else if(n == 3){
+        set(e, 0, 0, -1, -1, 0);
+      }
+      else if(n <= 5){
+        set(e, 0, 0, -1, -1, -1);
+      }
+      else{
+        set(e, 0, -1, -1, -1, -1);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Compile a cron expression, see @ref cron_expr_compile.
+ *
+ * A '\0' character ends the expression like it does for the C library.
+ *
+ * @param[out] e   Compiled expression.
+ * @param[in]  str Cron expression.
+ * @param[out] len Number of characters in the expression and the blanks
+ *                 after it.
+ * @return         True if the expression is valid.
+ */
+constexpr bool
+compile(::cron_expr &e,
+        const std::string_view str,
+        std::size_t &len) noexcept{
+  std::size_t i = 0;
+  bool valid;
+
+  e = ::cron_expr{};
+  if(at(str, i) == '@'){
+    i += 1;
+    valid = compile_special(e, str, i);
+    parse_blank(str, i);
+  }
+  else{
+    valid = parse_field(str, i, e.minute , 60, 0, false) &&
+            parse_field(str, i, e.hour   , 24, 0, false) &&
+            parse_field(str, i, e.day    , 31, 1, false) &&
+            parse_field(str, i, e.month  , 12, 1, false) &&
+            parse_field(str, i, e.weekday,  7, 0, true);
+  }
+  len = i;
+  return valid;
+}
+
+} /* namespace detail */
+
+class occurrences;
+
+/**
+ * Compiled cron expression.
+ *
+ * This wraps @ref cron_expr, which can get passed to the C library
+ * through @ref expr::c_expr.
+ */
+class expr{
+public:
+  /**
+   * Compile a cron expression that must be valid.
+   *
+   * Use this with string literals. An invalid expression fails to
+   * compile.
+   *
+   * @param[in] str Cron expression.
+   */
+  consteval expr(const char *const str) noexcept : e_{}{
+    std::size_t len = 0;
+
+    if(!detail::compile(e_, str, len)){
+      detail::invalid_cron_expression();
+    }
+  }
+
+  /**
+   * Compile a cron expression that might be invalid.
+   *
+   * @param[in] str Cron expression, with nothing following it except
+   *                blanks.
+   * @return        Compiled expression, or std::nullopt if @p str does not
+   *                contain a valid expression.
+   */
+  static constexpr std::optional<expr>
+  parse(const std::string_view str) noexcept{
+    expr e{::cron_expr{}};
+    std::size_t len = 0;
+
+    if(!detail::compile(e.e_, str, len) || len != str.size()){
+      return std::nullopt;
+    }
+    return e;
+  }
+
+  /**
+   * Get the expression in the format used by the C library.
+   *
+   * @return See @ref cron_expr.
+   */
+  constexpr const ::cron_expr &
+  c_expr() const noexcept{
+    return e_;
+  }
+
+  /**
+   * Check if a time matches the expression.
+   *
+   * @param[in] t Time, with the seconds ignored.
+   * @return      True if @p t matches.
+   */
+  constexpr bool
+  match(const std::chrono::sys_seconds t) const noexcept{
+    using namespace std::chrono;
+    const sys_days d = floor<days>(t);
+    const auto day_min = static_cast<std::size_t>(
+      floor<minutes>(t - d).count());
+
+    return match_day(d) &&
+           detail::bit_get(e_.hour, day_min / 60) &&
+           detail::bit_get(e_.minute, day_min % 60);
+  }
+
+  /**
+   * Find the first time after a given minute that matches the expression,
+   * see @ref cron_expr_next.
+   *
+   * @param[in] from Time to start searching from, exclusive. The seconds
+   *                 get ignored.
+   * @return         Matching time, or std::nullopt if the expression does
+   *                 not match within @ref CRON_EXPR_MAX_DAYS days.
+   */
+  constexpr std::optional<std::chrono::sys_seconds>
+  next(const std::chrono::sys_seconds from) const noexcept{
+    return search(from, 1);
+  }
+
+  /**
+   * Find the last time before a given minute that matches the expression,
+   * see @ref cron_expr_prev.
+   *
+   * @param[in] from Time to start searching from, exclusive. The seconds
+   *                 get ignored.
+   * @return         Matching time, or std::nullopt if the expression does
+   *                 not match within @ref CRON_EXPR_MAX_DAYS days.
+   */
+  constexpr std::optional<std::chrono::sys_seconds>
+  prev(const std::chrono::sys_seconds from) const noexcept{
+    return search(from, -1);
+  }
+
+  /**
+   * Iterate over the matching times after a given minute.
+   *
+   * @param[in] from Time to start from, exclusive.
+   * @return         Range of matching times in increasing order.
+   */
+  constexpr occurrences
+  after(std::chrono::sys_seconds from) const noexcept;
+
+  /**
+   * Compare the compiled schedules of two expressions.
+   *
+   * @param[in] other Expression to compare with.
+   * @return          True if both expressions match the same times.
+   */
+  constexpr bool
+  operator==(const expr &other) const noexcept{
+    return std::equal(std::begin(e_.minute), std::end(e_.minute),
+                      std::begin(other.e_.minute)) &&
+           std::equal(std::begin(e_.hour), std::end(e_.hour),
+                      std::begin(other.e_.hour)) &&
+           std::equal(std::begin(e_.day), std::end(e_.day),
+                      std::begin(other.e_.day)) &&
+           std::equal(std::begin(e_.month), std::end(e_.month),
+                      std::begin(other.e_.month)) &&
+           std::equal(std::begin(e_.weekday), std::end(e_.weekday),
+                      std::begin(other.e_.weekday));
+  }
+
+private:
+  /**
+   * Wrap an expression that already got compiled.
+   *
+   * @param[in] e See @ref cron_expr.
+   */
+  constexpr explicit expr(const ::cron_expr &e) noexcept : e_(e){
+  }
+
+  /**
+   * Check if a day matches the day, month, and weekday fields.
+   *
+   * @param[in] d Day to check.
+   * @return      True if @p d matches.
+   */
+  constexpr bool
+  match_day(const std::chrono::sys_days d) const noexcept{
+    using namespace std::chrono;
+    const year_month_day ymd{d};
+
+    return detail::bit_get(e_.weekday, weekday{d}.c_encoding()) &&
+           detail::bit_get(e_.month,
+                           static_cast<unsigned>(ymd.month()) - 1) &&
+           detail::bit_get(e_.day,
+                           static_cast<unsigned>(ymd.day()) - 1);
+  }
+
+  /**
+   * Search for a matching time one minute at a time, see cron_expr.c.
+   *
+   * @param[in] from Time to start searching from, exclusive.
+   * @param[in] dir  1 to search forward, or -1 to search backwards.
+   * @return         Matching time, or std::nullopt.
+   */
+  constexpr std::optional<std::chrono::sys_seconds>
+  search(const std::chrono::sys_seconds from,
+         const int dir) const noexcept{
+    using namespace std::chrono;
+    constexpr long DAY_MIN = 24 * 60;
+    const time_point<system_clock, minutes> start =
+      floor<minutes>(from) + minutes{dir};
+    sys_days d = floor<days>(start);
+    long day_min = (start - d).count();
+
+    for(long n = 0; n < CRON_EXPR_MAX_DAYS; n++){
+      if(match_day(d)){
+        for(long hour = day_min / 60; hour >= 0 && hour < 24; hour += dir){
+          if(!detail::bit_get(e_.hour, static_cast<std::size_t>(hour))){
+            continue;
+          }
+          long min = hour == day_min / 60 ? day_min % 60 : dir > 0 ? 0 : 59;
+          for(; min >= 0 && min < 60; min += dir){
+            if(detail::bit_get(e_.minute, static_cast<std::size_t>(min))){
+              return sys_seconds{d} + hours{hour} + minutes{min};
+            }
+          }
+        }
+      }
+      d += days{dir};
+      day_min = dir > 0 ? 0 : DAY_MIN - 1;
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * Compiled expression.
+   */
+  ::cron_expr e_;
+};
+
+/**
+ * Range of the times that match an expression, see @ref expr::after.
+ *
+ * The range ends when @ref expr::next finds no more matches.
+ */
+class occurrences{
+public:
+  /**
+   * Input iterator over the matching times.
+   */
+  class iterator{
+  public:
+    /**
+     * Type of the matching times.
+     */
+    using value_type = std::chrono::sys_seconds;
+
+    /**
+     * Required by std::input_iterator.
+     */
+    using difference_type = std::ptrdiff_t;
+
+    /**
+     * Create an iterator that has reached the end.
+     */
+    constexpr iterator() noexcept = default;
+
+    /**
+     * Create an iterator at the first match after a time.
+     *
+     * @param[in] e    Expression to match.
+     * @param[in] from Time to start from, exclusive.
+     */
+    constexpr iterator(const expr &e,
+                       const std::chrono::sys_seconds from) noexcept
+      : e_(&e), t_(e.next(from)){
+    }
+
+    /**
+     * Get the current matching time.
+     *
+     * @return Matching time.
+     */
+    constexpr value_type
+    operator*() const noexcept{
+      return *t_;
+    }
+
+    /**
+     * Advance to the next matching time.
+     *
+     * @return This iterator.
+     */
+    constexpr iterator &
+    operator++() noexcept{
+      t_ = e_->next(*t_);
+      return *this;
+    }
+
+    /**
+     * Advance to the next matching time.
+     */
+    constexpr void
+    operator++(int) noexcept{
+      ++*this;
+    }
+
+    /**
+     * Check if the iterator reached the end of the range.
+     *
+     * @return True if there are no more matching times.
+     */
+    constexpr bool
+    operator==(std::default_sentinel_t) const noexcept{
+      return !t_.has_value();
+    }
+
+  private:
+    /**
+     * Expression to match.
+     */
+    const expr *e_ = nullptr;
+
+    /**
+     * Current matching time, or std::nullopt at the end.
+     */
+    std::optional<value_type> t_;
+  };
+
+  /**
+   * Create the range of matching times after a given time.
+   *
+   * @param[in] e    Expression to match, which must outlive the range.
+   * @param[in] from Time to start from, exclusive.
+   */
+  constexpr occurrences(const expr &e,
+                        const std::chrono::sys_seconds from) noexcept
+    : e_(&e), from_(from){
+  }
+
+  /**
+   * Get an iterator at the first matching time.
+   *
+   * @return See @ref iterator.
+   */
+  constexpr iterator
+  begin() const noexcept{
+    return iterator(*e_, from_);
+  }
+
+  /**
+   * Get the end of the range.
+   *
+   * @return Sentinel compared against @ref iterator.
+   */
+  constexpr std::default_sentinel_t
+  end() const noexcept{
+    return std::default_sentinel;
+  }
+
+private:
+  /**
+   * Expression to match.
+   */
+  const expr *e_;
+
+  /**
+   * Time to start from, exclusive.
+   */
+  std::chrono::sys_seconds from_;
+};
+
+constexpr occurrences
+expr::after(const std::chrono::sys_seconds from) const noexcept{
+  return occurrences(*this, from);
+}
+
+/**
+ * User-defined literal for cron expressions.
+ */
+namespace literals{
+
+/**
+ * Compile a cron expression literal, like "0 * * * *"_cron.
+ *
+ * @param[in] str Cron expression.
+ * @param[in] len Length of @p str.
+ * @return        Compiled expression.
+ */
+consteval expr
+operator""_cron(const char *const str,
+                const std::size_t len) noexcept{
+  static_cast<void>(len);
+  return expr(str);
+}
+
+} /* namespace literals */
+
+} /* namespace cron */
+
+#endif /* CRON_HPP */
@@ -0,0 +1,534 @@
+/**
+ * @file
+ * @brief Cron expression library.
+ * @author James Humphrey (humphreyj@somnisoft.com)
+ *
+ * See cron_expr.h.
+ *
+ * This software has been placed into the public domain using CC0.
+ */
+
+#include <string.h>
+
+#include "cron_expr.h"
+
+/**
+ * Number of minutes in a day.
+ */
+#define CRON_EXPR_DAY_MIN (24 * 60)
+
+/**
+ * Check if a character separates the fields of a cron expression.
+ *
+ * @param[in] c Character to check.
+ * @retval    1 @p c is a space or a tab.
+ * @retval    0 @p c is not a blank character.
+ */
+static int
+cron_expr_isblank(const char c){
+  return c == ' ' || c == '\t';
+}
+
+/**
+ * Check if a character is a decimal digit.
+ *
+ * @param[in] c Character to check.
+ * @retval    1 @p c is a digit.
+ * @retval    0 @p c is not a digit.
+ */
+static int
+cron_expr_isdigit(const char c){
+  return c >= '0' && c <= '9';
+}
+
+/**
+ * Check if a bit is set in a field.
+ *
+ * @param[in] field Field in @ref cron_expr.
+ * @param[in] i     Bit index.
+ * @retval    1     The bit is set.
+ * @retval    0     The bit is not set.
+ */
+static int
+cron_expr_bit_get(const unsigned char *const field,
+                  const size_t i){
+  return (field[i / 8] >> (i % 8)) & 1;
+}
+
+/**
+ * Set a range of bits in a field.
+ *
+ * @param[in,out] field Field in @ref cron_expr.
+ * @param[in]     start First bit index.
+ * @param[in]     end   Last bit index, inclusive.
+ */
+static void
+cron_expr_bit_set_range(unsigned char *const field,
+                        const size_t start,
+                        const size_t end){
+  size_t i;
+
+  for(i = start; i <= end; i++){
+    field[i / 8] = (unsigned char)(field[i / 8] | (1 << (i % 8)));
+  }
+}
+
+/**
+ * Skip blank characters.
+ *
+ * @param[in]     str     String to check for blank characters.
+ * @param[in,out] str_idx Position to start from, updated to point to the
+ *                        character after the blanks.
+ * @return                Number of blank characters skipped.
+ */
+static size_t
+cron_expr_parse_blank(const char *const str,
+                      size_t *const str_idx){
+  size_t num_blanks;
+
+  for(num_blanks = 0; cron_expr_isblank(str[*str_idx]); num_blanks++){
+    *str_idx += 1;
+  }
+  return num_blanks;
+}
+
+/**
+ * Convert a string of one or two digits to an unsigned integer.
+ *
+ * @param[in] str One or two character string of digits [0-99].
+ * @return        Unsigned int representation of @p str.
+ */
+static unsigned int
+cron_expr_strtoul_field(const unsigned char *const str){
+  unsigned int ul;
+
+  if(str[1] == '\0'){
+    ul = (unsigned int)(str[0] - '0');
+  }
+  else{
+    ul = (unsigned int)(10 * (str[0] - '0') +
+                         1 * (str[1] - '0'));
+  }
+  return ul;
+}
+
+/**
+ * Parse one of the fields in a cron expression.
+ *
+ * @param[in]     str       Cron expression.
+ * @param[in,out] str_idx   Index into @p str, updated to point to the next
+ *                          field.
+ * @param[out]    field     Field in @ref cron_expr.
+ * @param[in]     field_len Number of values in @p field.
+ * @param[in]     offset    Subtract this offset from fields with 1-based
+ *                          values.
+ * @param[in]     last      Set to 1 if the string can end after this field.
+ * @retval        0         Parsed the field.
+ * @retval        -1        Invalid field.
+ */
+static int
+cron_expr_parse_field(const char *const str,
+                      size_t *const str_idx,
+                      unsigned char *const field,
+                      const size_t field_len,
+                      const size_t offset,
+                      const int last){
+  int rc;
+  int has_comma;
+  size_t i;
+  unsigned char digit_1[3];
+  unsigned char digit_2[3];
+  size_t d1;
+  size_t d2;
+  size_t swap;
+
+  rc = 0;
+  if(str[*str_idx] == '*'){
+    *str_idx += 1;
+    cron_expr_bit_set_range(field, 0, field_len - 1);
+  }
+  else{
+    do{
+      has_comma = 0;
+      memset(digit_1, 0, sizeof(digit_1));
+      memset(digit_2, 0, sizeof(digit_2));
+      for(i = 0; i < 2 && cron_expr_isdigit(str[*str_idx]); i++){
+        digit_1[i] = (unsigned char)str[*str_idx];
+        *str_idx += 1;
+      }
+      if(i == 0){
+        rc = -1;
+        break;
+      }
+      if(str[*str_idx] == '-'){
+        *str_idx += 1;
+        for(i = 0; i < 2 && cron_expr_isdigit(str[*str_idx]); i++){
+          digit_2[i] = (unsigned char)str[*str_idx];
+          *str_idx += 1;
+        }
+        if(i == 0){
+          rc = -1;
+          break;
+        }
+        d2 = cron_expr_strtoul_field(digit_2) - offset;
+      }
+      else{
+        d2 = (size_t)-1;
+      }
+      d1 = cron_expr_strtoul_field(digit_1) - offset;
+      if(d1 >= field_len){
+        rc = -1;
+      }
+      else if(d2 == (size_t)-1){
+        cron_expr_bit_set_range(field, d1, d1);
+      }
+      else{
+        if(d1 > d2){
+          swap = d1;
+          d1 = d2;
+          d2 = swap;
+        }
+        if(d2 >= field_len){
+          d2 = field_len - 1;
+        }
+        cron_expr_bit_set_range(field, d1, d2);
+      }
+      if(str[*str_idx] == ','){
+        *str_idx += 1;
+        has_comma = 1;
+      }
+    } while(has_comma);
+  }
+  if(cron_expr_parse_blank(str, str_idx) == 0 &&
+     (last == 0 || str[*str_idx] != '\0')){
+    rc = -1;
+  }
+  return rc;
+}
+
+/**
+ * Set all five fields of an expression to a fixed schedule.
+ *
+ * @param[out] expr    See @ref cron_expr.
+ * @param[in]  minute  Minute, or -1 for every minute.
+ * @param[in]  hour    Hour, or -1 for every hour.
+ * @param[in]  day     Day of the month, or -1 for every day.
+ * @param[in]  month   Month, or -1 for every month.
+ * @param[in]  weekday Day of the week, or -1 for every day of the week.
+ */
+static void
+cron_expr_set(struct cron_expr *const expr,
+              const int minute,
+              const int hour,
+              const int day,
+              const int month,
+              const int weekday){
+  if(minute < 0){
+    cron_expr_bit_set_range(expr->minute, 0, 59);
+  }
+  else{
+    cron_expr_bit_set_range(expr->minute, (size_t)minute, (size_t)minute);
+  }
+  if(hour < 0){
+    cron_expr_bit_set_range(expr->hour, 0, 23);
+  }
+  else{
+    cron_expr_bit_set_range(expr->hour, (size_t)hour, (size_t)hour);
+  }
+  if(day < 0){
+    cron_expr_bit_set_range(expr->day, 0, 30);
+  }
+  else{
+    cron_expr_bit_set_range(expr->day, (size_t)day - 1, (size_t)day - 1);
+  }
+  if(month < 0){
+    cron_expr_bit_set_range(expr->month, 0, 11);
+  }
+  else{
+    cron_expr_bit_set_range(expr->month, (size_t)month - 1, (size_t)month - 1);
+  }
+  if(weekday < 0){
+    cron_expr_bit_set_range(expr->weekday, 0, 6);
+  }
+  else{
+    cron_expr_bit_set_range(expr->weekday, (size_t)weekday, (size_t)weekday);
+  }
+}
+
+/**
+ * Compile one of the special expressions like @@daily.
+ *
+ * @param[out]    expr    See @ref cron_expr.
+ * @param[in]     str     Cron expression.
+ * @param[in,out] str_idx Index into @p str after the @@ character, updated
+ *                        to point after the special expression.
+ * @retval        0       Compiled the expression.
+ * @retval        -1      Unknown special expression.
+ */
+static int
+cron_expr_compile_special(struct cron_expr *const expr,
+                          const char *const str,
+                          size_t *const str_idx){
+  static const char *const SPECIAL[] = {
+    "yearly",
+    "annually",
+    "monthly",
+    "weekly",
+    "daily",
+    "midnight",
+    "hourly"
+  };
+  size_t i;
+  size_t special_len;
+  int rc;
+
+  rc = -1;
+  for(i = 0; rc != 0 && i < sizeof(SPECIAL) / sizeof(*SPECIAL); i++){
+    special_len = strlen(SPECIAL[i]);
+    if(strncmp(&str[*str_idx], SPECIAL[i], special_len) == 0){
+      *str_idx += special_len;
+      rc = 0;
+      if(i <= 1){
+        /* 0 0 1 1 * */
+        cron_expr_set(expr, 0, 0, 1, 1, -1);
+      }
+      else if(i == 2){
+        /* 0 0 1 * * */
+        cron_expr_set(expr, 0, 0, 1, -1, -1);
+      }
+      else if(i == 3){
+        /* 0 0 * * 0 */
+        cron_expr_set(expr, 0, 0, -1, -1, 0);
+      }
+      else if(i <= 5){
+        /* 0 0 * * * */
+        cron_expr_set(expr, 0, 0, -1, -1, -1);
+      }
+      else{
+        /* 0 * * * * */
+        cron_expr_set(expr, 0, -1, -1, -1, -1);
+      }
+    }
+  }
+  return rc;
+}
+
+int
+cron_expr_compile(struct cron_expr *const expr,
+                  const char *const str,
+                  size_t *const len){
+  size_t i;
+  int rc;
+
+  memset(expr, 0, sizeof(*expr));
+  i = 0;
+  if(str[i] == '@'){
+    i += 1;
+    rc = cron_expr_compile_special(expr, str, &i);
+    cron_expr_parse_blank(str, &i);
+  }
+  else if(cron_expr_parse_field(str, &i, expr->minute , 60, 0, 0) < 0 ||
+          cron_expr_parse_field(str, &i, expr->hour   , 24, 0, 0) < 0 ||
+          cron_expr_parse_field(str, &i, expr->day    , 31, 1, 0) < 0 ||
+          cron_expr_parse_field(str, &i, expr->month  , 12, 1, 0) < 0 ||
+          cron_expr_parse_field(str, &i, expr->weekday,  7, 0, 1) < 0){
+    rc = -1;
+  }
+  else{
+    rc = 0;
+  }
+  if(rc == 0 && len){
+    *len = i;
+  }
+  return rc;
+}
+
+int
+cron_expr_match(const struct cron_expr *const expr,
+                const struct tm *const tm){
+  return cron_expr_bit_get(expr->weekday, (size_t)tm->tm_wday    ) &&
+         cron_expr_bit_get(expr->month  , (size_t)tm->tm_mon     ) &&
+         cron_expr_bit_get(expr->day    , (size_t)tm->tm_mday - 1) &&
+         cron_expr_bit_get(expr->hour   , (size_t)tm->tm_hour    ) &&
+         cron_expr_bit_get(expr->minute , (size_t)tm->tm_min     );
+}
+
+/**
+ * Divide and round towards negative infinity.
+ *
+ * @param[in] a Dividend.
+ * @param[in] b Divisor, greater than 0.
+ * @return      Floor of @p a / @p b.
+ */
+static long
+cron_expr_floor_div(const long a,
+                    const long b){
+  long q;
+
+  q = a / b;
+  if(a % b < 0){
+    q -= 1;
+  }
+  return q;
+}
+
+/**
+ * Get the number of days since 1970-01-01 of a date.
+ *
+ * @param[in] year  Year.
+ * @param[in] month Month, 1-12.
+ * @param[in] day   Day of the month, 1-31.
+ * @return          Days since 1970-01-01, negative for earlier dates.
+ */
+static long
+cron_expr_days_from_civil(const long year,
+                          const long month,
+                          const long day){
+  long y;
+  long era;
+  long yoe;
+  long doy;
+  long doe;
+
+  y = year - (month <= 2);
+  era = cron_expr_floor_div(y, 400);
+  yoe = y - era * 400;
+  doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+/**
+ * Convert a number of days since 1970-01-01 to a date.
+ *
+ * @param[in]  days See @ref cron_expr_days_from_civil.
+ * @param[out] tm   Store the tm_year, tm_mon, tm_mday, tm_wday, and
+ *                  tm_yday fields here.
+ */
+static void
+cron_expr_civil_from_days(const long days,
+                          struct tm *const tm){
+  long z;
+  long era;
+  long doe;
+  long yoe;
+  long year;
+  long doy;
+  long mp;
+  long month;
+
+  z = days + 719468;
+  era = cron_expr_floor_div(z, 146097);
+  doe = z - era * 146097;
+  yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  year = yoe + era * 400;
+  doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  mp = (5 * doy + 2) / 153;
+  month = mp < 10 ? mp + 3 : mp - 9;
+  year += (month <= 2);
+  tm->tm_year = (int)(year - 1900);
+  tm->tm_mon = (int)(month - 1);
+  tm->tm_mday = (int)(doy - (153 * mp + 2) / 5 + 1);
+  tm->tm_wday = (int)(days - cron_expr_floor_div(days + 4, 7) * 7 + 4);
+  tm->tm_yday = (int)(days - cron_expr_days_from_civil(year, 1, 1));
+}
+
+/**
+ * Search for a matching wall time.
+ *
+ * Months that do not match get skipped as a whole, and the hours and
+ * minutes only get checked on the days that match.
+ *
+ * @param[in]  expr See @ref cron_expr.
+ * @param[in]  from Wall time to start searching from, exclusive.
+ * @param[in]  dir  1 to search forward, or -1 to search backwards.
+ * @param[out] tm   Matching wall time.
+ * @retval     0    Found a match within @ref CRON_EXPR_MAX_DAYS days.
+ * @retval     -1   No match within @ref CRON_EXPR_MAX_DAYS days.
+ */
+static int
+cron_expr_search(const struct cron_expr *const expr,
+                 const struct tm *const from,
+                 const int dir,
+                 struct tm *const tm){
+  long months;
+  long year;
+  long days;
+  long start_days;
+  long day_min;
+  long hour;
+  long min;
+  int rc;
+
+  /* Normalize the starting point like mktime() does. */
+  months = (long)from->tm_year * 12 + from->tm_mon;
+  year = cron_expr_floor_div(months, 12);
+  days = cron_expr_days_from_civil(year + 1900, months - year * 12 + 1, 1);
+  days += from->tm_mday - 1;
+  day_min = (long)from->tm_hour * 60 + from->tm_min + dir;
+  days += cron_expr_floor_div(day_min, CRON_EXPR_DAY_MIN);
+  day_min -= cron_expr_floor_div(day_min, CRON_EXPR_DAY_MIN) *
+             CRON_EXPR_DAY_MIN;
+
+  rc = -1;
+  start_days = days;
+  memset(tm, 0, sizeof(*tm));
+  while(rc != 0 && (days - start_days) * dir < CRON_EXPR_MAX_DAYS){
+    cron_expr_civil_from_days(days, tm);
+    if(cron_expr_bit_get(expr->month, (size_t)tm->tm_mon) == 0){
+      /* Skip to the first or last day of the next month. */
+      year = (long)tm->tm_year + 1900;
+      if(dir > 0){
+        days = cron_expr_days_from_civil(year + (tm->tm_mon == 11),
+                                         (tm->tm_mon + 1) % 12 + 1,
+                                         1);
+      }
+      else{
+        days = cron_expr_days_from_civil(year, tm->tm_mon + 1, 1) - 1;
+      }
+    }
+    else{
+      if(cron_expr_bit_get(expr->weekday, (size_t)tm->tm_wday    ) &&
+         cron_expr_bit_get(expr->day    , (size_t)tm->tm_mday - 1)){
+        for(hour = day_min / 60;
+            rc != 0 && hour >= 0 && hour < 24;
+            hour += dir){
+          if(cron_expr_bit_get(expr->hour, (size_t)hour)){
+            if(hour == day_min / 60){
+              min = day_min % 60;
+            }
+            else{
+              min = dir > 0 ? 0 : 59;
+            }
+            for(; rc != 0 && min >= 0 && min < 60; min += dir){
+              if(cron_expr_bit_get(expr->minute, (size_t)min)){
+                tm->tm_hour = (int)hour;
+                tm->tm_min = (int)min;
+                rc = 0;
+              }
+            }
+          }
+        }
+      }
+      days += dir;
+    }
+    day_min = dir > 0 ? 0 : CRON_EXPR_DAY_MIN - 1;
+  }
+  tm->tm_sec = 0;
+  tm->tm_isdst = -1;
+  return rc;
+}
+
+int
+cron_expr_next(const struct cron_expr *const expr,
+               const struct tm *const from,
+               struct tm *const next){
+  return cron_expr_search(expr, from, 1, next);
+}
+
+int
+cron_expr_prev(const struct cron_expr *const expr,
+               const struct tm *const from,
+               struct tm *const prev){
+  return cron_expr_search(expr, from, -1, prev);
+}
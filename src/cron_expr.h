@@ -0,0 +1,161 @@
+/**
+ * @file
+ * @brief Cron expression library.
+ * @author James Humphrey (humphreyj@somnisoft.com)
+ *
+ * Compile the schedule of a crontab line and match it against wall times
+ * with the same semantics as crond. The library does not allocate memory
+ * or use global state, so all functions are reentrant.
+ *
+ * A cron expression contains five fields separated by blanks: minute
+ * (0-59), hour (0-23), day of the month (1-31), month (1-12), and day of
+ * the week (0-6, Sunday is 0). Each field contains *, or a comma-separated
+ * list of numbers and ranges like 1-5. A wall time matches the expression
+ * if it matches all five fields. An expression can also contain one of
+ * @@yearly, @@annually, @@monthly, @@weekly, @@daily, @@midnight, or @@hourly.
+ *
+ * The wall times do not have a time zone. Callers convert them from and
+ * to time_t with localtime_r() and mktime(), or with gmtime_r() and an
+ * offset for other time zones.
+ *
+ * This software has been placed into the public domain using CC0.
+ */
+#ifndef CRON_EXPR_H
+#define CRON_EXPR_H
+
+#include <stddef.h>
+#include <time.h>
+
+/**
+ * Version of the API, incremented when it changes in an incompatible way.
+ */
+#define CRON_EXPR_API_VERSION 1
+
+/**
+ * Number of days searched by @ref cron_expr_next and @ref cron_expr_prev.
+ *
+ * This covers expressions that only match on February 29.
+ */
+#define CRON_EXPR_MAX_DAYS (8 * 366)
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Compiled cron expression.
+ *
+ * Each field contains one bit for each value, with the lowest value in the
+ * lowest bit of the first byte. Callers allocate this structure and should
+ * only access it through the cron_expr functions.
+ */
+struct cron_expr{
+  /**
+   * Minutes 0-59.
+   */
+  unsigned char minute[8];
+
+  /**
+   * Hours 0-23.
+   */
+  unsigned char hour[3];
+
+  /**
+   * Days of the month 1-31, stored from bit 0.
+   */
+  unsigned char day[4];
+
+  /**
+   * Months 1-12, stored from bit 0.
+   */
+  unsigned char month[2];
+
+  /**
+   * Days of the week 0-6.
+   */
+  unsigned char weekday[1];
+
+  /**
+   * Reserved for future use, set to zero by @ref cron_expr_compile.
+   */
+  unsigned char reserved[6];
+};
+
+/**
+ * Compile a cron expression.
+ *
+ * Each of the five fields must get followed by blanks, except that the
+ * string can also end after the last field. The special expressions like
+ * @@daily do not need to get followed by blanks.
+ *
+ * @param[out] expr Compiled expression.
+ * @param[in]  str  String starting with the cron expression, like a
+ *                  crontab line.
+ * @param[out] len  If not NULL, store the number of characters in the
+ *                  expression and the blanks after it. For a crontab line,
+ *                  this is where the command starts.
+ * @retval     0    Compiled the expression.
+ * @retval     -1   Invalid expression.
+ */
+int
+cron_expr_compile(struct cron_expr *const expr,
+                  const char *const str,
+                  size_t *const len);
+
+/**
+ * Check if a wall time matches a cron expression.
+ *
+ * Only the tm_min, tm_hour, tm_mday, tm_mon, and tm_wday fields get used.
+ *
+ * @param[in] expr See @ref cron_expr.
+ * @param[in] tm   Wall time.
+ * @retval    1    The wall time matches.
+ * @retval    0    The wall time does not match.
+ */
+int
+cron_expr_match(const struct cron_expr *const expr,
+                const struct tm *const tm);
+
+/**
+ * Find the first wall time after a given minute that matches a cron
+ * expression.
+ *
+ * Only the tm_min, tm_hour, tm_mday, tm_mon, and tm_year fields of
+ * @p from get used, and they must contain a valid date. All fields of
+ * @p next get set, with tm_sec set to 0 and tm_isdst set to -1.
+ *
+ * @param[in]  expr See @ref cron_expr.
+ * @param[in]  from Wall time to start searching from, exclusive.
+ * @param[out] next Matching wall time.
+ * @retval     0    Found a match within @ref CRON_EXPR_MAX_DAYS days.
+ * @retval     -1   The expression does not match within
+ *                  @ref CRON_EXPR_MAX_DAYS days.
+ */
+int
+cron_expr_next(const struct cron_expr *const expr,
+               const struct tm *const from,
+               struct tm *const next);
+
+/**
+ * Find the last wall time before a given minute that matches a cron
+ * expression.
+ *
+ * This works like @ref cron_expr_next, searching backwards.
+ *
+ * @param[in]  expr See @ref cron_expr.
+ * @param[in]  from Wall time to start searching from, exclusive.
+ * @param[out] prev Matching wall time.
+ * @retval     0    Found a match within @ref CRON_EXPR_MAX_DAYS days.
+ * @retval     -1   The expression does not match within
+ *                  @ref CRON_EXPR_MAX_DAYS days.
+ */
+int
+cron_expr_prev(const struct cron_expr *const expr,
+               const struct tm *const from,
+               struct tm *const prev);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* CRON_EXPR_H */
@@ -9,14 +9,21 @@
  * This software has been placed into the public domain using CC0.
  */
 
+#include <sys/file.h>
+#include <sys/inotify.h>
+#include <sys/resource.h>
+#include <sys/select.h>
 #include <ctype.h>
+#include <dirent.h>
 #include <fcntl.h>
+#include <grp.h>
 #include <limits.h>
 #include <pwd.h>
 #include <signal.h>
 
 #include "cron.h"
 #include "crond.h"
+#include "crond_probe.h"
 
 /**
  * Set to 1 if SIGTERM signal caught.
@@ -36,6 +43,60 @@ g_signal_sigterm = 0;
 static volatile sig_atomic_t
 g_signal_sigint = 0;
 
+/**
+ * Set to 1 if SIGHUP signal caught.
+ *
+ * The crontab file gets checked for changes when crond wakes up.
+ */
+static volatile sig_atomic_t
+g_signal_sighup = 0;
+
+/**
+ * Set to 1 if SIGCHLD signal caught.
+ *
+ * A job monitor process has exited and should get reaped.
+ */
+static volatile sig_atomic_t
+g_signal_sigchld = 0;
+
+/**
+ * Set to 1 if SIGUSR2 signal caught.
+ *
+ * crond executes itself again to load a new program image without
+ * stopping, see @ref crond_reexec.
+ */
+static volatile sig_atomic_t
+g_signal_sigusr2 = 0;
+
+/**
+ * Upper bound of each histogram bucket in microseconds.
+ *
+ * See @ref crond_histogram.
+ */
+static const unsigned long
+g_histogram_bucket_usec[CROND_HISTOGRAM_NUM_BUCKETS] = {
+  1000UL,
+  10000UL,
+  100000UL,
+  1000000UL,
+  10000000UL,
+  60000000UL
+};
+
+/**
+ * Prometheus "le" label value of each bucket in
+ * @ref g_histogram_bucket_usec.
+ */
+static const char *const
+g_histogram_bucket_le[CROND_HISTOGRAM_NUM_BUCKETS] = {
+  "0.001",
+  "0.01",
+  "0.1",
+  "1",
+  "10",
+  "60"
+};
+
 /**
  * Reallocate memory with an unsigned wrap check.
  *
@@ -64,6 +125,74 @@ crond_reallocarray(void *const ptr,
   return alloc;
 }
 
+#ifdef CRON_USDT
+/**
+ * Get the timestamp passed to the static tracepoints.
+ *
+ * See @ref crond_probe.h.
+ *
+ * @return CLOCK_MONOTONIC time in nanoseconds, or 0 if unavailable.
+ */
+static long
+crond_probe_ts(void){
+  struct timespec ts;
+  long ts_nsec;
+
+  if(clock_gettime(CLOCK_MONOTONIC, &ts) == 0){
+    ts_nsec = (long)ts.tv_sec * 1000000000L + ts.tv_nsec;
+  }
+  else{
+    ts_nsec = 0;
+  }
+  return ts_nsec;
+}
+
+/**
+ * Semaphore of the reparse_start probe.
+ */
+CROND_PROBE_SEMAPHORE(reparse_start);
+
+/**
+ * Semaphore of the reparse_end probe.
+ */
+CROND_PROBE_SEMAPHORE(reparse_end);
+
+/**
+ * Semaphore of the tick_start probe.
+ */
+CROND_PROBE_SEMAPHORE(tick_start);
+
+/**
+ * Semaphore of the tick_end probe.
+ */
+CROND_PROBE_SEMAPHORE(tick_end);
+
+/**
+ * Semaphore of the job_spawn probe.
+ */
+CROND_PROBE_SEMAPHORE(job_spawn);
+
+/**
+ * Semaphore of the job_exec probe.
+ */
+CROND_PROBE_SEMAPHORE(job_exec);
+
+/**
+ * Semaphore of the job_output probe.
+ */
+CROND_PROBE_SEMAPHORE(job_output);
+
+/**
+ * Semaphore of the job_mail probe.
+ */
+CROND_PROBE_SEMAPHORE(job_mail);
+
+/**
+ * Semaphore of the job_reap probe.
+ */
+CROND_PROBE_SEMAPHORE(job_reap);
+#endif /* CRON_USDT */
+
 /**
  * Print a formatted message to stderr surrounded by a crond prefix
  * and newline character.
@@ -184,23 +313,77 @@ static void
 crond_job_free(struct crond_job *const job){
   free(job->command);
   free(job->stdin_lines);
+  job->command = NULL;
+  job->stdin_lines = NULL;
 }
 
 /**
- * Free all jobs in @ref crond::job_list.
+ * Free a job in @ref crond::job_list and mark its slot as unused.
  *
- * @param[in,out] crond See @ref crond.
+ * The caller must detach the running entries of the job.
+ *
+ * @param[in,out] crond   See @ref crond.
+ * @param[in]     job_idx Index of the job in @ref crond::job_list.
  */
 static void
-crond_job_list_free(struct crond *const crond){
+crond_job_release(struct crond *const crond,
+                  const size_t job_idx){
+  struct crond_job *job;
+
+  job = &crond->job_list[job_idx];
+  crond_job_free(job);
+  job->next_free = crond->job_free;
+  crond->job_free = job_idx;
+  crond->num_job_free += 1;
+}
+
+/**
+ * Free the jobs in @ref crond::job_list.
+ *
+ * Jobs still running get detached from the job list, see
+ * @ref crond_running::job_idx.
+ *
+ * @param[in,out] crond     See @ref crond.
+ * @param[in]     ephemeral Set to true to also free the ephemeral jobs and
+ *                          the at jobs.
+ * @param[in]     source    Only free the crontab jobs loaded from this file,
+ *                          see @ref crond_job::source, or SIZE_MAX to free
+ *                          the jobs of every file.
+ */
+CRON_LINKAGE void
+crond_job_list_free(struct crond *const crond,
+                    const bool ephemeral,
+                    const size_t source){
   size_t job_i;
+  size_t run_i;
+  size_t job_idx;
+  const struct crond_job *job;
 
-  for(job_i = 0; job_i < crond->num_jobs; job_i++){
-    crond_job_free(&crond->job_list[job_i]);
+  /* Release in reverse so that new jobs reuse the slots in order. */
+  job_i = crond->num_jobs;
+  while(job_i > 0){
+    job_i -= 1;
+    job = &crond->job_list[job_i];
+    if(job->command &&
+       ((job->ephemeral == false &&
+         job->at_time == 0 &&
+         (source == SIZE_MAX || job->source == source)) ||
+        ephemeral)){
+      crond_job_release(crond, job_i);
+    }
+  }
+  for(run_i = 0; run_i < crond->num_running; run_i++){
+    job_idx = crond->running_list[run_i].job_idx;
+    if(job_idx != SIZE_MAX && crond->job_list[job_idx].command == NULL){
+      crond->running_list[run_i].job_idx = SIZE_MAX;
+    }
+  }
+  if(crond->num_job_free == crond->num_jobs){
+    free(crond->job_list);
+    crond->job_list = NULL;
+    crond->num_jobs = 0;
+    crond->num_job_free = 0;
   }
-  free(crond->job_list);
-  crond->job_list = NULL;
-  crond->num_jobs = 0;
 }
 
 /**
@@ -223,138 +406,6 @@ crond_crontab_parse_blank(const char *const line,
   return num_blanks;
 }
 
-/**
- * Convert a string (max 2 characters) to an unsigned integer.
- *
- * The caller must ensure that str has either one or two digit characters.
- *
- * @param[in] str One or two character string of digits [0-99].
- * @return        Unsigned int representation of @p str.
- */
-static unsigned int
-crond_strtoul_field(const unsigned char *const str){
-  unsigned int ul;
-
-  if(str[1] == '\0'){
-    ul = str[0] - '0';
-  }
-  else{
-    ul = 10 * (str[0] - '0') +
-          1 * (str[1] - '0');
-  }
-  return ul;
-}
-
-/**
- * Enable a job to run over a time range for a given field.
- *
- * @param[in,out] field Job field.
- * @param[in]     start Starting index.
- * @param[in]     end   Ending index.
- */
-static void
-crond_set_field_range(bool *const field,
-                      const size_t start,
-                      const size_t end){
-  size_t i;
-
-  for(i = start; i <= end; i++){
-    field[i] = true;
-  }
-}
-
-/**
- * Parse an integer value or range in one of the crontab fields.
- *
- * @param[in]     line      Crontab line to parse.
- * @param[in,out] line_idx  Index into @p line which will get updated as it
- *                          parses the next field.
- * @param[out]    field     Job field to populate integer data. For example,
- *                          @ref crond_job::minute.
- * @param[in]     field_len Maximum number of entries in @p field.
- * @param[in]     offset    Subtract this offset when working on fields with
- *                          1-based indexing.
- * @retval        0         Successfully parsed field.
- * @retval        -1        Failed to parse field.
- */
-static int
-crond_parse_field_int(const char *const line,
-                      size_t *const line_idx,
-                      bool *const field,
-                      const size_t field_len,
-                      const size_t offset){
-  int rc;
-  bool has_comma;
-  size_t i;
-  unsigned char digit_1[3];
-  unsigned char digit_2[3];
-  size_t d1;
-  size_t d2;
-  size_t swap;
-
-  rc = 0;
-  if(line[*line_idx] == '*'){
-    *line_idx += 1;
-    crond_set_field_range(field, 0, field_len);
-  }
-  else{
-    do{
-      has_comma = false;
-      memset(digit_1, 0, sizeof(digit_1));
-      memset(digit_2, 0, sizeof(digit_2));
-      for(i = 0; i < 2 && isdigit(line[*line_idx]); i++){
-        digit_1[i] = (unsigned char)line[*line_idx];
-        *line_idx += 1;
-      }
-      if(i == 0){
-        rc = -1;
-        break;
-      }
-      if(line[*line_idx] == '-'){
-        *line_idx += 1;
-        for(i = 0; i < 2 && isdigit(line[*line_idx]); i++){
-          digit_2[i] = (unsigned char)line[*line_idx];
-          *line_idx += 1;
-        }
-        if(i == 0){
-          rc = -1;
-          break;
-        }
-        d2 = crond_strtoul_field(digit_2) - offset;
-      }
-      else{
-        d2 = SIZE_MAX;
-      }
-      d1 = crond_strtoul_field(digit_1) - offset;
-      if(d1 >= field_len){
-        rc = -1;
-      }
-      else if(d2 == SIZE_MAX){
-        crond_set_field_range(field, d1, d1);
-      }
-      else{
-        if(d1 > d2){
-          swap = d1;
-          d1 = d2;
-          d2 = swap;
-        }
-        if(d2 >= field_len){
-          d2 = field_len;
-        }
-        crond_set_field_range(field, d1, d2);
-      }
-      if(line[*line_idx] == ','){
-        *line_idx += 1;
-        has_comma = true;
-      }
-    } while(has_comma);
-  }
-  if(crond_crontab_parse_blank(line, line_idx) == 0){
-    rc = -1;
-  }
-  return rc;
-}
-
 /**
  * Parse the command string in the crontab file.
  *
@@ -417,7 +468,51 @@ crond_crontab_parse_command(const char *const line,
 }
 
 /**
- * Append a new job to the job list.
+ * Add a new job to the job list.
+ *
+ * The job takes the first unused slot, or gets appended if there are no
+ * unused slots.
+ *
+ * @param[in,out] crond   See @ref crond.
+ * @param[in]     job     Add this job to the job list.
+ * @param[out]    job_idx Index of the new job in @ref crond::job_list.
+ * @retval        true    Job has been added.
+ * @retval        false   Failed to add job.
+ */
+static bool
+crond_job_add(struct crond *const crond,
+              const struct crond_job *const job,
+              size_t *const job_idx){
+  struct crond_job *new_job_list;
+  bool added;
+
+  added = true;
+  if(crond->num_job_free){
+    *job_idx = crond->job_free;
+    crond->job_free = crond->job_list[*job_idx].next_free;
+    crond->num_job_free -= 1;
+  }
+  else{
+    new_job_list = crond_reallocarray(crond->job_list,
+                                      crond->num_jobs + 1,
+                                      sizeof(*crond->job_list));
+    if(new_job_list == NULL){
+      added = false;
+    }
+    else{
+      crond->job_list = new_job_list;
+      *job_idx = crond->num_jobs;
+      crond->num_jobs += 1;
+    }
+  }
+  if(added){
+    memcpy(&crond->job_list[*job_idx], job, sizeof(*job));
+  }
+  return added;
+}
+
+/**
+ * Append a new job from the crontab file to the job list.
  *
  * @param[in,out] crond See @ref crond.
  * @param[in]     job   Append this job to the job list.
@@ -427,557 +522,5279 @@ crond_crontab_parse_command(const char *const line,
 static bool
 crond_job_append(struct crond *const crond,
                  const struct crond_job *const job){
-  struct crond_job *new_job_list;
+  size_t job_idx;
   bool appended;
 
-  new_job_list = crond_reallocarray(crond->job_list,
-                                    crond->num_jobs + 1,
-                                    sizeof(*crond->job_list));
-  if(new_job_list == NULL){
+  appended = crond_job_add(crond, job, &job_idx);
+  if(appended == false){
     crond_errx_noexit(crond, "reallocarray");
-    appended = false;
-  }
-  else{
-    crond->job_list = new_job_list;
-    memcpy(&crond->job_list[crond->num_jobs], job, sizeof(*job));
-    crond->num_jobs += 1;
-    appended = true;
   }
   return appended;
 }
 
 /**
- * Parse a single crontab line and append to the job list.
+ * Remove a single job from the job list.
  *
- * @param[in,out] crond See @ref crond.
- * @param[in]     line  Crontab line to parse.
+ * @param[in,out] crond   See @ref crond.
+ * @param[in]     job_idx Index of the job in @ref crond::job_list.
  */
-CRON_LINKAGE void
-crond_crontab_parse_line(struct crond *const crond,
-                         const char *line){
-  const char *const STR_YEARLY = "yearly";
-  const char *const STR_ANNUALLY = "annually";
-  const char *const STR_MONTHLY = "monthly";
-  const char *const STR_WEEKLY = "weekly";
-  const char *const STR_DAILY = "daily";
-  const char *const STR_MIDNIGHT = "midnight";
-  const char *const STR_HOURLY = "hourly";
-  size_t STRLEN_YEARLY;
-  size_t STRLEN_ANNUALLY;
-  size_t STRLEN_MONTHLY;
-  size_t STRLEN_WEEKLY;
-  size_t STRLEN_DAILY;
-  size_t STRLEN_MIDNIGHT;
-  size_t STRLEN_HOURLY;
+static void
+crond_job_remove(struct crond *const crond,
+                 const size_t job_idx){
+  size_t run_i;
+
+  crond_job_release(crond, job_idx);
+  for(run_i = 0; run_i < crond->num_running; run_i++){
+    if(crond->running_list[run_i].job_idx == job_idx){
+      crond->running_list[run_i].job_idx = SIZE_MAX;
+    }
+  }
+}
+
+/**
+ * Calculate the 32-bit FNV-1a hash of a string.
+ *
+ * @param[in] str String to hash.
+ * @return        Hash of @p str.
+ */
+static unsigned long
+crond_fnv1a(const char *const str){
+  const unsigned char *ustr;
+  unsigned long hash;
+
+  hash = 2166136261UL;
+  for(ustr = (const unsigned char *)str; *ustr; ustr++){
+    hash ^= *ustr;
+    hash = (hash * 16777619UL) & 0xffffffffUL;
+  }
+  return hash;
+}
+
+/**
+ * Parse a single crontab line into a job.
+ *
+ * @param[in]  crond See @ref crond.
+ * @param[in]  line  Crontab line to parse.
+ * @param[out] job   See @ref crond_job. The caller must free this with
+ *                   @ref crond_job_free if this function returns true.
+ * @retval     true  @p line contains a valid job.
+ * @retval     false @p line is blank, a comment, or invalid.
+ */
+static bool
+crond_job_parse(const struct crond *const crond,
+                const char *const line,
+                struct crond_job *const job){
   size_t i;
-  struct crond_job job;
-  const char *cmd_special;
+  size_t len;
   bool valid_line;
 
   i = 0;
-  valid_line = true;
+  valid_line = false;
   crond_crontab_parse_blank(line, &i);
   if(line[i] && line[i] != '#'){
-    memset(&job, 0, sizeof(job));
-    if(line[i] == '@'){
-      i += 1;
-      cmd_special = &line[i];
-      STRLEN_YEARLY   = strlen(STR_YEARLY);
-      STRLEN_ANNUALLY = strlen(STR_ANNUALLY);
-      STRLEN_MONTHLY  = strlen(STR_MONTHLY);
-      STRLEN_WEEKLY   = strlen(STR_WEEKLY);
-      STRLEN_DAILY    = strlen(STR_DAILY);
-      STRLEN_MIDNIGHT = strlen(STR_MIDNIGHT);
-      STRLEN_HOURLY   = strlen(STR_HOURLY);
-      if(strncmp(cmd_special, STR_YEARLY  , STRLEN_YEARLY  ) == 0 ||
-         strncmp(cmd_special, STR_ANNUALLY, STRLEN_ANNUALLY) == 0){
-        /* 0 0 1 1 * */
-        crond_set_field_range(job.minute , 0, 0                  );
-        crond_set_field_range(job.hour   , 0, 0                  );
-        crond_set_field_range(job.day    , 0, 0                  );
-        crond_set_field_range(job.month  , 0, 0                  );
-        crond_set_field_range(job.weekday, 0, sizeof(job.weekday));
-        if(cmd_special[0] == STR_YEARLY[0]){
-          i += STRLEN_YEARLY;
-        }
-        else{
-          i += STRLEN_ANNUALLY;
-        }
-      }
-      else if(strncmp(cmd_special, STR_MONTHLY, STRLEN_MONTHLY) == 0){
-        /* 0 0 1 * * */
-        crond_set_field_range(job.minute , 0, 0                  );
-        crond_set_field_range(job.hour   , 0, 0                  );
-        crond_set_field_range(job.day    , 0, 0                  );
-        crond_set_field_range(job.month  , 0, sizeof(job.month)  );
-        crond_set_field_range(job.weekday, 0, sizeof(job.weekday));
-        i += STRLEN_MONTHLY;
-      }
-      else if(strncmp(cmd_special, STR_WEEKLY, STRLEN_WEEKLY) == 0){
-        /* 0 0 * * 0 */
-        crond_set_field_range(job.minute , 0, 0                );
-        crond_set_field_range(job.hour   , 0, 0                );
-        crond_set_field_range(job.day    , 0, sizeof(job.day)  );
-        crond_set_field_range(job.month  , 0, sizeof(job.month));
-        crond_set_field_range(job.weekday, 0, 0                );
-        i += STRLEN_WEEKLY;
-      }
-      else if(strncmp(cmd_special, STR_DAILY   , STRLEN_DAILY) == 0 ||
-              strncmp(cmd_special, STR_MIDNIGHT, STRLEN_MIDNIGHT) == 0){
-        /* 0 0 * * * */
-        crond_set_field_range(job.minute , 0, 0                  );
-        crond_set_field_range(job.hour   , 0, 0                  );
-        crond_set_field_range(job.day    , 0, sizeof(job.day)    );
-        crond_set_field_range(job.month  , 0, sizeof(job.month)  );
-        crond_set_field_range(job.weekday, 0, sizeof(job.weekday));
-        if(cmd_special[0] == STR_DAILY[0]){
-          i += STRLEN_DAILY;
-        }
-        else{
-          i += STRLEN_MIDNIGHT;
-        }
-      }
-      else if(strncmp(cmd_special, STR_HOURLY, STRLEN_HOURLY) == 0){
-        /* 0 * * * * */
-        crond_set_field_range(job.minute , 0, 0                  );
-        crond_set_field_range(job.hour   , 0, sizeof(job.hour)   );
-        crond_set_field_range(job.day    , 0, sizeof(job.day)    );
-        crond_set_field_range(job.month  , 0, sizeof(job.month)  );
-        crond_set_field_range(job.weekday, 0, sizeof(job.weekday));
-        i += STRLEN_HOURLY;
-      }
-      else{
+    memset(job, 0, sizeof(*job));
+    if(cron_expr_compile(&job->expr, &line[i], &len) != 0){
+      if(line[i] == '@'){
         crond_verbose(crond, "invalid special command: %s", &line[i]);
-        valid_line = false;
       }
     }
+    else if(line[i] != '@' && line[i + len] == '\0' &&
+            isblank(line[i + len - 1]) == 0){
+      /* The weekday field must get followed by the command. */
+    }
     else{
-      if(crond_parse_field_int(line, &i, job.minute , sizeof(job.minute ), 0) < 0 ||
-         crond_parse_field_int(line, &i, job.hour   , sizeof(job.hour   ), 0) < 0 ||
-         crond_parse_field_int(line, &i, job.day    , sizeof(job.day    ), 1) < 0 ||
-         crond_parse_field_int(line, &i, job.month  , sizeof(job.month  ), 1) < 0 ||
-         crond_parse_field_int(line, &i, job.weekday, sizeof(job.weekday), 0) < 0){
-        valid_line = false;
-      }
-    }
-    if(valid_line == true){
-      crond_crontab_parse_blank(line, &i);
-      if(crond_crontab_parse_command(line, i, &job) == false ||
-         crond_job_append(crond, &job) == false){
-        crond_job_free(&job);
+      i += len;
+      if(crond_crontab_parse_command(line, i, job)){
+        job->hash = crond_fnv1a(line);
+        valid_line = true;
+      }
+      else{
+        crond_job_free(job);
       }
     }
   }
+  return valid_line;
 }
 
 /**
- * Check if the crontab has changed and reparse if it has.
+ * Get the current time from a clock.
  *
- * @param[in,out] crond See @ref crond.
+ * With @ref CROND_FLAG_WARP, CLOCK_REALTIME reads the virtual clock instead.
+ * CLOCK_MONOTONIC always reads the real clock, so the reload times still
+ * measure the work done by crond.
+ *
+ * @param[in,out] crond    See @ref crond.
+ * @param[in]     clock_id Clock to read.
+ * @param[out]    ts       Store the current time here.
+ * @retval        0        Successfully read the clock.
+ * @retval        -1       Failed to read the clock.
  */
-static void
-crond_crontab_reparse(struct crond *const crond){
-  FILE *fp;
-  size_t len;
-  ssize_t read;
-  char *line;
+static int
+crond_clock(struct crond *const crond,
+            const clockid_t clock_id,
+            struct timespec *const ts){
+  int rc;
 
-  if(crond_crontab_has_changed(crond)){
-    crond_job_list_free(crond);
-    fp = fopen(crond->path_crontab, "r");
-    if(fp){
-      line = NULL;
-      len = 0;
-      while((read = getline(&line, &len, fp)) != -1){
-        /* Remove the newline character. */
-        if(read){
-          line[read - 1] = '\0';
-        }
-        crond_crontab_parse_line(crond, line);
-      }
-      free(line);
-      if(ferror(fp)){
-        crond_errx_noexit(crond, "ferror: %s", crond->path_crontab);
-        crond_job_list_free(crond);
-      }
-      else if(fclose(fp) != 0){
-        crond_errx_noexit(crond, "fclose: %s", crond->path_crontab);
-        crond_job_list_free(crond);
-      }
+  if((crond->flags & CROND_FLAG_WARP) && clock_id == CLOCK_REALTIME){
+    ts->tv_sec = crond->warp_now;
+    ts->tv_nsec = 0;
+    rc = 0;
+  }
+  else{
+    rc = clock_gettime(clock_id, ts);
+    if(rc != 0){
+      crond_errx_noexit(crond, "clock_gettime");
     }
   }
+  return rc;
 }
 
 /**
- * Check if a job should run based on the current time.
+ * Check if crond must leave the files of the crond on the real clock alone.
+ *
+ * A dry run with @ref crond::path_record and a replay with
+ * @ref CROND_FLAG_WARP still load the job state, ephemeral jobs, and at
+ * jobs, but they do not write or remove those files, do not write the
+ * metrics file, and do not adopt or hand off jobs.
  *
  * @param[in] crond See @ref crond.
- * @param[in] job   See @ref crond_job.
- * @retval    true  Run the job.
- * @retval    false Do not run the job.
+ * @retval    true  Do not change the files of the live crond.
+ * @retval    false crond runs the jobs on the real clock.
  */
 static bool
-crond_job_should_run(const struct crond *const crond,
-                     const struct crond_job *const job){
-  bool should_run;
-
-  if(job->weekday[crond->tm->tm_wday    ] &&
-     job->month  [crond->tm->tm_mon  - 1] &&
-     job->day    [crond->tm->tm_mday - 1] &&
-     job->hour   [crond->tm->tm_hour    ] &&
-     job->minute [crond->tm->tm_min     ]){
-    should_run = true;
-  }
-  else{
-    should_run = false;
-  }
-  return should_run;
+crond_readonly(const struct crond *const crond){
+  return crond->path_record != NULL || (crond->flags & CROND_FLAG_WARP);
 }
 
 /**
- * Wait for a process to exit.
+ * Get the UTC offset of the time zone in the TZ environment variable.
  *
- * @param[in] crond See @ref crond.
- * @param[in] pid   Process ID to wait for.
+ * @param[in]  t      Time to get the offset at.
+ * @param[out] offset Number of seconds to add to UTC to get the wall time.
+ * @retval     true   Got the offset.
+ * @retval     false  The time could not get converted.
  */
-static void
-crond_waitpid(const struct crond *const crond,
-              const pid_t pid){
-  while(waitpid(pid, NULL, 0) == -1){
-    if(errno != EINTR){
-      crond_verbose(crond, "waitpid");
-      exit(EXIT_FAILURE);
-    }
+static bool
+crond_zone_offset_tz(const time_t t,
+                     long *const offset){
+  struct tm tm;
+  bool ok;
+
+  ok = false;
+  if(localtime_r(&t, &tm)){
+    *offset = tm.tm_gmtoff;
+    ok = true;
   }
+  return ok;
 }
 
 /**
- * Reap zombie jobmon processes.
+ * Append an entry to @ref crond_zone::transition_list.
+ *
+ * @param[in,out] zone     See @ref crond_zone.
+ * @param[in,out] alloc_sz Number of entries allocated in the list.
+ * @param[in]     at       See @ref crond_zone_transition::at.
+ * @param[in]     offset   See @ref crond_zone_transition::offset.
+ * @retval        true     Appended the entry.
+ * @retval        false    Failed to allocate memory.
  */
-static void
-crond_reap_jobmon(void){
-  while(waitpid(-1, NULL, WNOHANG) > 0){
+static bool
+crond_zone_transition_add(struct crond_zone *const zone,
+                          size_t *const alloc_sz,
+                          const time_t at,
+                          const long offset){
+  struct crond_zone_transition *new_transition_list;
+  bool added;
+
+  added = true;
+  if(zone->num_transitions == *alloc_sz){
+    new_transition_list = crond_reallocarray(zone->transition_list,
+                                             *alloc_sz * 2 + 4,
+                                             sizeof(*zone->transition_list));
+    if(new_transition_list == NULL){
+      added = false;
+    }
+    else{
+      zone->transition_list = new_transition_list;
+      *alloc_sz = *alloc_sz * 2 + 4;
+    }
+  }
+  if(added){
+    zone->transition_list[zone->num_transitions].at = at;
+    zone->transition_list[zone->num_transitions].offset = offset;
+    zone->num_transitions += 1;
   }
+  return added;
 }
 
 /**
- * Write to a child process through a pipe.
+ * Sample the UTC offsets of the time zone in the TZ environment variable
+ * into @ref crond_zone::transition_list.
  *
- * This function closes the pipe file descriptors when no longer needed. It
- * will also exit if an error occurs at any point during this process.
+ * The offsets get sampled every hour, and each change gets narrowed down
+ * to the second it takes effect.
  *
- * @param[in] pipe_write File descriptors created by pipe(). This function will
- *                       close both file descriptors.
- * @param[in] data       Data to write through the pipe.
- * @param[in] datasz     Number of bytes in @p data.
+ * @param[in,out] zone  See @ref crond_zone.
+ * @param[in]     start First time to look up.
+ * @param[in]     end   Last time to look up.
+ * @retval        0     Looked up the offsets.
+ * @retval        -1    Failed to allocate memory or convert the time.
  */
-static void
-crond_fd_write(const int pipe_write[2],
-               const char *const data,
-               const size_t datasz){
-  size_t bytes_to_write;
-  ssize_t bytes_written;
+static int
+crond_zone_sample(struct crond_zone *const zone,
+                  const time_t start,
+                  const time_t end){
+  const time_t STEP_SEC = 60 * 60;
+  size_t alloc_sz;
+  time_t t;
+  time_t lo;
+  time_t mid;
+  long offset_prev;
+  long offset;
+  int rc;
 
-  if(close(pipe_write[0]) != 0){
-    exit(EXIT_FAILURE);
+  rc = -1;
+  free(zone->transition_list);
+  zone->transition_list = NULL;
+  zone->num_transitions = 0;
+  zone->transition_idx = 0;
+  alloc_sz = 0;
+  if(crond_zone_offset_tz(start, &offset_prev) &&
+     crond_zone_transition_add(zone, &alloc_sz, start, offset_prev)){
+    rc = 0;
+    for(t = start + STEP_SEC; rc == 0 && t < end + STEP_SEC; t += STEP_SEC){
+      if(crond_zone_offset_tz(t, &offset) == false){
+        rc = -1;
+      }
+      else if(offset != offset_prev){
+        lo = t - STEP_SEC;
+        while(t - lo > 1){
+          mid = lo + (t - lo) / 2;
+          if(crond_zone_offset_tz(mid, &offset) && offset == offset_prev){
+            lo = mid;
+          }
+          else{
+            t = mid;
+          }
+        }
+        crond_zone_offset_tz(t, &offset);
+        if(crond_zone_transition_add(zone, &alloc_sz, t, offset) == false){
+          rc = -1;
+        }
+        offset_prev = offset;
+      }
+    }
+  }
+  return rc;
+}
+
+/**
+ * Look up the UTC offsets of a time zone from @ref CROND_ZONE_SCAN_SEC
+ * seconds before @p start until @ref CROND_ZONE_SCAN_SEC seconds after
+ * @p now.
+ *
+ * This temporarily changes the TZ environment variable to the zone, so
+ * the time zone database gets read once per zone instead of once per job.
+ *
+ * @param[in,out] zone  See @ref crond_zone.
+ * @param[in]     start First time needed by the catch-up runs.
+ * @param[in]     now   Current time.
+ * @retval        0     Looked up the offsets.
+ * @retval        -1    Failed to allocate memory or convert the time.
+ */
+static int
+crond_zone_scan(struct crond_zone *const zone,
+                const time_t start,
+                const time_t now){
+  const char *env_tz;
+  char *tz_orig;
+  int rc;
+
+  rc = -1;
+  if(zone->env_tz == NULL){
+    rc = crond_zone_sample(zone,
+                           start - CROND_ZONE_SCAN_SEC,
+                           now + CROND_ZONE_SCAN_SEC);
+  }
+  else{
+    env_tz = getenv("TZ");
+    tz_orig = NULL;
+    if(env_tz == NULL || (tz_orig = strdup(env_tz)) != NULL){
+      if(setenv("TZ", &zone->env_tz[strlen("TZ=")], 1) == 0){
+        tzset();
+        rc = crond_zone_sample(zone,
+                               start - CROND_ZONE_SCAN_SEC,
+                               now + CROND_ZONE_SCAN_SEC);
+      }
+      if(tz_orig){
+        setenv("TZ", tz_orig, 1);
+      }
+      else{
+        unsetenv("TZ");
+      }
+      tzset();
+      free(tz_orig);
+    }
+  }
+  zone->until = now + CROND_ZONE_SCAN_SEC;
+  return rc;
+}
+
+/**
+ * Get the UTC offset of a time zone at a point in time.
+ *
+ * @param[in] zone See @ref crond_zone.
+ * @param[in] t    Time to get the offset at.
+ * @return         Number of seconds to add to UTC to get the wall time.
+ */
+static long
+crond_zone_offset(const struct crond_zone *const zone,
+                  const time_t t){
+  size_t lo;
+  size_t hi;
+  size_t mid;
+
+  lo = 0;
+  hi = zone->num_transitions;
+  while(hi - lo > 1){
+    mid = lo + (hi - lo) / 2;
+    if(zone->transition_list[mid].at <= t){
+      lo = mid;
+    }
+    else{
+      hi = mid;
+    }
+  }
+  return zone->transition_list[lo].offset;
+}
+
+/**
+ * Convert a wall time in a time zone to UTC.
+ *
+ * @param[in] zone See @ref crond_zone.
+ * @param[in] wall Wall time in the zone, as seconds since the epoch.
+ * @return         Time in UTC.
+ */
+static time_t
+crond_zone_wall_to_utc(const struct crond_zone *const zone,
+                       const time_t wall){
+  time_t utc;
+
+  utc = wall - crond_zone_offset(zone, wall);
+  return wall - crond_zone_offset(zone, utc);
+}
+
+/**
+ * Update the wall time and the daylight saving time state of a time zone.
+ *
+ * The offsets of the zone get looked up again once they run out, see
+ * @ref crond_zone_scan.
+ *
+ * @param[in]     crond See @ref crond.
+ * @param[in,out] zone  See @ref crond_zone.
+ */
+static void
+crond_zone_update(const struct crond *const crond,
+                  struct crond_zone *const zone){
+  const struct crond_zone_transition *transition;
+  time_t now;
+  time_t wall;
+  long delta;
+
+  now = crond->ts_now.tv_sec;
+  if(now >= zone->until &&
+     crond_zone_scan(zone, now - crond->catchup_lookback, now) != 0){
+    crond_fprintf_stderr("failed to look up time zone: %s",
+                         zone->env_tz ? zone->env_tz : "local");
+  }
+  zone->dst = CROND_DST_NONE;
+  if(zone->num_transitions){
+    while(zone->transition_idx + 1 < zone->num_transitions &&
+          zone->transition_list[zone->transition_idx + 1].at <= now){
+      zone->transition_idx += 1;
+    }
+    transition = &zone->transition_list[zone->transition_idx];
+    wall = now + transition->offset;
+    gmtime_r(&wall, &zone->tm);
+    if(zone->transition_idx){
+      delta = transition->offset - transition[-1].offset;
+      if(delta > 0 && now - transition->at < 60){
+        zone->dst = CROND_DST_GAP;
+        zone->gap_wall_start = transition->at + transition[-1].offset;
+        zone->gap_wall_end = zone->gap_wall_start + delta;
+      }
+      else if(delta < 0 && now - transition->at < -delta){
+        zone->dst = CROND_DST_OVERLAP;
+      }
+    }
+  }
+}
+
+/**
+ * Update the wall time and the daylight saving time state of
+ * @ref crond::zone_local and each time zone in @ref crond::zone_list.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_zone_list_update(struct crond *const crond){
+  size_t i;
+
+  crond_zone_update(crond, &crond->zone_local);
+  for(i = 0; i < crond->num_zones; i++){
+    crond_zone_update(crond, &crond->zone_list[i]);
+  }
+}
+
+/**
+ * Check if a time zone exists in the time zone database.
+ *
+ * @param[in] name  Time zone name, like Area/City.
+ * @retval    true  The zone exists.
+ * @retval    false The zone does not exist.
+ */
+static bool
+crond_zone_valid(const char *const name){
+  const char *dir;
+  char path[PATH_MAX];
+  struct stat sb;
+  int len;
+  bool valid;
+
+  valid = false;
+  dir = getenv("TZDIR");
+  if(dir == NULL){
+    dir = CROND_ZONE_DIR;
+  }
+  if(name[0] && name[0] != '/' && strstr(name, "..") == NULL){
+    len = snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if(len > 0 && (size_t)len < sizeof(path) &&
+       cron_stat(path, &sb) == 0 && S_ISREG(sb.st_mode)){
+      valid = true;
+    }
+  }
+  return valid;
+}
+
+/**
+ * Find or add a time zone in @ref crond::zone_list.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     name  Time zone name, like Area/City.
+ * @return              See @ref crond::zone_load.
+ */
+static size_t
+crond_zone_get(struct crond *const crond,
+               const char *const name){
+  struct crond_zone *new_zone_list;
+  struct crond_zone zone;
+  size_t zone_idx;
+  size_t env_tz_sz;
+  struct timespec now;
+
+  for(zone_idx = 0; zone_idx < crond->num_zones; zone_idx++){
+    if(strcmp(&crond->zone_list[zone_idx].env_tz[strlen("TZ=")], name) == 0){
+      break;
+    }
+  }
+  if(zone_idx < crond->num_zones){
+    zone_idx += 1;
+  }
+  else if(crond_zone_valid(name) == false){
+    crond_verbose(crond, "invalid time zone: %s", name);
+    zone_idx = SIZE_MAX;
+  }
+  else{
+    zone_idx = SIZE_MAX;
+    memset(&zone, 0, sizeof(zone));
+    if(si_add_size_t(strlen(name), sizeof("TZ="), &env_tz_sz) == 0 &&
+       (zone.env_tz = malloc(env_tz_sz)) != NULL){
+      strcpy(zone.env_tz, "TZ=");
+      strcat(zone.env_tz, name);
+      new_zone_list = NULL;
+      if(crond_clock(crond, CLOCK_REALTIME, &now) == 0 &&
+         crond_zone_scan(&zone,
+                         now.tv_sec - crond->catchup_lookback,
+                         now.tv_sec) == 0){
+        new_zone_list = crond_reallocarray(crond->zone_list,
+                                           crond->num_zones + 1,
+                                           sizeof(*crond->zone_list));
+      }
+      if(new_zone_list == NULL){
+        crond_fprintf_stderr("failed to look up time zone: %s", name);
+        free(zone.transition_list);
+        free(zone.env_tz);
+      }
+      else{
+        crond->zone_list = new_zone_list;
+        memcpy(&crond->zone_list[crond->num_zones], &zone, sizeof(zone));
+        crond->num_zones += 1;
+        zone_idx = crond->num_zones;
+      }
+    }
+  }
+  return zone_idx;
+}
+
+/**
+ * Free @ref crond::zone_list and @ref crond::zone_local.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_zone_list_free(struct crond *const crond){
+  size_t i;
+
+  free(crond->zone_local.transition_list);
+  for(i = 0; i < crond->num_zones; i++){
+    free(crond->zone_list[i].transition_list);
+    free(crond->zone_list[i].env_tz);
+  }
+  free(crond->zone_list);
+}
+
+/**
+ * Parse a CRON_TZ=Area/City line, which sets the time zone of the jobs on
+ * the following lines of the same crontab file.
+ *
+ * An empty zone switches back to the local time zone. The jobs after an
+ * unknown zone get skipped until the next CRON_TZ line.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     line  Line from the crontab file.
+ * @retval        true  The line sets the time zone.
+ * @retval        false The line does not set the time zone.
+ */
+static bool
+crond_zone_parse(struct crond *const crond,
+                 const char *const line){
+  const char *const STR_CRON_TZ = "CRON_TZ=";
+  char name[256];
+  size_t i;
+  size_t len;
+  bool is_zone;
+
+  i = 0;
+  crond_crontab_parse_blank(line, &i);
+  is_zone = strncmp(&line[i], STR_CRON_TZ, strlen(STR_CRON_TZ)) == 0;
+  if(is_zone){
+    i += strlen(STR_CRON_TZ);
+    len = strcspn(&line[i], " \t");
+    if(len == 0){
+      crond->zone_load = 0;
+    }
+    else if(len >= sizeof(name)){
+      crond_verbose(crond, "invalid time zone: %s", &line[i]);
+      crond->zone_load = SIZE_MAX;
+    }
+    else{
+      memcpy(name, &line[i], len);
+      name[len] = '\0';
+      crond->zone_load = crond_zone_get(crond, name);
+    }
+  }
+  return is_zone;
+}
+
+/**
+ * Get the time zone used to match the schedule of a job.
+ *
+ * @param[in] crond See @ref crond.
+ * @param[in] job   See @ref crond_job.
+ * @return          Zone of the job, or @ref crond::zone_local.
+ */
+static const struct crond_zone *
+crond_job_zone(const struct crond *const crond,
+               const struct crond_job *const job){
+  const struct crond_zone *zone;
+
+  if(job->zone){
+    zone = &crond->zone_list[job->zone - 1];
+  }
+  else{
+    zone = &crond->zone_local;
+  }
+  return zone;
+}
+
+/**
+ * Get the wall time used to match the schedule of a job.
+ *
+ * @param[in] crond See @ref crond.
+ * @param[in] job   See @ref crond_job.
+ * @return          Wall time in the zone of the job.
+ */
+static const struct tm *
+crond_job_tm(const struct crond *const crond,
+             const struct crond_job *const job){
+  const struct tm *tm;
+
+  if(job->zone){
+    tm = &crond_job_zone(crond, job)->tm;
+  }
+  else{
+    tm = crond->tm;
+  }
+  return tm;
+}
+
+/**
+ * Parse a single crontab line and append to the job list.
+ *
+ * CRON_TZ lines set the time zone of the jobs on the following lines, see
+ * @ref crond_zone_parse.
+ *
+ * @param[in,out] crond  See @ref crond.
+ * @param[in]     line   Crontab line to parse.
+ * @param[in]     uid    See @ref crond_job::uid.
+ * @param[in]     source See @ref crond_job::source.
+ */
+CRON_LINKAGE void
+crond_crontab_parse_line(struct crond *const crond,
+                         const char *line,
+                         const uid_t uid,
+                         const size_t source){
+  struct crond_job job;
+
+  if(crond_zone_parse(crond, line)){
+    /* CRON_TZ line. */
+  }
+  else if(crond_job_parse(crond, line, &job)){
+    if(crond->zone_load == SIZE_MAX){
+      crond_verbose(crond, "skipping job in invalid time zone: %s", line);
+      crond_job_free(&job);
+    }
+    else{
+      job.uid = uid;
+      job.source = source;
+      job.zone = crond->zone_load;
+      if(crond_job_append(crond, &job) == false){
+        crond_job_free(&job);
+      }
+    }
+  }
+}
+
+/**
+ * Get the number of microseconds elapsed between two times.
+ *
+ * @param[in] start Starting time.
+ * @param[in] end   Ending time.
+ * @return          Microseconds from @p start to @p end, or 0 if @p end
+ *                  occurs before @p start.
+ */
+static unsigned long
+crond_timespec_diff_usec(const struct timespec *const start,
+                         const struct timespec *const end){
+  unsigned long usec;
+
+  if(end->tv_sec < start->tv_sec ||
+     (end->tv_sec == start->tv_sec && end->tv_nsec < start->tv_nsec)){
+    usec = 0;
+  }
+  else{
+    usec = (unsigned long)(end->tv_sec - start->tv_sec) * 1000000UL;
+    usec += (unsigned long)(end->tv_nsec / 1000);
+    usec -= (unsigned long)(start->tv_nsec / 1000);
+  }
+  return usec;
+}
+
+/**
+ * Add an observation to a histogram.
+ *
+ * @param[in,out] hist See @ref crond_histogram.
+ * @param[in]     usec Observed duration in microseconds.
+ */
+static void
+crond_histogram_observe(struct crond_histogram *const hist,
+                        const unsigned long usec){
+  size_t i;
+
+  for(i = 0; i < CROND_HISTOGRAM_NUM_BUCKETS; i++){
+    if(usec <= g_histogram_bucket_usec[i]){
+      hist->bucket[i] += 1;
+    }
+  }
+  hist->count += 1;
+  hist->sum_usec += usec;
+}
+
+/**
+ * Write the buffered trace events to the trace file.
+ *
+ * The trace file gets opened with O_APPEND so that the events written by
+ * crond and the job monitor processes do not overwrite each other. Failing
+ * to write the trace does not stop crond.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_trace_flush(struct crond *const crond){
+  size_t offset;
+  ssize_t bytes_written;
+
+  offset = 0;
+  while(offset < crond->trace_buf_len){
+    bytes_written = write(crond->fd_trace,
+                          &crond->trace_buf[offset],
+                          crond->trace_buf_len - offset);
+    if(bytes_written < 0){
+      if(errno != EINTR){
+        crond_fprintf_stderr("failed to write trace: %s", crond->path_trace);
+        break;
+      }
+    }
+    else{
+      offset += (size_t)bytes_written;
+    }
+  }
+  crond->trace_buf_len = 0;
+}
+
+/**
+ * Append one character to the trace buffer.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     c     Character to append.
+ */
+static void
+crond_trace_putc(struct crond *const crond,
+                 const char c){
+  if(crond->trace_buf_len == CROND_TRACE_BUF_SZ){
+    crond_trace_flush(crond);
+  }
+  crond->trace_buf[crond->trace_buf_len] = c;
+  crond->trace_buf_len += 1;
+}
+
+/**
+ * Append a string to the trace buffer.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     str   String to append.
+ * @param[in]     json  Set to true to escape @p str as a JSON string.
+ */
+static void
+crond_trace_puts(struct crond *const crond,
+                 const char *const str,
+                 const bool json){
+  const char *c;
+  char hex[7];
+
+  for(c = str; *c; c++){
+    if(json && (*c == '\\' || *c == '"')){
+      crond_trace_putc(crond, '\\');
+      crond_trace_putc(crond, *c);
+    }
+    else if(json && (unsigned char)*c < 0x20){
+      sprintf(hex, "\\u%04x", (unsigned int)(unsigned char)*c);
+      crond_trace_puts(crond, hex, false);
+    }
+    else{
+      crond_trace_putc(crond, *c);
+    }
+  }
+}
+
+/**
+ * Append a formatted trace event to the trace buffer.
+ *
+ * Each event starts with a separator because the trace file begins with
+ * a metadata event written by @ref crond_trace_open.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     fmt   Format string used by vsnprintf.
+ */
+static void
+crond_trace_printf(struct crond *const crond,
+                   const char *const fmt, ...){
+  va_list ap;
+  char event[512];
+
+  va_start(ap, fmt);
+  vsnprintf(event, sizeof(event), fmt, ap);
+  va_end(ap);
+  crond_trace_puts(crond, ",\n", false);
+  crond_trace_puts(crond, event, false);
+}
+
+/**
+ * Convert a time to the microsecond timestamps used in the trace.
+ *
+ * @param[in] ts CLOCK_REALTIME time.
+ * @return       Microseconds since the Epoch.
+ */
+static unsigned long
+crond_trace_usec(const struct timespec *const ts){
+  return (unsigned long)ts->tv_sec * 1000000UL +
+         (unsigned long)(ts->tv_nsec / 1000);
+}
+
+/**
+ * Add a span to a job track in the trace.
+ *
+ * Job tracks use the job index plus one as the thread ID. Track 0 belongs
+ * to crond itself.
+ *
+ * @param[in,out] crond     See @ref crond.
+ * @param[in]     name      Phase name.
+ * @param[in]     job_idx   Index of the job in @ref crond::job_list.
+ * @param[in]     start     Time the phase started.
+ * @param[in]     end       Time the phase ended.
+ * @param[in]     arg_name  Name of the value shown with the span.
+ * @param[in]     arg_value Value shown with the span.
+ */
+static void
+crond_trace_span(struct crond *const crond,
+                 const char *const name,
+                 const size_t job_idx,
+                 const struct timespec *const start,
+                 const struct timespec *const end,
+                 const char *const arg_name,
+                 const long arg_value){
+  if(crond->trace_buf){
+    crond_trace_printf(crond,
+                       "{\"name\":\"%s\",\"cat\":\"job\",\"ph\":\"X\","
+                       "\"pid\":%ld,\"tid\":%lu,\"ts\":%lu,\"dur\":%lu,"
+                       "\"args\":{\"%s\":%ld}}",
+                       name,
+                       (long)crond->pid_trace,
+                       (unsigned long)job_idx + 1,
+                       crond_trace_usec(start),
+                       crond_timespec_diff_usec(start, end),
+                       arg_name,
+                       arg_value);
+  }
+}
+
+/**
+ * Add a sample of the number of running jobs to the trace.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_trace_running(struct crond *const crond){
+  struct timespec now;
+
+  if(crond->trace_buf && crond_clock(crond, CLOCK_REALTIME, &now) == 0){
+    crond_trace_printf(crond,
+                       "{\"name\":\"running\",\"ph\":\"C\",\"pid\":%ld,"
+                       "\"ts\":%lu,\"args\":{\"jobs\":%lu}}",
+                       (long)crond->pid_trace,
+                       crond_trace_usec(&now),
+                       (unsigned long)crond->num_running);
+  }
+}
+
+/**
+ * Name a job track in the trace after the job command.
+ *
+ * @param[in,out] crond   See @ref crond.
+ * @param[in]     job_idx Index of the job in @ref crond::job_list.
+ */
+static void
+crond_trace_job_name(struct crond *const crond,
+                     const size_t job_idx){
+  if(crond->trace_buf){
+    crond_trace_printf(crond,
+                       "{\"name\":\"thread_sort_index\",\"ph\":\"M\","
+                       "\"pid\":%ld,\"tid\":%lu,"
+                       "\"args\":{\"sort_index\":%lu}}",
+                       (long)crond->pid_trace,
+                       (unsigned long)job_idx + 1,
+                       (unsigned long)job_idx + 1);
+    crond_trace_printf(crond,
+                       "{\"name\":\"thread_name\",\"ph\":\"M\","
+                       "\"pid\":%ld,\"tid\":%lu,\"args\":{\"name\":\"",
+                       (long)crond->pid_trace,
+                       (unsigned long)job_idx + 1);
+    crond_trace_puts(crond, crond->job_list[job_idx].command, true);
+    crond_trace_puts(crond, "\"}}", false);
+  }
+}
+
+/**
+ * Name the job tracks in the trace after the job commands.
+ *
+ * This gets called after each reload because the job indexes can refer to
+ * different commands.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_trace_job_names(struct crond *const crond){
+  size_t i;
+
+  for(i = 0; i < crond->num_jobs; i++){
+    if(crond->job_list[i].command){
+      crond_trace_job_name(crond, i);
+    }
+  }
+}
+
+/**
+ * Write the buffered trace events if enough time has passed since the
+ * last write.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     now   Current time.
+ * @param[in]     force Set to true to skip the rate limit.
+ */
+static void
+crond_trace_update(struct crond *const crond,
+                   const struct timespec *const now,
+                   const bool force){
+  if(crond->trace_buf &&
+     crond->trace_buf_len &&
+     (force ||
+      now->tv_sec - crond->ts_trace.tv_sec >= CROND_TRACE_FLUSH_SEC ||
+      now->tv_sec < crond->ts_trace.tv_sec)){
+    crond_trace_flush(crond);
+    memcpy(&crond->ts_trace, now, sizeof(crond->ts_trace));
+  }
+}
+
+/**
+ * Create the trace file and write the trace header.
+ *
+ * The trace uses the JSON array format of the Chrome Trace Event Format.
+ * The closing bracket never gets written because job monitor processes
+ * can still append events after crond exits. Trace viewers accept the
+ * array without the closing bracket.
+ *
+ * After @ref crond_reexec, the new program image keeps appending to the
+ * inherited trace file.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_trace_open(struct crond *const crond){
+  const int oflag = O_CREAT | O_WRONLY | O_TRUNC | O_APPEND | O_CLOEXEC;
+  const mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+
+  if((crond->flags & CROND_FLAG_REEXEC) == 0){
+    crond->fd_trace = -1;
+  }
+  if(crond->path_trace && crond->status_code == 0){
+    crond->trace_buf = malloc(CROND_TRACE_BUF_SZ);
+    if(crond->trace_buf == NULL){
+      crond_errx_noexit(crond, "failed to allocate trace buffer");
+    }
+    else if(crond->fd_trace >= 0){
+      /* Inherited from crond_reexec with the header already written. */
+      crond->pid_trace = getpid();
+    }
+    else{
+      crond->fd_trace = open(crond->path_trace, oflag, mode);
+      if(crond->fd_trace < 0){
+        crond_errx_noexit(crond,
+                          "failed to create trace file: %s",
+                          crond->path_trace);
+        free(crond->trace_buf);
+        crond->trace_buf = NULL;
+      }
+      else{
+        crond->pid_trace = getpid();
+        sprintf(crond->trace_buf,
+                "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%ld,"
+                "\"args\":{\"name\":\"crond\"}}",
+                (long)crond->pid_trace);
+        crond->trace_buf_len = strlen(crond->trace_buf);
+        crond_trace_printf(crond,
+                           "{\"name\":\"thread_name\",\"ph\":\"M\","
+                           "\"pid\":%ld,\"tid\":0,"
+                           "\"args\":{\"name\":\"crond\"}}",
+                           (long)crond->pid_trace);
+        crond_trace_flush(crond);
+      }
+    }
+  }
+}
+
+/**
+ * Write the remaining trace events and close the trace file.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_trace_close(struct crond *const crond){
+  if(crond->trace_buf){
+    crond_trace_flush(crond);
+    if(close(crond->fd_trace) != 0){
+      crond_fprintf_stderr("failed to close trace: %s", crond->path_trace);
+    }
+    free(crond->trace_buf);
+    crond->trace_buf = NULL;
+  }
+}
+
+/**
+ * Check if a job should run based on the current time in its time zone.
+ *
+ * @param[in] crond See @ref crond.
+ * @param[in] job   See @ref crond_job.
+ * @retval    true  Run the job.
+ * @retval    false Do not run the job.
+ */
+static bool
+crond_job_should_run(const struct crond *const crond,
+                     const struct crond_job *const job){
+  const struct tm *tm;
+  bool should_run;
+
+  tm = crond_job_tm(crond, job);
+  if(cron_expr_match(&job->expr, tm)){
+    should_run = true;
+  }
+  else{
+    should_run = false;
+  }
+  return should_run;
+}
+
+/**
+ * Check if a job matches one of the wall times skipped when the clocks
+ * went forward.
+ *
+ * @param[in] job   See @ref crond_job.
+ * @param[in] zone  Zone of the job in the @ref CROND_DST_GAP state.
+ * @retval    true  The job got scheduled in the skipped wall times.
+ * @retval    false The job did not get scheduled in the skipped times.
+ */
+static bool
+crond_job_in_gap(const struct crond_job *const job,
+                 const struct crond_zone *const zone){
+  time_t wall;
+  struct tm tm;
+  bool in_gap;
+
+  in_gap = false;
+  for(wall = zone->gap_wall_start - zone->gap_wall_start % 60;
+      in_gap == false && wall < zone->gap_wall_end;
+      wall += 60){
+    if(gmtime_r(&wall, &tm) && cron_expr_match(&job->expr, &tm)){
+      in_gap = true;
+    }
+  }
+  return in_gap;
+}
+
+/**
+ * Check if a job runs at fixed wall times of the day.
+ *
+ * A job that matches every minute of the current hour, or some minute of
+ * every hour of the current day, runs at an interval instead.
+ *
+ * @param[in] crond See @ref crond.
+ * @param[in] job   See @ref crond_job.
+ * @retval    true  The job runs at fixed wall times.
+ * @retval    false The job runs every minute or every hour.
+ */
+static bool
+crond_job_fixed_time(const struct crond *const crond,
+                     const struct crond_job *const job){
+  struct tm tm;
+  int every_minute;
+  int every_hour;
+  int match;
+  int i;
+  int j;
+
+  memcpy(&tm, crond_job_tm(crond, job), sizeof(tm));
+  every_minute = 1;
+  for(i = 0; i < 60 && every_minute; i++){
+    tm.tm_min = i;
+    every_minute = cron_expr_match(&job->expr, &tm);
+  }
+  every_hour = 1;
+  for(i = 0; i < 24 && every_hour; i++){
+    tm.tm_hour = i;
+    match = 0;
+    for(j = 0; j < 60 && match == 0; j++){
+      tm.tm_min = j;
+      match = cron_expr_match(&job->expr, &tm);
+    }
+    every_hour = match;
+  }
+  return every_minute == 0 && every_hour == 0;
+}
+
+/**
+ * Check if a scheduled job is due in the current minute, taking the
+ * daylight saving time changes of its time zone into account.
+ *
+ * When the clocks go forward, the jobs scheduled at fixed wall times in
+ * the skipped wall times run once in the first minute after the change,
+ * unless @ref CROND_FLAG_DST_GAP_SKIP is set. When the clocks go back, the
+ * jobs scheduled at fixed wall times only run the first time a wall time
+ * occurs, unless @ref CROND_FLAG_DST_OVERLAP_TWICE is set. The jobs that
+ * run every minute or every hour just run in each real minute that
+ * matches, so they do not catch up on the skipped wall times and keep
+ * running in the repeated ones, see @ref crond_job_fixed_time.
+ *
+ * @param[in] crond See @ref crond.
+ * @param[in] job   See @ref crond_job.
+ * @retval    true  Run the job.
+ * @retval    false Do not run the job.
+ */
+static bool
+crond_job_due(const struct crond *const crond,
+              const struct crond_job *const job){
+  const struct crond_zone *zone;
+  bool due;
+
+  zone = crond_job_zone(crond, job);
+  due = crond_job_should_run(crond, job);
+  if(due &&
+     zone->dst == CROND_DST_OVERLAP &&
+     (crond->flags & CROND_FLAG_DST_OVERLAP_TWICE) == 0 &&
+     crond_job_fixed_time(crond, job)){
+    due = false;
+  }
+  else if(due == false &&
+          zone->dst == CROND_DST_GAP &&
+          (crond->flags & CROND_FLAG_DST_GAP_SKIP) == 0 &&
+          crond_job_fixed_time(crond, job)){
+    due = crond_job_in_gap(job, zone);
+  }
+  return due;
+}
+
+/**
+ * Calculate the next time a job will run after a given minute.
+ *
+ * The times are wall times in the zone of the job. Jobs in a zone set with
+ * CRON_TZ have their wall times stored as UTC, see @ref crond_job_tm.
+ *
+ * @param[in]  job     See @ref crond_job.
+ * @param[in]  tm_from Wall time to start searching from, exclusive.
+ * @param[out] tm_next Wall time of the next run.
+ * @retval     0       Found the next run within @ref CRON_EXPR_MAX_DAYS.
+ * @retval     -1      The job does not run within @ref CRON_EXPR_MAX_DAYS
+ *                     or the time could not get converted.
+ */
+static int
+crond_job_next(const struct crond_job *const job,
+               const struct tm *const tm_from,
+               struct tm *const tm_next){
+  time_t (*normalize)(struct tm *);
+  int rc;
+
+  normalize = job->zone ? timegm : mktime;
+  rc = cron_expr_next(&job->expr, tm_from, tm_next);
+  if(rc == 0 && normalize(tm_next) == (time_t)-1){
+    rc = -1;
+  }
+  return rc;
+}
+
+/**
+ * Compare two @ref crond_state entries by hash for qsort and bsearch.
+ *
+ * @param[in] a  See @ref crond_state.
+ * @param[in] b  See @ref crond_state.
+ * @retval    <0 @p a sorts before @p b.
+ * @retval    0  @p a and @p b have the same hash.
+ * @retval    >0 @p a sorts after @p b.
+ */
+static int
+crond_state_cmp(const void *const a,
+                const void *const b){
+  const struct crond_state *state_a;
+  const struct crond_state *state_b;
+  int cmp;
+
+  state_a = a;
+  state_b = b;
+  if(state_a->hash < state_b->hash){
+    cmp = -1;
+  }
+  else if(state_a->hash > state_b->hash){
+    cmp = 1;
+  }
+  else{
+    cmp = 0;
+  }
+  return cmp;
+}
+
+/**
+ * Find the persisted state of a job.
+ *
+ * @param[in] crond See @ref crond.
+ * @param[in] hash  See @ref crond_job::hash.
+ * @retval    crond_state* State of the job.
+ * @retval    NULL         The job does not have any state.
+ */
+static struct crond_state *
+crond_state_find(const struct crond *const crond,
+                 const unsigned long hash){
+  struct crond_state key;
+  struct crond_state *state;
+
+  state = NULL;
+  if(crond->num_state){
+    key.hash = hash;
+    state = bsearch(&key,
+                    crond->state_list,
+                    crond->num_state,
+                    sizeof(*crond->state_list),
+                    crond_state_cmp);
+  }
+  return state;
+}
+
+/**
+ * Check if a job missed a scheduled run while crond was not running.
+ *
+ * Only scheduled runs within @ref crond::catchup_lookback seconds and
+ * before the current minute count as missed. The current minute gets
+ * handled by @ref crond_job_list_run.
+ *
+ * @param[in] crond    See @ref crond.
+ * @param[in] job      See @ref crond_job.
+ * @param[in] last_run See @ref crond_state::last_run.
+ * @param[in] now      Current time.
+ * @retval    true     The job missed a run.
+ * @retval    false    The job did not miss a run.
+ */
+static bool
+crond_job_missed(const struct crond *const crond,
+                 const struct crond_job *const job,
+                 const time_t last_run,
+                 const time_t now){
+  const struct crond_zone *zone;
+  time_t from;
+  time_t wall;
+  time_t next;
+  struct tm tm_from;
+  struct tm tm_next;
+  bool missed;
+  bool ok;
+
+  missed = false;
+  from = last_run;
+  if(now - crond->catchup_lookback > from){
+    from = now - crond->catchup_lookback;
+  }
+  if(job->zone){
+    zone = &crond->zone_list[job->zone - 1];
+    wall = from + crond_zone_offset(zone, from);
+    ok = gmtime_r(&wall, &tm_from) != NULL;
+  }
+  else{
+    zone = NULL;
+    ok = localtime_r(&from, &tm_from) != NULL;
+  }
+  if(ok && crond_job_next(job, &tm_from, &tm_next) == 0){
+    if(zone){
+      next = timegm(&tm_next);
+      if(next != (time_t)-1){
+        next = crond_zone_wall_to_utc(zone, next);
+      }
+    }
+    else{
+      next = mktime(&tm_next);
+    }
+    if(next != (time_t)-1 && next < now - now % 60){
+      missed = true;
+    }
+  }
+  return missed;
+}
+
+/**
+ * Load the job state file.
+ *
+ * Each line contains the job hash in hexadecimal followed by the time of
+ * the last successful run. The jobs get checked for missed runs after the
+ * crontab gets loaded, see @ref crond_state_apply.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_state_load(struct crond *const crond){
+  FILE *fp;
+  char *line;
+  size_t len;
+  size_t alloc_sz;
+  struct crond_state *new_state_list;
+  struct crond_state state;
+  long last_run;
+
+  if(crond->path_state && crond->status_code == 0){
+    fp = fopen(crond->path_state, "r");
+    if(fp){
+      line = NULL;
+      len = 0;
+      alloc_sz = 0;
+      memset(&state, 0, sizeof(state));
+      while(getline(&line, &len, fp) != -1){
+        if(sscanf(line, "%lx %ld", &state.hash, &last_run) != 2){
+          continue;
+        }
+        if(crond->num_state == alloc_sz){
+          alloc_sz = alloc_sz * 2 + 16;
+          new_state_list = crond_reallocarray(crond->state_list,
+                                              alloc_sz,
+                                              sizeof(*crond->state_list));
+          if(new_state_list == NULL){
+            crond_errx_noexit(crond, "reallocarray");
+            break;
+          }
+          crond->state_list = new_state_list;
+        }
+        state.last_run = (time_t)last_run;
+        memcpy(&crond->state_list[crond->num_state], &state, sizeof(state));
+        crond->num_state += 1;
+      }
+      free(line);
+      fclose(fp);
+      if(crond->num_state){
+        qsort(crond->state_list,
+              crond->num_state,
+              sizeof(*crond->state_list),
+              crond_state_cmp);
+      }
+    }
+    crond->state_loaded = true;
+  }
+}
+
+/**
+ * Rebuild @ref crond::state_list after the job list changed.
+ *
+ * Jobs seen for the first time start with the current time as their last
+ * run. Right after @ref crond_state_load, jobs that missed a scheduled
+ * run get marked for catch-up, see @ref crond_catchup_run.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_state_apply(struct crond *const crond){
+  struct crond_state *new_state_list;
+  const struct crond_state *old;
+  struct crond_state *state;
+  const struct crond_job *job;
+  struct timespec now;
+  size_t num_state;
+  size_t num_unique;
+  size_t i;
+
+  if(crond->path_state && crond_clock(crond, CLOCK_REALTIME, &now) == 0){
+    new_state_list = NULL;
+    if(crond->num_jobs){
+      new_state_list = crond_reallocarray(NULL,
+                                          crond->num_jobs,
+                                          sizeof(*new_state_list));
+    }
+    if(crond->num_jobs && new_state_list == NULL){
+      crond_verbose(crond, "failed to allocate the job state");
+    }
+    else{
+      num_state = 0;
+      for(i = 0; i < crond->num_jobs; i++){
+        job = &crond->job_list[i];
+        if(job->command == NULL || job->hash == 0){
+          continue;
+        }
+        state = &new_state_list[num_state];
+        memset(state, 0, sizeof(*state));
+        state->hash = job->hash;
+        old = crond_state_find(crond, job->hash);
+        if(old){
+          state->last_run = old->last_run;
+          state->catchup = old->catchup;
+          if(crond->state_loaded &&
+             crond_job_missed(crond, job, old->last_run, now.tv_sec)){
+            crond_verbose(crond, "missed run: %s", job->command);
+            state->catchup = true;
+          }
+        }
+        else{
+          state->last_run = now.tv_sec;
+          crond->state_dirty = true;
+        }
+        num_state += 1;
+      }
+      if(num_state){
+        qsort(new_state_list,
+              num_state,
+              sizeof(*new_state_list),
+              crond_state_cmp);
+      }
+      /* Jobs with the same crontab line share their state. */
+      num_unique = 0;
+      for(i = 0; i < num_state; i++){
+        state = &new_state_list[num_unique];
+        if(num_unique > 0 && new_state_list[i].hash == state[-1].hash){
+          state[-1].catchup |= new_state_list[i].catchup;
+        }
+        else{
+          memmove(state, &new_state_list[i], sizeof(*state));
+          num_unique += 1;
+        }
+      }
+      num_state = num_unique;
+      crond->num_catchup = 0;
+      for(i = 0; i < num_state; i++){
+        if(new_state_list[i].catchup){
+          crond->num_catchup += 1;
+        }
+      }
+      if(num_state != crond->num_state){
+        crond->state_dirty = true;
+      }
+      free(crond->state_list);
+      crond->state_list = new_state_list;
+      crond->num_state = num_state;
+      crond->state_loaded = false;
+    }
+  }
+}
+
+/**
+ * Write @ref crond::state_list to the job state file if it changed.
+ *
+ * Dry runs and replays leave the file alone, see @ref crond_readonly.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_state_write(struct crond *const crond){
+  FILE *fp;
+  size_t i;
+  bool written;
+
+  if(crond->path_state &&
+     crond->state_dirty &&
+     crond_readonly(crond) == false){
+    written = false;
+    fp = fopen(crond->path_state_tmp, "w");
+    if(fp){
+      for(i = 0; i < crond->num_state; i++){
+        fprintf(fp,
+                "%08lx %ld\n",
+                crond->state_list[i].hash,
+                (long)crond->state_list[i].last_run);
+      }
+      if(ferror(fp)){
+        fclose(fp);
+      }
+      else if(fclose(fp) == 0 &&
+              rename(crond->path_state_tmp, crond->path_state) == 0){
+        written = true;
+      }
+    }
+    if(written == false){
+      crond_fprintf_stderr("failed to write job state: %s", crond->path_state);
+    }
+    crond->state_dirty = false;
+  }
+}
+
+/**
+ * Attach the detached running entries to the loaded jobs with the same
+ * crontab line.
+ *
+ * This keeps the number of running instances of each job across crontab
+ * reloads and crond restarts, see @ref crond_running::job_idx.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_running_attach(struct crond *const crond){
+  size_t run_i;
+  size_t job_i;
+  struct crond_running *running;
+  struct crond_job *job;
+
+  for(run_i = 0; run_i < crond->num_running; run_i++){
+    running = &crond->running_list[run_i];
+    if(running->job_idx != SIZE_MAX || running->hash == 0){
+      continue;
+    }
+    for(job_i = 0; job_i < crond->num_jobs; job_i++){
+      job = &crond->job_list[job_i];
+      if(job->command && job->hash == running->hash){
+        running->job_idx = job_i;
+        running->uid = job->uid;
+        job->num_running += 1;
+        break;
+      }
+    }
+  }
+}
+
+/**
+ * Find a user in a user list.
+ *
+ * @param[in] user_list See @ref crond::user_list.
+ * @param[in] num_users Number of users in @p user_list.
+ * @param[in] uid       User ID to find.
+ * @retval    crond_user* The user with @p uid.
+ * @retval    NULL        The user is not in @p user_list.
+ */
+static const struct crond_user *
+crond_user_find(const struct crond_user *const user_list,
+                const size_t num_users,
+                const uid_t uid){
+  size_t i;
+  const struct crond_user *user;
+
+  user = NULL;
+  for(i = 0; i < num_users && user == NULL; i++){
+    if(user_list[i].uid == uid){
+      user = &user_list[i];
+    }
+  }
+  return user;
+}
+
+/**
+ * Free a user list.
+ *
+ * @param[in,out] user_list See @ref crond::user_list.
+ * @param[in]     num_users Number of users in @p user_list.
+ */
+static void
+crond_user_list_free(struct crond_user *const user_list,
+                     const size_t num_users){
+  size_t i;
+
+  for(i = 0; i < num_users; i++){
+    free(user_list[i].name);
+    free(user_list[i].home);
+    free(user_list[i].path_crontab);
+  }
+  free(user_list);
+}
+
+/**
+ * Find the users with a crontab file in system mode.
+ *
+ * This goes through the password database and keeps each user whose home
+ * directory contains a crontab file owned by that user. Only the first
+ * user name of each user ID gets used.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @retval        true  A crontab file got added, changed, or removed since
+ *                      the last call.
+ * @retval        false No crontab file changed.
+ */
+static bool
+crond_user_list_load(struct crond *const crond){
+  struct crond_user *user_list;
+  struct crond_user *new_user_list;
+  struct crond_user *user;
+  size_t num_users;
+  const struct passwd *pwd;
+  char *path_crontab;
+  struct stat sb;
+  size_t i;
+  bool has_changed;
+
+  user_list = NULL;
+  num_users = 0;
+  setpwent();
+  while((pwd = getpwent()) != NULL){
+    if(crond_user_find(user_list, num_users, pwd->pw_uid)){
+      continue;
+    }
+    path_crontab = cron_get_path_crontab_home(pwd->pw_dir);
+    if(path_crontab == NULL){
+      crond_errx_noexit(crond, "failed to get crontab path");
+      break;
+    }
+    if(cron_stat(path_crontab, &sb) != 0 ||
+       !S_ISREG(sb.st_mode) ||
+       sb.st_uid != pwd->pw_uid){
+      free(path_crontab);
+      continue;
+    }
+    new_user_list = crond_reallocarray(user_list,
+                                       num_users + 1,
+                                       sizeof(*user_list));
+    if(new_user_list == NULL){
+      crond_errx_noexit(crond, "reallocarray");
+      free(path_crontab);
+      break;
+    }
+    user_list = new_user_list;
+    user = &user_list[num_users];
+    num_users += 1;
+    memset(user, 0, sizeof(*user));
+    user->path_crontab = path_crontab;
+    user->name = strdup(pwd->pw_name);
+    user->home = strdup(pwd->pw_dir);
+    memcpy(&user->mtime_crontab, &sb.st_mtim, sizeof(user->mtime_crontab));
+    user->uid = pwd->pw_uid;
+    user->gid = pwd->pw_gid;
+    if(user->name == NULL || user->home == NULL){
+      crond_errx_noexit(crond, "strdup");
+      break;
+    }
+  }
+  endpwent();
+  has_changed = num_users != crond->num_users;
+  for(i = 0; i < num_users && has_changed == false; i++){
+    if(user_list[i].uid != crond->user_list[i].uid ||
+       memcmp(&user_list[i].mtime_crontab,
+              &crond->user_list[i].mtime_crontab,
+              sizeof(user_list[i].mtime_crontab)) != 0){
+      has_changed = true;
+    }
+  }
+  crond_user_list_free(crond->user_list, crond->num_users);
+  crond->user_list = user_list;
+  crond->num_users = num_users;
+  return has_changed;
+}
+
+/**
+ * Open a crontab file for reading.
+ *
+ * The file gets opened without blocking and must be a regular file, so
+ * that a FIFO put in place of the crontab file cannot block crond. In
+ * system mode, the file must belong to the user that the jobs run as and
+ * symbolic links do not get followed. The checks use the opened file, so
+ * the file cannot get swapped after checking it.
+ *
+ * @param[in] crond        See @ref crond.
+ * @param[in] path_crontab Path to the crontab file.
+ * @param[in] uid          See @ref crond_job::uid.
+ * @retval    FILE*        Opened crontab file.
+ * @retval    NULL         The file does not exist or cannot get used.
+ */
+static FILE *
+crond_crontab_open(const struct crond *const crond,
+                   const char *const path_crontab,
+                   const uid_t uid){
+  int oflag;
+  int fd;
+  struct stat sb;
+  FILE *fp;
+
+  fp = NULL;
+  oflag = O_RDONLY | O_NONBLOCK | O_CLOEXEC;
+  if(crond->flags & CROND_FLAG_SYSTEM){
+    oflag |= O_NOFOLLOW;
+  }
+  fd = open(path_crontab, oflag, 0);
+  if(fd >= 0){
+    if(fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode)){
+      crond_fprintf_stderr("crontab not a regular file: %s", path_crontab);
+      close(fd);
+    }
+    else if((crond->flags & CROND_FLAG_SYSTEM) && sb.st_uid != uid){
+      crond_fprintf_stderr("crontab not owned by user: %s", path_crontab);
+      close(fd);
+    }
+    else{
+      fp = fdopen(fd, "r");
+      if(fp == NULL){
+        close(fd);
+      }
+    }
+  }
+  else if(errno == ELOOP){
+    crond_fprintf_stderr("crontab not a regular file: %s", path_crontab);
+  }
+  return fp;
+}
+
+/**
+ * Load the jobs from a crontab file.
+ *
+ * See @ref crond_crontab_open for the files that get loaded.
+ *
+ * @param[in,out] crond        See @ref crond.
+ * @param[in]     path_crontab Path to the crontab file.
+ * @param[in]     uid          See @ref crond_job::uid.
+ * @param[in]     source       See @ref crond_job::source.
+ */
+static void
+crond_crontab_load(struct crond *const crond,
+                   const char *const path_crontab,
+                   const uid_t uid,
+                   const size_t source){
+  FILE *fp;
+  size_t len;
+  ssize_t read;
+  char *line;
+
+  fp = crond_crontab_open(crond, path_crontab, uid);
+  if(fp){
+    crond_verbose(crond, "loading crontab: %s", path_crontab);
+    line = NULL;
+    len = 0;
+    crond->zone_load = 0;
+    while((read = getline(&line, &len, fp)) != -1){
+      /* Remove the newline character. */
+      if(read){
+        line[read - 1] = '\0';
+      }
+      crond_crontab_parse_line(crond, line, uid, source);
+    }
+    crond->zone_load = 0;
+    free(line);
+    if(ferror(fp)){
+      crond_errx_noexit(crond, "ferror: %s", path_crontab);
+      crond_job_list_free(crond, false, source);
+    }
+    else if(fclose(fp) != 0){
+      crond_errx_noexit(crond, "fclose: %s", path_crontab);
+      crond_job_list_free(crond, false, source);
+    }
+  }
+}
+
+/**
+ * Get the path of a file in the drop-in directory.
+ *
+ * @param[in] crond See @ref crond.
+ * @param[in] name  File name.
+ * @retval    char* Path to the file. The caller must free this when
+ *                  finished.
+ * @retval    NULL  Memory allocation failed.
+ */
+static char *
+crond_dropin_path(const struct crond *const crond,
+                  const char *const name){
+  size_t path_len;
+  char *path;
+
+  path = NULL;
+  if(si_add_size_t(strlen(crond->path_dropin),
+                   strlen(name) + 2,
+                   &path_len) == 0){
+    path = malloc(path_len);
+    if(path){
+      stpcpy(stpcpy(stpcpy(path, crond->path_dropin), "/"), name);
+    }
+  }
+  return path;
+}
+
+/**
+ * Find a file in @ref crond::source_list.
+ *
+ * @param[in] crond See @ref crond.
+ * @param[in] name  File name in the drop-in directory.
+ * @return          Index of the file in @ref crond::source_list, or
+ *                  SIZE_MAX if not found.
+ */
+static size_t
+crond_dropin_find(const struct crond *const crond,
+                  const char *const name){
+  size_t i;
+  size_t source_idx;
+
+  source_idx = SIZE_MAX;
+  for(i = 0; i < crond->num_sources && source_idx == SIZE_MAX; i++){
+    if(crond->source_list[i].name &&
+       strcmp(crond->source_list[i].name, name) == 0){
+      source_idx = i;
+    }
+  }
+  return source_idx;
+}
+
+/**
+ * Add a file to @ref crond::source_list, reusing an unused slot if
+ * possible.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     name  File name in the drop-in directory.
+ * @return              Index of the file in @ref crond::source_list, or
+ *                      SIZE_MAX if memory allocation failed.
+ */
+static size_t
+crond_dropin_add(struct crond *const crond,
+                 const char *const name){
+  struct crond_source *new_source_list;
+  size_t source_idx;
+  char *name_copy;
+
+  source_idx = SIZE_MAX;
+  name_copy = strdup(name);
+  if(name_copy){
+    for(source_idx = 0; source_idx < crond->num_sources; source_idx++){
+      if(crond->source_list[source_idx].name == NULL){
+        break;
+      }
+    }
+    if(source_idx == crond->num_sources){
+      new_source_list = crond_reallocarray(crond->source_list,
+                                           crond->num_sources + 1,
+                                           sizeof(*crond->source_list));
+      if(new_source_list == NULL){
+        source_idx = SIZE_MAX;
+      }
+      else{
+        crond->source_list = new_source_list;
+        crond->num_sources += 1;
+      }
+    }
+  }
+  if(source_idx == SIZE_MAX){
+    free(name_copy);
+  }
+  else{
+    memset(&crond->source_list[source_idx],
+           0,
+           sizeof(*crond->source_list));
+    crond->source_list[source_idx].name = name_copy;
+  }
+  return source_idx;
+}
+
+/**
+ * Check which files in the drop-in directory got added, changed, or
+ * removed.
+ *
+ * Files starting with a dot or ending with a tilde get skipped, so that
+ * editor and package manager backup files do not get loaded. The changed
+ * files get marked with @ref crond_source::dirty and reloaded by
+ * @ref crond_dropin_load.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     force Set to true to reload every file.
+ * @retval        true  At least one file needs to get reloaded.
+ * @retval        false No file changed.
+ */
+static bool
+crond_dropin_scan(struct crond *const crond,
+                  const bool force){
+  DIR *dir;
+  const struct dirent *ent;
+  struct crond_source *source;
+  size_t source_idx;
+  size_t name_len;
+  char *path;
+  struct stat sb;
+  size_t i;
+  bool has_changed;
+
+  for(i = 0; i < crond->num_sources; i++){
+    crond->source_list[i].seen = false;
+  }
+  dir = NULL;
+  if(crond->path_dropin){
+    dir = opendir(crond->path_dropin);
+  }
+  if(dir == NULL){
+    if(crond->wd_dropin >= 0){
+      inotify_rm_watch(crond->fd_inotify, crond->wd_dropin);
+      crond->wd_dropin = -1;
+    }
+  }
+  else{
+    if(crond->fd_inotify >= 0 && crond->wd_dropin < 0){
+      crond->wd_dropin = inotify_add_watch(crond->fd_inotify,
+                                           crond->path_dropin,
+                                           IN_CLOSE_WRITE |
+                                           IN_CREATE      |
+                                           IN_DELETE      |
+                                           IN_MOVED_FROM  |
+                                           IN_MOVED_TO);
+    }
+    while((ent = readdir(dir)) != NULL){
+      name_len = strlen(ent->d_name);
+      if(ent->d_name[0] == '.' || ent->d_name[name_len - 1] == '~'){
+        continue;
+      }
+      path = crond_dropin_path(crond, ent->d_name);
+      if(path == NULL){
+        crond_errx_noexit(crond, "failed to get drop-in path");
+        break;
+      }
+      if(cron_stat(path, &sb) == 0 && S_ISREG(sb.st_mode)){
+        source_idx = crond_dropin_find(crond, ent->d_name);
+        if(source_idx == SIZE_MAX){
+          source_idx = crond_dropin_add(crond, ent->d_name);
+          if(source_idx == SIZE_MAX){
+            crond_errx_noexit(crond, "reallocarray");
+            free(path);
+            break;
+          }
+          crond->source_list[source_idx].dirty = true;
+        }
+        source = &crond->source_list[source_idx];
+        if(memcmp(&source->mtime, &sb.st_mtim, sizeof(source->mtime)) != 0){
+          memcpy(&source->mtime, &sb.st_mtim, sizeof(source->mtime));
+          source->dirty = true;
+        }
+        source->seen = true;
+      }
+      free(path);
+    }
+    closedir(dir);
+  }
+  has_changed = false;
+  for(i = 0; i < crond->num_sources; i++){
+    source = &crond->source_list[i];
+    if(source->name){
+      if(source->seen == false){
+        free(source->name);
+        source->name = NULL;
+        source->dirty = true;
+      }
+      else if(force){
+        source->dirty = true;
+      }
+    }
+    if(source->dirty){
+      has_changed = true;
+    }
+  }
+  return has_changed;
+}
+
+/**
+ * Reload the files in the drop-in directory marked by
+ * @ref crond_dropin_scan.
+ *
+ * The jobs of the other files stay loaded.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_dropin_load(struct crond *const crond){
+  size_t i;
+  struct crond_source *source;
+  char *path;
+
+  for(i = 0; i < crond->num_sources; i++){
+    source = &crond->source_list[i];
+    if(source->dirty){
+      source->dirty = false;
+      crond_job_list_free(crond, false, i + 1);
+      if(source->name){
+        path = crond_dropin_path(crond, source->name);
+        if(path == NULL){
+          crond_errx_noexit(crond, "failed to get drop-in path");
+        }
+        else{
+          /* The drop-in directory belongs to the crond user. */
+          crond_crontab_load(crond, path, 0, i + 1);
+          free(path);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Get the name of the file that a job got loaded from.
+ *
+ * @param[in] crond See @ref crond.
+ * @param[in] job   See @ref crond_job.
+ * @return          File name in the drop-in directory, "crontab" for the
+ *                  crontab file, or "at"/"ephemeral" for the jobs added
+ *                  through the control socket.
+ */
+static const char *
+crond_job_source_name(const struct crond *const crond,
+                      const struct crond_job *const job){
+  const char *name;
+
+  if(job->at_time){
+    name = "at";
+  }
+  else if(job->ephemeral){
+    name = "ephemeral";
+  }
+  else if(job->source){
+    name = crond->source_list[job->source - 1].name;
+  }
+  else{
+    name = "crontab";
+  }
+  return name;
+}
+
+/**
+ * Get the number of bytes allocated for a string.
+ *
+ * @param[in] str String, or NULL.
+ * @return        Length of @p str including the null-terminator, or 0 if
+ *                @p str is NULL.
+ */
+static size_t
+crond_mem_str(const char *const str){
+  size_t sz;
+
+  sz = 0;
+  if(str){
+    sz = strlen(str) + 1;
+  }
+  return sz;
+}
+
+/**
+ * Count the bytes of memory used by the loaded jobs.
+ *
+ * This walks the job list and the lists that index it, so it takes time
+ * proportional to the number of jobs.
+ *
+ * @param[in]  crond See @ref crond.
+ * @param[out] mem   See @ref crond_mem.
+ */
+CRON_LINKAGE void
+crond_mem_count(const struct crond *const crond,
+                struct crond_mem *const mem){
+  const struct crond_job *job;
+  const struct crond_zone *zone;
+  size_t i;
+
+  memset(mem, 0, sizeof(*mem));
+  for(i = 0; i < crond->num_jobs; i++){
+    job = &crond->job_list[i];
+    if(job->command){
+      mem->jobs += sizeof(*job) - sizeof(job->expr);
+      mem->schedules += sizeof(job->expr);
+      mem->commands += crond_mem_str(job->command);
+      mem->stdin_lines += job->stdin_lines_len;
+    }
+    else{
+      mem->unused += sizeof(*job);
+    }
+  }
+  mem->environment = crond->num_zones * sizeof(*crond->zone_list) +
+                     crond->zone_local.num_transitions *
+                     sizeof(*crond->zone_local.transition_list);
+  for(i = 0; i < crond->num_zones; i++){
+    zone = &crond->zone_list[i];
+    mem->environment += crond_mem_str(zone->env_tz) +
+                        zone->num_transitions *
+                        sizeof(*zone->transition_list);
+  }
+  mem->indexes = crond->owner_max * sizeof(*crond->owner_list) +
+                 crond->num_state * sizeof(*crond->state_list) +
+                 crond->at_queue_sz * sizeof(*crond->at_queue) +
+                 crond->num_running * sizeof(*crond->running_list) +
+                 crond->num_sources * sizeof(*crond->source_list) +
+                 crond->num_users * sizeof(*crond->user_list);
+  for(i = 0; i < crond->num_sources; i++){
+    mem->indexes += crond_mem_str(crond->source_list[i].name);
+  }
+  for(i = 0; i < crond->num_users; i++){
+    mem->indexes += crond_mem_str(crond->user_list[i].name) +
+                    crond_mem_str(crond->user_list[i].home) +
+                    crond_mem_str(crond->user_list[i].path_crontab);
+  }
+}
+
+/**
+ * Print the memory used by the loaded jobs in verbose mode.
+ *
+ * @param[in] crond See @ref crond.
+ */
+static void
+crond_mem_verbose(const struct crond *const crond){
+  struct crond_mem mem;
+
+  if(crond->flags & CROND_FLAG_VERBOSE){
+    crond_mem_count(crond, &mem);
+    crond_verbose(crond,
+                  "memory of %lu jobs: jobs %lu, schedules %lu, commands %lu, "
+                  "stdin %lu, environment %lu, indexes %lu, unused %lu bytes",
+                  (unsigned long)(crond->num_jobs - crond->num_job_free),
+                  (unsigned long)mem.jobs,
+                  (unsigned long)mem.schedules,
+                  (unsigned long)mem.commands,
+                  (unsigned long)mem.stdin_lines,
+                  (unsigned long)mem.environment,
+                  (unsigned long)mem.indexes,
+                  (unsigned long)mem.unused);
+  }
+}
+
+/**
+ * Check if the crontab or drop-in files have changed and reparse the files
+ * that did.
+ *
+ * In system mode, the crontab files of all users get reloaded when any of
+ * them changed.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     force Set to true to reparse even if the crontab has not
+ *                      changed.
+ */
+static void
+crond_crontab_reparse(struct crond *const crond,
+                      const bool force){
+  bool has_changed;
+  bool dropin_changed;
+  size_t i;
+  struct timespec ts_start;
+  struct timespec ts_end;
+
+  if(crond->flags & CROND_FLAG_SYSTEM){
+    has_changed = crond_user_list_load(crond);
+  }
+  else{
+    has_changed = crond_crontab_has_changed(crond);
+  }
+  if(force){
+    has_changed = true;
+  }
+  dropin_changed = crond_dropin_scan(crond, force);
+  if((has_changed || dropin_changed) &&
+     crond_clock(crond, CLOCK_MONOTONIC, &ts_start) == 0){
+    CROND_PROBE1(reparse_start, crond_probe_ts());
+    if(has_changed){
+      crond_job_list_free(crond, false, 0);
+      if(crond->flags & CROND_FLAG_SYSTEM){
+        for(i = 0; i < crond->num_users && crond->status_code == 0; i++){
+          crond_crontab_load(crond,
+                             crond->user_list[i].path_crontab,
+                             crond->user_list[i].uid,
+                             0);
+        }
+      }
+      else{
+        crond_crontab_load(crond, crond->path_crontab, 0, 0);
+      }
+    }
+    crond_dropin_load(crond);
+    CROND_PROBE2(reparse_end, crond_probe_ts(), (long)crond->num_jobs);
+    if(crond_clock(crond, CLOCK_MONOTONIC, &ts_end) == 0){
+      crond_histogram_observe(&crond->hist_reload,
+                              crond_timespec_diff_usec(&ts_start, &ts_end));
+    }
+    crond->metrics_dirty = true;
+    crond_trace_job_names(crond);
+    crond_state_apply(crond);
+    crond_running_attach(crond);
+    crond_mem_verbose(crond);
+  }
+}
+
+/**
+ * Wait for a process to exit.
+ *
+ * @param[in] crond See @ref crond.
+ * @param[in] pid   Process ID to wait for.
+ * @return          Process status returned by waitpid.
+ */
+static int
+crond_waitpid(const struct crond *const crond,
+              const pid_t pid){
+  int status;
+
+  while(waitpid(pid, &status, 0) == -1){
+    if(errno != EINTR){
+      crond_verbose(crond, "waitpid");
+      exit(EXIT_FAILURE);
+    }
+  }
+  return status;
+}
+
+/**
+ * Convert a process status from waitpid into a shell-style exit code.
+ *
+ * @param[in] status Process status returned by waitpid.
+ * @return           Exit status of the process, or 128 plus the signal
+ *                   number if a signal terminated the process.
+ */
+static int
+crond_exit_code(const int status){
+  int exit_code;
+
+  if(WIFEXITED(status)){
+    exit_code = WEXITSTATUS(status);
+  }
+  else if(WIFSIGNALED(status)){
+    exit_code = 128 + WTERMSIG(status);
+  }
+  else{
+    exit_code = EXIT_FAILURE;
+  }
+  return exit_code;
+}
+
+/**
+ * Append a suffix to a file path.
+ *
+ * @param[in] path   File path, or NULL.
+ * @param[in] suffix Append this string to @p path.
+ * @retval    char*  New path. The caller must free this when finished.
+ * @retval    NULL   @p path is NULL or memory allocation failed.
+ */
+static char *
+crond_get_path_suffix(const char *const path,
+                      const char *const suffix){
+  char *path_suffix;
+  size_t path_len;
+  size_t suffix_len;
+  size_t alloc_len;
+  char *copy_ptr;
+
+  path_suffix = NULL;
+  if(path){
+    path_len = strlen(path);
+    suffix_len = strlen(suffix);
+    if(si_add_size_t(path_len,
+                     suffix_len + 1,
+                     &alloc_len) == 0){
+      path_suffix = malloc(alloc_len);
+      if(path_suffix){
+        copy_ptr = stpcpy(path_suffix, path);
+        stpcpy(copy_ptr, suffix);
+      }
+    }
+  }
+  return path_suffix;
+}
+
+/**
+ * Get the path of the spool file of an at job.
+ *
+ * @param[in] crond  See @ref crond.
+ * @param[in] when   See @ref crond_at::when.
+ * @param[in] serial See @ref crond_at::serial.
+ * @param[in] suffix Append this string to the file name.
+ * @retval    char*  File path. The caller must free this when finished.
+ * @retval    NULL   Memory allocation failed.
+ */
+static char *
+crond_at_path(const struct crond *const crond,
+              const time_t when,
+              const unsigned long serial,
+              const char *const suffix){
+  char name[64];
+  char *path_name;
+  char *path;
+
+  sprintf(name, "/%ld.%lu", (long)when, serial);
+  path_name = crond_get_path_suffix(crond->path_at, name);
+  path = crond_get_path_suffix(path_name, suffix);
+  free(path_name);
+  return path;
+}
+
+/**
+ * Remove an at job that completed from the job list and the spool
+ * directory.
+ *
+ * @param[in,out] crond   See @ref crond.
+ * @param[in]     job_idx Index of the job in @ref crond::job_list.
+ */
+static void
+crond_at_done(struct crond *const crond,
+              const size_t job_idx){
+  const struct crond_job *job;
+  char *path;
+
+  job = &crond->job_list[job_idx];
+  if(crond_readonly(crond) == false){
+    path = crond_at_path(crond, job->at_time, job->serial, "");
+    if(path == NULL || remove(path) != 0){
+      crond_verbose(crond, "failed to remove at job: %s", job->command);
+    }
+    free(path);
+  }
+  crond_job_remove(crond, job_idx);
+  crond->metrics_dirty = true;
+}
+
+/**
+ * Start tracking a new job monitor process.
+ *
+ * @param[in,out] crond   See @ref crond.
+ * @param[in]     job_idx Index of the job in @ref crond::job_list.
+ * @param[in]     pid     Process ID of the job monitor.
+ */
+static void
+crond_running_add(struct crond *const crond,
+                  const size_t job_idx,
+                  const pid_t pid){
+  struct crond_running *new_running_list;
+  struct crond_running *running;
+
+  new_running_list = crond_reallocarray(crond->running_list,
+                                        crond->num_running + 1,
+                                        sizeof(*crond->running_list));
+  if(new_running_list == NULL){
+    crond_errx_noexit(crond, "reallocarray");
+  }
+  else{
+    crond->running_list = new_running_list;
+    running = &crond->running_list[crond->num_running];
+    memset(running, 0, sizeof(*running));
+    running->job_idx = job_idx;
+    running->hash = crond->job_list[job_idx].hash;
+    running->uid = crond->job_list[job_idx].uid;
+    running->pid = pid;
+    running->start_sec = crond->ts_now.tv_sec;
+    crond_clock(crond, CLOCK_MONOTONIC, &running->start);
+    crond->num_running += 1;
+    crond->job_list[job_idx].num_running += 1;
+  }
+}
+
+/**
+ * Remove an entry from @ref crond::running_list.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     idx   Index of the entry in @ref crond::running_list.
+ */
+static void
+crond_running_delete(struct crond *const crond,
+                     const size_t idx){
+  struct crond_running *running;
+
+  running = &crond->running_list[idx];
+  if(running->job_idx != SIZE_MAX){
+    crond->job_list[running->job_idx].num_running -= 1;
+  }
+  if(running->adopted){
+    crond->num_adopted -= 1;
+  }
+  crond->num_running -= 1;
+  memmove(running,
+          &crond->running_list[crond->num_running],
+          sizeof(*running));
+  crond_trace_running(crond);
+}
+
+/**
+ * Stop tracking a job monitor process that exited and update the job
+ * statistics.
+ *
+ * At jobs get removed once their last run completes, see
+ * @ref crond_at_done.
+ *
+ * @param[in,out] crond  See @ref crond.
+ * @param[in]     pid    Process ID of the job monitor.
+ * @param[in]     status Process status returned by waitpid.
+ */
+static void
+crond_running_remove(struct crond *const crond,
+                     const pid_t pid,
+                     const int status){
+  size_t i;
+  struct crond_running *running;
+  struct crond_job *job;
+  struct timespec ts_end;
+  struct crond_state *state;
+  size_t job_idx_at;
+
+  job_idx_at = SIZE_MAX;
+  for(i = 0; i < crond->num_running; i++){
+    running = &crond->running_list[i];
+    if(running->pid == pid){
+      CROND_PROBE4(job_reap,
+                   (long)running->job_idx,
+                   (long)pid,
+                   crond_exit_code(status),
+                   crond_probe_ts());
+      if(running->job_idx != SIZE_MAX){
+        job = &crond->job_list[running->job_idx];
+        job->last_exit_code = crond_exit_code(status);
+        if(job->last_exit_code != 0){
+          job->num_failures += 1;
+        }
+        else if(crond->path_state &&
+                (state = crond_state_find(crond, job->hash)) != NULL){
+          state->last_run = running->start_sec;
+          crond->state_dirty = true;
+        }
+        if(crond_clock(crond, CLOCK_MONOTONIC, &ts_end) == 0){
+          job->last_duration_ms = crond_timespec_diff_usec(&running->start,
+                                                           &ts_end) / 1000;
+        }
+        crond->metrics_dirty = true;
+        if(job->at_time){
+          job_idx_at = running->job_idx;
+        }
+      }
+      crond_running_delete(crond, i);
+      break;
+    }
+  }
+  if(job_idx_at != SIZE_MAX && crond->job_list[job_idx_at].num_running == 0){
+    crond_at_done(crond, job_idx_at);
+  }
+}
+
+/**
+ * Reap zombie jobmon processes.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_reap_jobmon(struct crond *const crond){
+  pid_t pid;
+  int status;
+
+  while((pid = waitpid(-1, &status, WNOHANG)) > 0){
+    crond_running_remove(crond, pid, status);
+  }
+}
+
+/**
+ * Get the time when a process started.
+ *
+ * @param[in] pid Process ID.
+ * @return        Start time in clock ticks after boot from /proc, or 0 if
+ *                unavailable.
+ */
+static unsigned long
+crond_proc_start(const pid_t pid){
+  char path[64];
+  char buf[1024];
+  FILE *fp;
+  size_t len;
+  const char *fields;
+  unsigned long proc_start;
+
+  proc_start = 0;
+  sprintf(path, "/proc/%ld/stat", (long)pid);
+  fp = fopen(path, "r");
+  if(fp){
+    len = fread(buf, 1, sizeof(buf) - 1, fp);
+    buf[len] = '\0';
+    /* The command name can contain spaces and parentheses. */
+    fields = strrchr(buf, ')');
+    if(fields == NULL ||
+       sscanf(fields + 1,
+              " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u"
+              " %*d %*d %*d %*d %*d %*d %lu",
+              &proc_start) != 1){
+      proc_start = 0;
+    }
+    fclose(fp);
+  }
+  return proc_start;
+}
+
+/**
+ * Check if a job monitor process handed off by a previous crond process
+ * still runs.
+ *
+ * A process with the same ID that started at a different time reused the
+ * process ID of the job monitor, so it does not count.
+ *
+ * @param[in] pid        Process ID of the job monitor.
+ * @param[in] proc_start See @ref crond_running::proc_start.
+ * @retval    true       The job monitor still runs.
+ * @retval    false      The job monitor exited.
+ */
+static bool
+crond_proc_running(const pid_t pid,
+                   const unsigned long proc_start){
+  bool running;
+
+  if(kill(pid, 0) != 0 && errno != EPERM){
+    running = false;
+  }
+  else if(proc_start != 0 && crond_proc_start(pid) != proc_start){
+    running = false;
+  }
+  else{
+    running = true;
+  }
+  return running;
+}
+
+/**
+ * Start tracking a job monitor process started by a previous crond
+ * process.
+ *
+ * @param[in,out] crond      See @ref crond.
+ * @param[in]     pid        Process ID of the job monitor.
+ * @param[in]     job_idx    See @ref crond_running::job_idx.
+ * @param[in]     hash       See @ref crond_running::hash.
+ * @param[in]     start_sec   See @ref crond_running::start_sec.
+ * @param[in]     proc_start See @ref crond_running::proc_start.
+ * @param[in]     adopted    See @ref crond_running::adopted.
+ */
+static void
+crond_running_insert(struct crond *const crond,
+                     const pid_t pid,
+                     const size_t job_idx,
+                     const unsigned long hash,
+                     const time_t start_sec,
+                     const unsigned long proc_start,
+                     const bool adopted){
+  struct crond_running *new_running_list;
+  struct crond_running *running;
+
+  new_running_list = crond_reallocarray(crond->running_list,
+                                        crond->num_running + 1,
+                                        sizeof(*crond->running_list));
+  if(new_running_list == NULL){
+    crond_errx_noexit(crond, "reallocarray");
+  }
+  else{
+    crond->running_list = new_running_list;
+    running = &crond->running_list[crond->num_running];
+    memset(running, 0, sizeof(*running));
+    running->job_idx = job_idx;
+    running->hash = hash;
+    running->pid = pid;
+    running->start_sec = start_sec;
+    running->proc_start = proc_start;
+    running->adopted = adopted;
+    crond_clock(crond, CLOCK_MONOTONIC, &running->start);
+    crond->num_running += 1;
+    if(job_idx != SIZE_MAX){
+      running->uid = crond->job_list[job_idx].uid;
+      crond->job_list[job_idx].num_running += 1;
+    }
+    if(adopted){
+      crond->num_adopted += 1;
+    }
+  }
+}
+
+/**
+ * Stop tracking the adopted job monitor processes that exited.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_running_poll(struct crond *const crond){
+  size_t i;
+  const struct crond_running *running;
+
+  i = crond->num_running;
+  while(crond->num_adopted && i > 0){
+    i -= 1;
+    running = &crond->running_list[i];
+    if(running->adopted &&
+       crond_proc_running(running->pid, running->proc_start) == false){
+      crond_verbose(crond, "adopted job exited: %ld", (long)running->pid);
+      crond_running_delete(crond, i);
+    }
+  }
+}
+
+/**
+ * Adopt the job monitor processes handed off by a previous crond process.
+ *
+ * The handoff file gets removed after loading it. The adopted processes
+ * get attached to their jobs once the crontab has been loaded, see
+ * @ref crond_running_attach.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_handoff_load(struct crond *const crond){
+  FILE *fp;
+  char *line;
+  size_t len;
+  long pid;
+  unsigned long hash;
+  long start_sec;
+  unsigned long proc_start;
+
+  if(crond->path_handoff && crond->status_code == 0){
+    fp = fopen(crond->path_handoff, "r");
+    if(fp){
+      line = NULL;
+      len = 0;
+      while(getline(&line, &len, fp) != -1){
+        proc_start = 0;
+        if(sscanf(line,
+                  "%ld %lx %ld %lu",
+                  &pid,
+                  &hash,
+                  &start_sec,
+                  &proc_start) >= 3 &&
+           pid > 0 &&
+           crond_proc_running((pid_t)pid, proc_start)){
+          crond_verbose(crond, "adopting job: %ld", pid);
+          crond_running_insert(crond,
+                               (pid_t)pid,
+                               SIZE_MAX,
+                               hash,
+                               (time_t)start_sec,
+                               proc_start,
+                               true);
+        }
+      }
+      free(line);
+      fclose(fp);
+      if(remove(crond->path_handoff) != 0){
+        crond_fprintf_stderr("failed to remove: %s", crond->path_handoff);
+      }
+    }
+  }
+}
+
+/**
+ * List the job monitor processes still running in the handoff file.
+ *
+ * Each line contains the process ID, job hash, start time, and
+ * @ref crond_running::proc_start.
+ *
+ * @param[in] crond See @ref crond.
+ */
+static void
+crond_handoff_write(const struct crond *const crond){
+  FILE *fp;
+  size_t i;
+  const struct crond_running *running;
+  unsigned long proc_start;
+  bool written;
+
+  written = false;
+  fp = fopen(crond->path_handoff_tmp, "w");
+  if(fp){
+    for(i = 0; i < crond->num_running; i++){
+      running = &crond->running_list[i];
+      proc_start = running->proc_start;
+      if(proc_start == 0){
+        proc_start = crond_proc_start(running->pid);
+      }
+      fprintf(fp,
+              "%ld %08lx %ld %lu\n",
+              (long)running->pid,
+              running->hash,
+              (long)running->start_sec,
+              proc_start);
+    }
+    if(ferror(fp)){
+      fclose(fp);
+    }
+    else if(fclose(fp) == 0 &&
+            rename(crond->path_handoff_tmp, crond->path_handoff) == 0){
+      written = true;
+    }
+  }
+  if(written == false){
+    crond_fprintf_stderr("failed to write: %s", crond->path_handoff);
+  }
+}
+
+/**
+ * Wait for the running jobs before exiting.
+ *
+ * crond stops starting jobs and waits up to @ref crond::drain_sec seconds
+ * for the running job monitors, which keeps their statistics and job state.
+ * Another SIGTERM or SIGINT stops waiting. The job monitors still running
+ * after that get handed off to the next crond process through
+ * @ref crond::path_handoff.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_drain(struct crond *const crond){
+  sigset_t sigset_wait;
+  struct timespec now;
+  struct timespec timeout;
+  time_t deadline;
+  int signum;
+
+  if(crond->path_handoff &&
+     crond_clock(crond, CLOCK_REALTIME, &now) == 0){
+    deadline = now.tv_sec + crond->drain_sec;
+    sigemptyset(&sigset_wait);
+    sigaddset(&sigset_wait, SIGCHLD);
+    sigaddset(&sigset_wait, SIGINT);
+    sigaddset(&sigset_wait, SIGTERM);
+    crond_reap_jobmon(crond);
+    crond_verbose(crond,
+                  "draining %lu jobs",
+                  (unsigned long)(crond->num_running - crond->num_adopted));
+    while(crond->num_running > crond->num_adopted && now.tv_sec < deadline){
+      timeout.tv_sec = deadline - now.tv_sec;
+      timeout.tv_nsec = 0;
+      signum = sigtimedwait(&sigset_wait, NULL, &timeout);
+      if(signum == SIGINT || signum == SIGTERM){
+        break;
+      }
+      crond_reap_jobmon(crond);
+      if(crond_clock(crond, CLOCK_REALTIME, &now) != 0){
+        break;
+      }
+    }
+    crond_running_poll(crond);
+    if(crond->num_running){
+      crond_verbose(crond,
+                    "handing off %lu jobs",
+                    (unsigned long)crond->num_running);
+      crond_handoff_write(crond);
+    }
+  }
+}
+
+/**
+ * Write all bytes to a file descriptor.
+ *
+ * @param[in] fd     File descriptor.
+ * @param[in] data   Data to write.
+ * @param[in] datasz Number of bytes in @p data.
+ * @retval    0      Wrote all bytes.
+ * @retval    -1     Failed to write the bytes.
+ */
+static int
+crond_fd_write_all(const int fd,
+                   const char *const data,
+                   const size_t datasz){
+  size_t bytes_to_write;
+  ssize_t bytes_written;
+  int rc;
+
+  rc = 0;
+  bytes_to_write = datasz;
+  while(rc == 0 && bytes_to_write){
+    bytes_written = write(fd, &data[datasz - bytes_to_write], bytes_to_write);
+    if(bytes_written < 0){
+      if(errno != EINTR){
+        rc = -1;
+      }
+    }
+    else{
+      bytes_to_write -= (size_t)bytes_written;
+    }
+  }
+  return rc;
+}
+
+/**
+ * Write to a child process through a pipe.
+ *
+ * This function closes the pipe file descriptors when no longer needed. It
+ * will also exit if an error occurs at any point during this process.
+ *
+ * @param[in] pipe_write File descriptors created by pipe(). This function will
+ *                       close both file descriptors.
+ * @param[in] data       Data to write through the pipe.
+ * @param[in] datasz     Number of bytes in @p data.
+ */
+static void
+crond_fd_write(const int pipe_write[2],
+               const char *const data,
+               const size_t datasz){
+  if(close(pipe_write[0]) != 0 ||
+     crond_fd_write_all(pipe_write[1], data, datasz) != 0 ||
+     close(pipe_write[1]) != 0){
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * Start mailx to send job output to the user.
+ *
+ * The job monitor writes the output to the returned file descriptor while
+ * the command runs, so it does not have to keep the output in memory.
+ *
+ * @param[in]  crond       See @ref crond.
+ * @param[in]  command_str The shell command that ran when launching the job.
+ * @param[out] pid_mailx   Process ID of mailx, or -1 if it did not start.
+ * @retval     >=0         File descriptor of the mailx STDIN.
+ * @retval     -1          Failed to start mailx.
+ */
+static int
+crond_mailx_open(const struct crond *const crond,
+                 const char *const command_str,
+                 pid_t *const pid_mailx){
+  char subject[CROND_MAX_SUBJECT_LEN];
+  struct sigaction sact;
+  int pipe_write[2];
+  int fd_mailx;
+
+  fd_mailx = -1;
+  *pid_mailx = -1;
+  /* Allow subject to get truncated. */
+  if(snprintf(subject,
+              sizeof(subject),
+              "Cron <%s> %s",
+              crond->email_to,
+              command_str) >= 0 &&
+     pipe(pipe_write) == 0){
+    *pid_mailx = fork();
+    if(*pid_mailx == 0){
+#ifdef CRON_TEST
+      g_test_seam_err_in_fork_mailx = true;
+#endif /* CRON_TEST */
+      /* The job monitor ignores SIGPIPE, see @ref crond_job_spawn. */
+      sact.sa_handler = SIG_DFL;
+      sact.sa_flags = 0;
+      if(sigemptyset(&sact.sa_mask)           == 0 &&
+         cron_sigaction(SIGPIPE, &sact, NULL) == 0 &&
+         dup2(pipe_write[0], STDIN_FILENO)    >= 0 &&
+         close(pipe_write[0])                 == 0 &&
+         close(pipe_write[1])                 == 0){
+        execlp("mailx", "mailx", "-s", subject, crond->email_to, NULL);
+      }
+      exit(EXIT_FAILURE);
+    }
+    else if(*pid_mailx != -1 && close(pipe_write[0]) == 0){
+      fd_mailx = pipe_write[1];
+    }
+    else{
+      close(pipe_write[0]);
+      close(pipe_write[1]);
+    }
+  }
+  return fd_mailx;
+}
+
+/**
+ * Finish sending the mail started by @ref crond_mailx_open.
+ *
+ * @param[in] crond     See @ref crond.
+ * @param[in] pid_mailx Process ID of mailx.
+ * @param[in] fd_mailx  File descriptor of the mailx STDIN, or -1 if it
+ *                      already got closed.
+ */
+static void
+crond_mailx_close(const struct crond *const crond,
+                  const pid_t pid_mailx,
+                  const int fd_mailx){
+  if(fd_mailx != -1 && close(fd_mailx) != 0){
+    exit(EXIT_FAILURE);
+  }
+  crond_waitpid(crond, pid_mailx);
+}
+
+/**
+ * Set the email to in @ref crond::email_to for a user on this host.
+ *
+ * @param[in,out] crond     See @ref crond.
+ * @param[in]     user_name User name.
+ * @retval        0         Set the email address.
+ * @retval        -1        The user name does not fit in the address.
+ */
+static int
+crond_set_email_to(struct crond *const crond,
+                   const char *const user_name){
+  char host_name[CROND_MAX_HOST_NAME_SZ];
+  int len;
+  int rc;
+
+  /*
+   * Do not care if this truncates since we will force a null-terminator
+   * after the call.
+   */
+  gethostname(host_name, sizeof(host_name));
+  host_name[sizeof(host_name) - 1] = '\0';
+
+  len = snprintf(crond->email_to,
+                 sizeof(crond->email_to),
+                 "%s@%s",
+                 user_name,
+                 host_name);
+  if(len < 0 || (size_t)len >= sizeof(crond->email_to)){
+    rc = -1;
+  }
+  else{
+    rc = 0;
+  }
+  return rc;
+}
+
+/**
+ * Switch the job monitor process to the user of a job in system mode.
+ *
+ * This sets the groups and user ID, changes to the home directory, and
+ * sends the job output to the user. Jobs added through the control socket
+ * belong to the crond user and keep running as that user. The jobs of any
+ * other user without a crontab file do not run.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     uid   See @ref crond_job::uid.
+ * @retval        0     Switched to the user, or nothing to do.
+ * @retval        -1    Failed to switch to the user.
+ */
+CRON_LINKAGE int
+crond_user_switch(struct crond *const crond,
+                  const uid_t uid){
+  const struct crond_user *user;
+  int rc;
+
+  rc = 0;
+  if(crond->flags & CROND_FLAG_SYSTEM){
+    user = crond_user_find(crond->user_list, crond->num_users, uid);
+    if(user == NULL){
+      if(uid != geteuid()){
+        rc = -1;
+      }
+    }
+    else if(setgid(user->gid) != 0 ||
+            initgroups(user->name, user->gid) != 0 ||
+            setuid(user->uid) != 0){
+      rc = -1;
+    }
+    else if(chdir(user->home) != 0 && chdir("/") != 0){
+      rc = -1;
+    }
+    else if(crond_set_email_to(crond, user->name) != 0){
+      rc = -1;
+    }
+  }
+  return rc;
+}
+
+/**
+ * Close the descriptors of crond that a job monitor process inherited.
+ *
+ * The job monitor does not execute a new program, so close-on-exec does
+ * not apply to it. The lock file stays locked until every process that
+ * has it open closes it, so a job monitor keeping it open would stop the
+ * next crond from starting until the job exits.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @retval        0     Closed the descriptors.
+ * @retval        -1    Failed to close a descriptor.
+ */
+static int
+crond_jobmon_close_fds(struct crond *const crond){
+  int rc;
+
+  rc = 0;
+  if(crond->fd_lock_file >= 0 && close(crond->fd_lock_file) != 0){
+    rc = -1;
+  }
+  if(crond->fd_control >= 0 && close(crond->fd_control) != 0){
+    rc = -1;
+  }
+  if(crond->fd_inotify >= 0 && close(crond->fd_inotify) != 0){
+    rc = -1;
+  }
+  crond->fd_lock_file = -1;
+  crond->fd_control = -1;
+  crond->fd_inotify = -1;
+  return rc;
+}
+
+/**
+ * Launch the job in a new process.
+ *
+ * This will create two child processes:
+ *   - A monitor process that checks for STDOUT and STDERR output from
+ *     the command. If it does generate output, then that will get mailed to
+ *     the user. The monitor starts mailx on the first output and passes the
+ *     output through as it arrives, so its memory use does not depend on
+ *     the size of the output.
+ *   - A command process that runs the job in the shell.
+ *
+ * @verbatim
+   <crond>----------------------------> Continue processing next job and sleep
+        |      |       |
+        |      |       |
+        |      |       <jobmon>----------------> No email if no STDOUT/STDERR
+        |      |              |
+        |      |              |
+        |      |              |
+        |      |              |
+        |      |              <command>--------> /bin/sh
+        |      |
+        |      |
+        |      <jobmon>------------------------> Send email with STDOUT/STDERR
+        |             |         ^         ^
+        |             |         |         |
+        |             |         | STDOUT  | STDERR
+        |             |         |         |
+        |             <command>----------------> /bin/sh
+        |
+        |
+        <jobmon>-----------------------------> Send email with STDOUT/STDERR
+              |         ^         ^
+              |         |         |
+              |         | STDOUT  | STDERR
+              |         |         |
+              <command>----------------------> /bin/sh
+ * @endverbatim
+ *
+ * The job monitor exits with the exit code of the command, which crond
+ * collects in @ref crond_reap_jobmon, or with EXIT_FAILURE if it failed to
+ * mail the output.
+ *
+ * @param[in,out] crond     See @ref crond.
+ * @param[in]     job_idx   Index of the job in @ref crond::job_list.
+ * @param[in]     scheduled Set to true if the job runs because it matched
+ *                          the current minute, or false if requested
+ *                          through the control socket.
+ */
+static void
+crond_job_spawn(struct crond *const crond,
+                const size_t job_idx,
+                const bool scheduled){
+  const struct crond_job *job;
+  pid_t pid_jobmon;
+  pid_t pid_cmd;
+  int pipe_read[2];
+  int pipe_write[2];
+  ssize_t bytes_read;
+  char *read_buf;
+  size_t output_len;
+  struct sigaction sact_pipe;
+  pid_t pid_mailx;
+  int fd_mailx;
+  bool mail_failed;
+  int cmd_status;
+  struct timespec ts_fork;
+  struct timespec ts_start;
+  struct timespec ts_exit;
+  struct timespec ts_minute;
+  size_t client_i;
+  char *envp[2];
+
+  job = &crond->job_list[job_idx];
+  crond_verbose(crond,
+                "running job (%s): %s",
+                crond_job_source_name(crond, job),
+                job->command);
+  memcpy(&ts_fork, &crond->ts_now, sizeof(ts_fork));
+  if(crond->trace_buf){
+    crond_clock(crond, CLOCK_REALTIME, &ts_fork);
+  }
+  pid_jobmon = fork();
+  if(pid_jobmon == -1){
+    crond_verbose(crond, "failed to execute job");
+  }
+  else if(pid_jobmon == 0){
+#ifdef CRON_TEST
+    g_test_seam_err_in_fork_jobmon = true;
+#endif /* CRON_TEST */
+    /* The parent process writes the trace events it buffered. */
+    crond->trace_buf_len = 0;
+    /* Control socket clients must not wait for the job to finish. */
+    for(client_i = 0; client_i < crond->num_clients; client_i++){
+      close(crond->client_list[client_i].fd);
+    }
+    if(crond_jobmon_close_fds(crond) != 0 ||
+       crond_user_switch(crond, job->uid) != 0){
+      exit(EXIT_FAILURE);
+    }
+    memcpy(&ts_start, &ts_fork, sizeof(ts_start));
+    if(crond->trace_buf){
+      crond_clock(crond, CLOCK_REALTIME, &ts_start);
+    }
+    if(sigprocmask(SIG_SETMASK, &crond->sigmask_orig, NULL) != 0 ||
+       pipe(pipe_read ) != 0 ||
+       pipe(pipe_write) != 0){
+      exit(EXIT_FAILURE);
+    }
+    pid_cmd = fork();
+    if(pid_cmd == -1){
+      exit(EXIT_FAILURE);
+    }
+    else if(pid_cmd == 0){
+      if(dup2(pipe_read[1] , STDOUT_FILENO) >= 0 &&
+         dup2(pipe_read[1] , STDERR_FILENO) >= 0 &&
+         dup2(pipe_write[0], STDIN_FILENO ) >= 0 &&
+         close(pipe_read[0])                == 0 &&
+         close(pipe_read[1])                == 0 &&
+         close(pipe_write[0])               == 0 &&
+         close(pipe_write[1])               == 0){
+        CROND_PROBE2(job_exec, (long)job_idx, crond_probe_ts());
+        if(job->zone){
+          envp[0] = crond->zone_list[job->zone - 1].env_tz;
+        }
+        else{
+          envp[0] = NULL;
+        }
+        envp[1] = NULL;
+        execle(crond->path_shell,
+               crond->path_shell,
+               "-c",
+               job->command,
+               NULL,
+               envp);
+      }
+      exit(EXIT_FAILURE);
+    }
+    if(close(pipe_read[1]) != 0){
+      exit(EXIT_FAILURE);
+    }
+    crond_fd_write(pipe_write, job->stdin_lines, job->stdin_lines_len);
+    /*
+     * The output goes to mailx while the command runs, so a large output
+     * does not have to fit in memory. Ignore SIGPIPE so that a mailx that
+     * exits early does not stop the output from getting read.
+     */
+    sact_pipe.sa_handler = SIG_IGN;
+    sact_pipe.sa_flags = 0;
+    read_buf = malloc(CROND_OUTPUT_BUF_SZ);
+    if(read_buf == NULL ||
+       sigemptyset(&sact_pipe.sa_mask) != 0 ||
+       cron_sigaction(SIGPIPE, &sact_pipe, NULL) != 0){
+      exit(EXIT_FAILURE);
+    }
+    pid_mailx = 0;
+    fd_mailx = -1;
+    mail_failed = false;
+    output_len = 0;
+    do{
+      bytes_read = read(pipe_read[0], read_buf, CROND_OUTPUT_BUF_SZ);
+      if(bytes_read < 0){
+        if(errno != EINTR){
+          exit(EXIT_FAILURE);
+        }
+      }
+      else if(bytes_read){
+        if(si_add_size_t(output_len, (size_t)bytes_read, &output_len)){
+          exit(EXIT_FAILURE);
+        }
+        if(pid_mailx == 0){
+          fd_mailx = crond_mailx_open(crond, job->command, &pid_mailx);
+          if(fd_mailx == -1){
+            mail_failed = true;
+          }
+        }
+        /* Keep reading after a failure so the command can finish. */
+        if(fd_mailx != -1 &&
+           crond_fd_write_all(fd_mailx, read_buf, (size_t)bytes_read) != 0){
+          close(fd_mailx);
+          fd_mailx = -1;
+          mail_failed = true;
+        }
+      }
+    } while(bytes_read);
+    free(read_buf);
+    CROND_PROBE3(job_output,
+                 (long)job_idx,
+                 (long)output_len,
+                 crond_probe_ts());
+    if(close(pipe_read[0]) != 0){
+      exit(EXIT_FAILURE);
+    }
+    cmd_status = crond_waitpid(crond, pid_cmd);
+    memcpy(&ts_exit, &ts_start, sizeof(ts_exit));
+    if(crond->trace_buf){
+      crond_clock(crond, CLOCK_REALTIME, &ts_exit);
+      crond_trace_span(crond,
+                       "running",
+                       job_idx,
+                       &ts_start,
+                       &ts_exit,
+                       "exit_code",
+                       crond_exit_code(cmd_status));
+    }
+    if(pid_mailx > 0){
+      CROND_PROBE3(job_mail,
+                   (long)job_idx,
+                   (long)output_len,
+                   crond_probe_ts());
+      crond_mailx_close(crond, pid_mailx, fd_mailx);
+      if(crond->trace_buf &&
+         crond_clock(crond, CLOCK_REALTIME, &ts_start) == 0){
+        crond_trace_span(crond,
+                         "output",
+                         job_idx,
+                         &ts_exit,
+                         &ts_start,
+                         "bytes",
+                         (long)output_len);
+      }
+    }
+    if(crond->trace_buf){
+      /* Write all events at once so they do not get split up. */
+      crond_trace_flush(crond);
+    }
+    exit(mail_failed ? EXIT_FAILURE : crond_exit_code(cmd_status));
+  }
+  else{
+    CROND_PROBE3(job_spawn,
+                 (long)job_idx,
+                 (long)pid_jobmon,
+                 crond_probe_ts());
+    crond->job_list[job_idx].num_runs += 1;
+    crond->metrics_dirty = true;
+    crond_running_add(crond, job_idx, pid_jobmon);
+    if(crond_clock(crond, CLOCK_REALTIME, &ts_start) == 0){
+      if(scheduled){
+        ts_minute.tv_sec = crond->ts_now.tv_sec - crond->tm->tm_sec;
+        ts_minute.tv_nsec = 0;
+        crond_histogram_observe(&crond->hist_lateness,
+                                crond_timespec_diff_usec(&ts_minute,
+                                                         &ts_start));
+        crond_trace_span(crond,
+                         "scheduled",
+                         job_idx,
+                         &ts_minute,
+                         &ts_fork,
+                         "minute",
+                         (long)ts_minute.tv_sec);
+      }
+      crond_trace_span(crond,
+                       "spawn",
+                       job_idx,
+                       &ts_fork,
+                       &ts_start,
+                       "pid",
+                       (long)pid_jobmon);
+    }
+  }
+}
+
+/**
+ * Count the running jobs of a user.
+ *
+ * @param[in] crond See @ref crond.
+ * @param[in] uid   See @ref crond_job::uid.
+ * @return          Number of job monitor processes running jobs of the
+ *                  user.
+ */
+static size_t
+crond_user_num_running(const struct crond *const crond,
+                       const uid_t uid){
+  size_t i;
+  size_t num_running;
+
+  num_running = 0;
+  for(i = 0; i < crond->num_running; i++){
+    if(crond->running_list[i].uid == uid){
+      num_running += 1;
+    }
+  }
+  return num_running;
+}
+
+/**
+ * Write a line to the dry run log instead of running a job.
+ *
+ * Each line contains the current time in seconds since the epoch, the index
+ * of the job in @ref crond::job_list, and the command, separated by spaces.
+ * The log gets flushed once a minute by @ref crond_sleep.
+ *
+ * @param[in,out] crond   See @ref crond.
+ * @param[in]     job_idx Index of the job in @ref crond::job_list.
+ */
+static void
+crond_job_record(struct crond *const crond,
+                 const size_t job_idx){
+  fprintf(crond->fp_record,
+          "%ld %lu %s\n",
+          (long)crond->ts_now.tv_sec,
+          (unsigned long)job_idx,
+          crond->job_list[job_idx].command);
+}
+
+/**
+ * Open the dry run log given to -n.
+ *
+ * The file gets opened in append mode, so that restarting crond keeps the
+ * lines already written.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_record_open(struct crond *const crond){
+  if(crond->path_record == NULL){
+    /* Run the jobs. */
+  }
+  else if(strcmp(crond->path_record, "-") == 0){
+    crond->fp_record = stdout;
+  }
+  else{
+    crond->fp_record = fopen(crond->path_record, "a");
+    if(crond->fp_record == NULL){
+      crond_errx_noexit(crond,
+                        "failed to open dry run log: %s",
+                        crond->path_record);
+    }
+  }
+}
+
+/**
+ * Flush the dry run log, and close it if crond is exiting.
+ *
+ * @param[in,out] crond  See @ref crond.
+ * @param[in]     finish Set to true to close the log.
+ */
+static void
+crond_record_flush(struct crond *const crond,
+                   const bool finish){
+  if(crond->fp_record){
+    if(fflush(crond->fp_record) != 0 || ferror(crond->fp_record)){
+      crond_errx_noexit(crond,
+                        "failed to write dry run log: %s",
+                        crond->path_record);
+    }
+    if(finish && crond->fp_record != stdout){
+      if(fclose(crond->fp_record) != 0){
+        crond_errx_noexit(crond,
+                          "failed to close dry run log: %s",
+                          crond->path_record);
+      }
+      crond->fp_record = NULL;
+    }
+  }
+}
+
+/**
+ * Run a job unless its user already runs the maximum number of jobs, see
+ * @ref crond::user_max_running.
+ *
+ * With -n, the job gets recorded by @ref crond_job_record instead.
+ *
+ * @param[in,out] crond     See @ref crond.
+ * @param[in]     job_idx   Index of the job in @ref crond::job_list.
+ * @param[in]     scheduled See @ref crond_job_spawn.
+ */
+static void
+crond_job_run(struct crond *const crond,
+              const size_t job_idx,
+              const bool scheduled){
+  const struct crond_job *job;
+
+  job = &crond->job_list[job_idx];
+  if(crond->user_max_running &&
+     crond_user_num_running(crond, job->uid) >= crond->user_max_running){
+    crond_verbose(crond, "user job limit reached: %s", job->command);
+  }
+  else if(crond->fp_record){
+    crond_job_record(crond, job_idx);
+  }
+  else{
+    crond_job_spawn(crond, job_idx, scheduled);
+  }
+}
+
+/**
+ * Start the next job waiting for catch-up.
+ *
+ * Catch-up runs get started one at a time, at most once every
+ * @ref CROND_CATCHUP_STAGGER_SEC seconds, so that restarting crond after
+ * a long downtime does not start every missed job at once. Jobs that are
+ * paused or already running skip their catch-up run.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     now   Current time.
+ */
+static void
+crond_catchup_run(struct crond *const crond,
+                  const time_t now){
+  size_t i;
+  struct crond_state *state;
+  const struct crond_job *job;
+  bool started;
+
+  started = false;
+  for(i = 0;
+      crond->num_catchup && now >= crond->ts_catchup && i < crond->num_jobs;
+      i++){
+    job = &crond->job_list[i];
+    if(job->command == NULL || job->hash == 0){
+      continue;
+    }
+    state = crond_state_find(crond, job->hash);
+    if(state && state->catchup){
+      state->catchup = false;
+      crond->num_catchup -= 1;
+      if(job->paused == false && job->num_running == 0){
+        crond_verbose(crond, "catching up job: %s", job->command);
+        crond_job_run(crond, i, false);
+        crond->ts_catchup = now + CROND_CATCHUP_STAGGER_SEC;
+        started = true;
+        break;
+      }
+    }
+  }
+  if(started == false && now >= crond->ts_catchup){
+    /* The remaining entries belong to jobs no longer loaded. */
+    crond->num_catchup = 0;
+  }
+}
+
+/**
+ * Get the path of the file that persists an ephemeral job.
+ *
+ * @param[in] crond  See @ref crond.
+ * @param[in] serial See @ref crond_job::serial.
+ * @param[in] suffix Append this string to the file name.
+ * @retval    char*  File path. The caller must free this when finished.
+ * @retval    NULL   Memory allocation failed.
+ */
+static char *
+crond_ephemeral_path(const struct crond *const crond,
+                     const unsigned long serial,
+                     const char *const suffix){
+  char name[32];
+  char *path_name;
+  char *path;
+
+  sprintf(name, "/%lu", serial);
+  path_name = crond_get_path_suffix(crond->path_ephemeral, name);
+  path = crond_get_path_suffix(path_name, suffix);
+  free(path_name);
+  return path;
+}
+
+/**
+ * Persist an ephemeral job in @ref crond::path_ephemeral.
+ *
+ * Each job gets its own file named after @ref crond_job::serial. The first
+ * line contains @ref crond_job::expire and the second line contains the
+ * crontab line. The file gets written to a temporary file and then renamed
+ * so that crond never loads a partially written job.
+ *
+ * @param[in] crond See @ref crond.
+ * @param[in] job   See @ref crond_job.
+ * @param[in] line  Crontab line of the job.
+ * @retval    0     Persisted the job or persistence is disabled.
+ * @retval    -1    Failed to persist the job.
+ */
+static int
+crond_ephemeral_save(const struct crond *const crond,
+                     const struct crond_job *const job,
+                     const char *const line){
+  char *path;
+  char *path_tmp;
+  FILE *fp;
+  int rc;
+
+  rc = 0;
+  if(crond->path_ephemeral && crond_readonly(crond) == false){
+    rc = -1;
+    path = crond_ephemeral_path(crond, job->serial, "");
+    path_tmp = crond_ephemeral_path(crond, job->serial, ".tmp");
+    if(path && path_tmp){
+      fp = fopen(path_tmp, "w");
+      if(fp){
+        fprintf(fp, "%ld\n%s\n", (long)job->expire, line);
+        if(ferror(fp)){
+          fclose(fp);
+        }
+        else if(fclose(fp) == 0 && rename(path_tmp, path) == 0){
+          rc = 0;
+        }
+      }
+    }
+    free(path);
+    free(path_tmp);
+  }
+  return rc;
+}
+
+/**
+ * Remove the persisted file of an ephemeral job.
+ *
+ * @param[in] crond  See @ref crond.
+ * @param[in] serial See @ref crond_job::serial.
+ */
+static void
+crond_ephemeral_unlink(const struct crond *const crond,
+                       const unsigned long serial){
+  char *path;
+
+  if(crond->path_ephemeral && crond_readonly(crond) == false){
+    path = crond_ephemeral_path(crond, serial, "");
+    if(path == NULL || remove(path) != 0){
+      crond_fprintf_stderr("failed to remove ephemeral job: %lu", serial);
+    }
+    free(path);
+  }
+}
+
+/**
+ * Add an ephemeral job to the job list.
+ *
+ * This takes constant time apart from parsing @p line, so adding and
+ * removing ephemeral jobs does not depend on the size of the crontab.
+ *
+ * @param[in,out] crond   See @ref crond.
+ * @param[in]     line    Crontab line of the job.
+ * @param[in]     serial  See @ref crond_job::serial.
+ * @param[in]     expire  See @ref crond_job::expire.
+ * @param[out]    job_idx Index of the new job in @ref crond::job_list.
+ * @retval        true    Job has been added.
+ * @retval        false   @p line is not a valid job or memory allocation
+ *                        failed.
+ */
+static bool
+crond_ephemeral_add(struct crond *const crond,
+                    const char *const line,
+                    const unsigned long serial,
+                    const time_t expire,
+                    size_t *const job_idx){
+  struct crond_job job;
+  bool added;
+
+  added = false;
+  if(crond_job_parse(crond, line, &job)){
+    job.ephemeral = true;
+    job.serial = serial;
+    job.expire = expire;
+    added = crond_job_add(crond, &job, job_idx);
+    if(added){
+      crond->metrics_dirty = true;
+      crond_trace_job_name(crond, *job_idx);
+    }
+    else{
+      crond_job_free(&job);
+    }
+  }
+  return added;
+}
+
+/**
+ * Remove an ephemeral job from the job list and from
+ * @ref crond::path_ephemeral.
+ *
+ * @param[in,out] crond   See @ref crond.
+ * @param[in]     job_idx Index of the job in @ref crond::job_list.
+ */
+static void
+crond_ephemeral_remove(struct crond *const crond,
+                       const size_t job_idx){
+  crond_verbose(crond,
+                "removing ephemeral job: %s",
+                crond->job_list[job_idx].command);
+  crond_ephemeral_unlink(crond, crond->job_list[job_idx].serial);
+  crond_job_remove(crond, job_idx);
+  crond->metrics_dirty = true;
+}
+
+/**
+ * Load one persisted ephemeral job.
+ *
+ * Expired jobs get removed instead of loaded.
+ *
+ * @param[in,out] crond  See @ref crond.
+ * @param[in]     serial See @ref crond_job::serial.
+ * @param[in]     now    Current time.
+ */
+static void
+crond_ephemeral_load_file(struct crond *const crond,
+                          const unsigned long serial,
+                          const time_t now){
+  char *path;
+  FILE *fp;
+  char *line;
+  size_t len;
+  long expire;
+  char *ep;
+  size_t job_idx;
+  bool loaded;
+
+  loaded = false;
+  path = crond_ephemeral_path(crond, serial, "");
+  if(path){
+    fp = fopen(path, "r");
+    if(fp){
+      line = NULL;
+      len = 0;
+      if(getline(&line, &len, fp) > 0){
+        expire = strtol(line, &ep, 10);
+        if(*ep == '\n' && getline(&line, &len, fp) > 0){
+          line[strcspn(line, "\n")] = '\0';
+          if(expire != 0 && (time_t)expire <= now){
+            crond_ephemeral_unlink(crond, serial);
+            loaded = true;
+          }
+          else{
+            loaded = crond_ephemeral_add(crond,
+                                         line,
+                                         serial,
+                                         (time_t)expire,
+                                         &job_idx);
+          }
+        }
+      }
+      free(line);
+      fclose(fp);
+    }
+  }
+  if(loaded == false){
+    crond_fprintf_stderr("failed to load ephemeral job: %lu", serial);
+  }
+  free(path);
+  if(serial >= crond->job_serial){
+    crond->job_serial = serial + 1;
+  }
+}
+
+/**
+ * Load the ephemeral jobs persisted in @ref crond::path_ephemeral.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_ephemeral_load(struct crond *const crond){
+  DIR *dir;
+  const struct dirent *ent;
+  struct timespec now;
+
+  if(crond->path_ephemeral && crond->status_code == 0){
+    dir = opendir(crond->path_ephemeral);
+    if(dir == NULL){
+      crond_errx_noexit(crond,
+                        "failed to open ephemeral job directory: %s",
+                        crond->path_ephemeral);
+    }
+    else{
+      if(crond_clock(crond, CLOCK_REALTIME, &now) == 0){
+        while((ent = readdir(dir)) != NULL){
+          if(ent->d_name[0] &&
+             strspn(ent->d_name, "0123456789") == strlen(ent->d_name)){
+            crond_ephemeral_load_file(crond,
+                                      strtoul(ent->d_name, NULL, 10),
+                                      now.tv_sec);
+          }
+        }
+      }
+      closedir(dir);
+    }
+  }
+}
+
+/**
+ * Check if an at job should run before another at job.
+ *
+ * @param[in] a    See @ref crond_at.
+ * @param[in] b    See @ref crond_at.
+ * @retval    true @p a runs before @p b.
+ * @retval    false @p a runs at the same time or after @p b.
+ */
+static bool
+crond_at_before(const struct crond_at *const a,
+                const struct crond_at *const b){
+  return a->when < b->when || (a->when == b->when && a->serial < b->serial);
+}
+
+/**
+ * Move an entry in @ref crond::at_queue up or down until the min-heap
+ * order gets restored.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     idx   Index of the entry in @ref crond::at_queue.
+ */
+static void
+crond_at_sift(struct crond *const crond,
+              size_t idx){
+  struct crond_at *queue;
+  struct crond_at entry;
+  size_t child;
+
+  queue = crond->at_queue;
+  memcpy(&entry, &queue[idx], sizeof(entry));
+  while(idx > 0 && crond_at_before(&entry, &queue[(idx - 1) / 2])){
+    memcpy(&queue[idx], &queue[(idx - 1) / 2], sizeof(entry));
+    idx = (idx - 1) / 2;
+  }
+  for(;;){
+    child = idx * 2 + 1;
+    if(child >= crond->num_at){
+      break;
+    }
+    if(child + 1 < crond->num_at &&
+       crond_at_before(&queue[child + 1], &queue[child])){
+      child += 1;
+    }
+    if(crond_at_before(&queue[child], &entry) == false){
+      break;
+    }
+    memcpy(&queue[idx], &queue[child], sizeof(entry));
+    idx = child;
+  }
+  memcpy(&queue[idx], &entry, sizeof(entry));
+}
+
+/**
+ * Add a pending at job to @ref crond::at_queue.
+ *
+ * @param[in,out] crond  See @ref crond.
+ * @param[in]     when   See @ref crond_at::when.
+ * @param[in]     serial See @ref crond_at::serial.
+ * @retval        0      Added the at job.
+ * @retval        -1     Memory allocation failed.
+ */
+static int
+crond_at_push(struct crond *const crond,
+              const time_t when,
+              const unsigned long serial){
+  struct crond_at *new_queue;
+  size_t new_sz;
+  int rc;
+
+  rc = 0;
+  if(crond->num_at == crond->at_queue_sz){
+    new_sz = crond->at_queue_sz * 2 + 16;
+    new_queue = crond_reallocarray(crond->at_queue,
+                                   new_sz,
+                                   sizeof(*crond->at_queue));
+    if(new_queue == NULL){
+      rc = -1;
+    }
+    else{
+      crond->at_queue = new_queue;
+      crond->at_queue_sz = new_sz;
+    }
+  }
+  if(rc == 0){
+    crond->at_queue[crond->num_at].when = when;
+    crond->at_queue[crond->num_at].serial = serial;
+    crond->num_at += 1;
+    crond_at_sift(crond, crond->num_at - 1);
+  }
+  return rc;
+}
+
+/**
+ * Remove an entry from @ref crond::at_queue.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     idx   Index of the entry in @ref crond::at_queue.
+ */
+static void
+crond_at_delete(struct crond *const crond,
+                const size_t idx){
+  crond->num_at -= 1;
+  if(idx < crond->num_at){
+    memcpy(&crond->at_queue[idx],
+           &crond->at_queue[crond->num_at],
+           sizeof(*crond->at_queue));
+    crond_at_sift(crond, idx);
+  }
+}
+
+/**
+ * Parse an at job reference in the form WHEN.SERIAL.
+ *
+ * @param[in]  str    String to parse.
+ * @param[out] entry  See @ref crond_at.
+ * @retval     0      Parsed the reference.
+ * @retval     -1     @p str does not contain a valid reference.
+ */
+static int
+crond_at_parse_name(const char *const str,
+                    struct crond_at *const entry){
+  char *ep;
+  long when;
+  int rc;
+
+  rc = -1;
+  if(str && isdigit((unsigned char)*str)){
+    errno = 0;
+    when = strtol(str, &ep, 10);
+    if(*ep == '.' && isdigit((unsigned char)ep[1])){
+      entry->serial = strtoul(&ep[1], &ep, 10);
+      if(errno == 0 && *ep == '\0'){
+        entry->when = (time_t)when;
+        rc = 0;
+      }
+    }
+  }
+  return rc;
+}
+
+/**
+ * Load an at job from its spool file into an unused slot of
+ * @ref crond::job_list.
+ *
+ * @param[in,out] crond   See @ref crond.
+ * @param[in]     entry   See @ref crond_at.
+ * @param[out]    job_idx Index of the loaded job in @ref crond::job_list.
+ * @retval        0       Loaded the job.
+ * @retval        1       Failed to allocate a slot for the job.
+ * @retval        -1      Failed to load the job from the spool file.
+ */
+static int
+crond_at_job_load(struct crond *const crond,
+                  const struct crond_at *const entry,
+                  size_t *const job_idx){
+  struct crond_job job;
+  char *path;
+  FILE *fp;
+  char *line;
+  size_t len;
+  int rc;
+
+  rc = -1;
+  memset(&job, 0, sizeof(job));
+  line = NULL;
+  len = 0;
+  path = crond_at_path(crond, entry->when, entry->serial, "");
+  fp = NULL;
+  if(path){
+    fp = fopen(path, "r");
+  }
+  if(fp){
+    if(getline(&line, &len, fp) > 0){
+      line[strcspn(line, "\n")] = '\0';
+      job.at_time = entry->when;
+      job.serial = entry->serial;
+      if(crond_crontab_parse_command(line, 0, &job)){
+        rc = 1;
+        if(crond_job_add(crond, &job, job_idx) == false){
+          crond_job_free(&job);
+        }
+        else{
+          crond_trace_job_name(crond, *job_idx);
+          rc = 0;
+        }
+      }
+    }
+    free(line);
+    fclose(fp);
+  }
+  if(rc < 0){
+    crond_fprintf_stderr("failed to load at job: %ld.%lu",
+                         (long)entry->when,
+                         entry->serial);
+  }
+  free(path);
+  return rc;
+}
+
+/**
+ * Start an at job that became due.
+ *
+ * The job gets loaded from its spool file into an unused slot of
+ * @ref crond::job_list and runs through @ref crond_job_run.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     entry See @ref crond_at.
+ * @retval        0     Started the job.
+ * @retval        1     Failed to start the job, try again later.
+ * @retval        -1    Failed to load the job from the spool file.
+ */
+static int
+crond_at_run(struct crond *const crond,
+             const struct crond_at *const entry){
+  size_t job_idx;
+  int rc;
+
+  rc = crond_at_job_load(crond, entry, &job_idx);
+  if(rc == 0){
+    crond_job_run(crond, job_idx, false);
+    if(crond->fp_record){
+      /* The spool file stays for the crond that runs the jobs. */
+      crond_job_remove(crond, job_idx);
+    }
+    else if(crond->job_list[job_idx].num_running == 0){
+      crond_job_remove(crond, job_idx);
+      rc = 1;
+    }
+  }
+  return rc;
+}
+
+/**
+ * Start the at jobs that became due.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @return              Number of at jobs started.
+ */
+static size_t
+crond_at_run_due(struct crond *const crond){
+  struct crond_at entry;
+  size_t num_started;
+  int rc;
+
+  num_started = 0;
+  while(crond->num_at &&
+        crond->at_queue[0].when <= crond->ts_now.tv_sec){
+    memcpy(&entry, &crond->at_queue[0], sizeof(entry));
+    crond_at_delete(crond, 0);
+    rc = crond_at_run(crond, &entry);
+    if(rc == 0){
+      num_started += 1;
+    }
+    else if(rc > 0){
+      /* Leave the remaining jobs queued until the next tick. */
+      crond_at_push(crond, entry.when, entry.serial);
+      break;
+    }
+  }
+  return num_started;
+}
+
+/**
+ * Queue an at job in response to the at control command.
+ *
+ * The job gets written to the spool directory before getting added to
+ * @ref crond::at_queue, so pending at jobs survive a crond restart.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     arg   Local time in the form YYYY-MM-DDTHH:MM followed by
+ *                      the command.
+ * @param[in,out] fp    Response stream.
+ */
+static void
+crond_control_at(struct crond *const crond,
+                 const char *const arg,
+                 FILE *const fp){
+  struct tm tm;
+  int len;
+  int mday;
+  int mon;
+  time_t when;
+  const char *command;
+  unsigned long serial;
+  char *path;
+  char *path_tmp;
+  FILE *fp_at;
+  bool queued;
+
+  memset(&tm, 0, sizeof(tm));
+  len = 0;
+  when = -1;
+  command = "";
+  if(arg &&
+     sscanf(arg,
+            "%4d-%2d-%2dT%2d:%2d%n",
+            &tm.tm_year,
+            &tm.tm_mon,
+            &tm.tm_mday,
+            &tm.tm_hour,
+            &tm.tm_min,
+            &len) == 5 &&
+     arg[len] == ' ' &&
+     tm.tm_mon  >= 1 && tm.tm_mon  <= 12 &&
+     tm.tm_mday >= 1 && tm.tm_mday <= 31 &&
+     tm.tm_hour >= 0 && tm.tm_hour <= 23 &&
+     tm.tm_min  >= 0 && tm.tm_min  <= 59){
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    mday = tm.tm_mday;
+    mon = tm.tm_mon;
+    when = mktime(&tm);
+    if(tm.tm_mday != mday || tm.tm_mon != mon){
+      /* mktime moved a day like February 31 into the next month. */
+      when = -1;
+    }
+    command = &arg[len + strspn(&arg[len], " ")];
+  }
+  if(when < 0){
+    fputs("error: invalid time\n", fp);
+  }
+  else if(*command == '\0'){
+    fputs("error: invalid job\n", fp);
+  }
+  else{
+    queued = false;
+    serial = crond->job_serial;
+    crond->job_serial += 1;
+    path = crond_at_path(crond, when, serial, "");
+    path_tmp = crond_at_path(crond, when, serial, ".tmp");
+    if(path && path_tmp &&
+       (mkdir(crond->path_at, S_IRWXU) == 0 || errno == EEXIST)){
+      fp_at = fopen(path_tmp, "w");
+      if(fp_at){
+        fprintf(fp_at, "%s\n", command);
+        if(ferror(fp_at)){
+          fclose(fp_at);
+        }
+        else if(fclose(fp_at) == 0 && rename(path_tmp, path) == 0){
+          if(crond_at_push(crond, when, serial) == 0){
+            queued = true;
+          }
+          else{
+            remove(path);
+          }
+        }
+      }
+    }
+    if(queued){
+      crond->metrics_dirty = true;
+      fprintf(fp, "ok %ld.%lu\n", (long)when, serial);
+    }
+    else{
+      fputs("error: failed to queue job\n", fp);
+    }
+    free(path);
+    free(path_tmp);
+  }
+}
+
+/**
+ * Remove a pending at job in response to the atrm control command.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     arg   At job reference in the form WHEN.SERIAL.
+ * @param[in,out] fp    Response stream.
+ */
+static void
+crond_control_atrm(struct crond *const crond,
+                   const char *const arg,
+                   FILE *const fp){
+  struct crond_at entry;
+  size_t i;
+  char *path;
+
+  i = crond->num_at;
+  if(crond_at_parse_name(arg, &entry) == 0){
+    for(i = 0; i < crond->num_at; i++){
+      if(crond->at_queue[i].when == entry.when &&
+         crond->at_queue[i].serial == entry.serial){
+        break;
+      }
+    }
+  }
+  if(i == crond->num_at){
+    fputs("error: no such job\n", fp);
+  }
+  else{
+    crond_at_delete(crond, i);
+    crond->metrics_dirty = true;
+    path = crond_at_path(crond, entry.when, entry.serial, "");
+    if(path == NULL || remove(path) != 0){
+      fputs("error: failed to remove job\n", fp);
+    }
+    else{
+      fputs("ok\n", fp);
+    }
+    free(path);
+  }
+}
+
+/**
+ * Print the pending at jobs in response to the atq control command.
+ *
+ * Each line contains the at job reference and the local time it runs.
+ * The jobs do not get printed in any particular order.
+ *
+ * @param[in]     crond See @ref crond.
+ * @param[in,out] fp    Response stream.
+ */
+static void
+crond_control_atq(const struct crond *const crond,
+                  FILE *const fp){
+  size_t i;
+  const struct crond_at *entry;
+  struct tm tm;
+  char when[sizeof("YYYY-MM-DDTHH:MM")];
+
+  for(i = 0; i < crond->num_at; i++){
+    entry = &crond->at_queue[i];
+    if(localtime_r(&entry->when, &tm) == NULL ||
+       strftime(when, sizeof(when), "%Y-%m-%dT%H:%M", &tm) == 0){
+      strcpy(when, "-");
+    }
+    fprintf(fp, "%ld.%lu %s\n", (long)entry->when, entry->serial, when);
+  }
+}
+
+/**
+ * Check if an at job has already been loaded into @ref crond::job_list.
+ *
+ * This happens for the at jobs still running when crond executed itself
+ * again, see @ref crond_reexec_restore.
+ *
+ * @param[in] crond See @ref crond.
+ * @param[in] entry See @ref crond_at.
+ * @retval    true  The job has been loaded.
+ * @retval    false The job has not been loaded.
+ */
+static bool
+crond_at_loaded(const struct crond *const crond,
+                const struct crond_at *const entry){
+  size_t i;
+  const struct crond_job *job;
+  bool loaded;
+
+  loaded = false;
+  for(i = 0; i < crond->num_jobs && loaded == false; i++){
+    job = &crond->job_list[i];
+    if(job->command &&
+       job->at_time == entry->when &&
+       job->serial == entry->serial){
+      loaded = true;
+    }
+  }
+  return loaded;
+}
+
+/**
+ * Load the pending at jobs from the spool directory.
+ *
+ * This only reads the file names, so startup takes O(n log n) time for
+ * n pending at jobs. The commands get read when each job becomes due.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_at_load(struct crond *const crond){
+  DIR *dir;
+  const struct dirent *ent;
+  struct crond_at entry;
+
+  if(crond->status_code == 0){
+    if(crond->path_at == NULL){
+      crond->path_at = crond_get_path_suffix(crond->path_crontab,
+                                             CROND_AT_SUFFIX);
+    }
+    if(crond->path_at == NULL){
+      crond_errx_noexit(crond, "failed to get at spool path");
+    }
+    else{
+      dir = opendir(crond->path_at);
+      if(dir){
+        while((ent = readdir(dir)) != NULL){
+          if(crond_at_parse_name(ent->d_name, &entry) == 0 &&
+             crond_at_loaded(crond, &entry) == false){
+            if(crond_at_push(crond, entry.when, entry.serial) != 0){
+              crond_errx_noexit(crond, "reallocarray");
+              break;
+            }
+            if(entry.serial >= crond->job_serial){
+              crond->job_serial = entry.serial + 1;
+            }
+          }
+        }
+        closedir(dir);
+      }
+      crond_verbose(crond, "loaded %lu at jobs", (unsigned long)crond->num_at);
+    }
+  }
+}
+
+/**
+ * Get the owner of a job, see @ref crond_owner.
+ *
+ * @param[in] crond See @ref crond.
+ * @param[in] job   Job to get the owner of.
+ * @return          Index of the owner in @ref crond::owner_list.
+ */
+static size_t
+crond_job_owner(const struct crond *const crond,
+                const struct crond_job *const job){
+  const struct crond_user *user;
+  size_t owner;
+
+  if(crond->flags & CROND_FLAG_SYSTEM){
+    user = crond_user_find(crond->user_list, crond->num_users, job->uid);
+    if(user){
+      owner = (size_t)(user - crond->user_list) + 1;
+    }
+    else{
+      owner = 0;
+    }
+  }
+  else{
+    owner = job->source;
+  }
+  return owner;
+}
+
+/**
+ * Make room in @ref crond::owner_list for every owner.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @return              Number of owners that fit in @ref crond::owner_list,
+ *                      or 0 if it could not grow.
+ */
+static size_t
+crond_owner_list_grow(struct crond *const crond){
+  struct crond_owner *new_owner_list;
+  size_t num_owners;
+
+  if(crond->flags & CROND_FLAG_SYSTEM){
+    num_owners = crond->num_users + 1;
+  }
+  else{
+    num_owners = crond->num_sources + 1;
+  }
+  if(num_owners > crond->owner_max){
+    new_owner_list = crond_reallocarray(crond->owner_list,
+                                        num_owners,
+                                        sizeof(*crond->owner_list));
+    if(new_owner_list == NULL){
+      crond_fprintf_stderr("failed to allocate the job owner list");
+      num_owners = 0;
+    }
+    else{
+      crond->owner_list = new_owner_list;
+      crond->owner_max = num_owners;
+    }
+  }
+  return num_owners;
+}
+
+/**
+ * Run all jobs in the job list that should run in the current minute.
+ *
+ * The jobs due in the same minute get queued by owner and started one
+ * owner at a time in round-robin order, so that an owner with many jobs
+ * does not delay the jobs of the other owners. Each owner keeps the order
+ * of its jobs in the job list. If the owner list cannot grow, the jobs get
+ * started in job list order instead.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_job_list_run(struct crond *const crond){
+  struct crond_owner owner_single;
+  struct crond_owner *owner_list;
+  struct crond_owner *owner;
+  size_t num_owners;
+  size_t owner_idx;
+  size_t owner_first;
+  size_t owner_prev;
+  size_t num_active;
+  size_t i;
+  size_t num_started;
+  struct crond_job *job;
+
+  crond->last_minute = crond->ts_now.tv_sec - crond->tm->tm_sec;
+  CROND_PROBE2(tick_start, crond_probe_ts(), (long)crond->num_jobs);
+  num_owners = crond_owner_list_grow(crond);
+  if(num_owners == 0){
+    owner_list = &owner_single;
+    num_owners = 1;
+  }
+  else{
+    owner_list = crond->owner_list;
+  }
+  for(owner_idx = 0; owner_idx < num_owners; owner_idx++){
+    owner_list[owner_idx].head = SIZE_MAX;
+  }
+  for(i = 0; i < crond->num_jobs; i++){
+    job = &crond->job_list[i];
+    if(job->command == NULL){
+      /* Unused slot. */
+    }
+    else if(job->expire && job->expire <= crond->ts_now.tv_sec){
+      crond_ephemeral_remove(crond, i);
+    }
+    else if(job->paused == false && crond_job_due(crond, job)){
+      owner_idx = crond_job_owner(crond, job);
+      if(owner_idx >= num_owners){
+        owner_idx = 0;
+      }
+      owner = &owner_list[owner_idx];
+      job->next_due = SIZE_MAX;
+      if(owner->head == SIZE_MAX){
+        owner->head = i;
+      }
+      else{
+        crond->job_list[owner->tail].next_due = i;
+      }
+      owner->tail = i;
+    }
+  }
+
+  /* Link the owners with due jobs into a ring. */
+  num_active = 0;
+  owner_first = SIZE_MAX;
+  owner_prev = SIZE_MAX;
+  for(owner_idx = 0; owner_idx < num_owners; owner_idx++){
+    if(owner_list[owner_idx].head != SIZE_MAX){
+      if(owner_prev == SIZE_MAX){
+        owner_first = owner_idx;
+      }
+      else{
+        owner_list[owner_prev].next = owner_idx;
+      }
+      owner_prev = owner_idx;
+      num_active += 1;
+    }
+  }
+  if(num_active){
+    owner_list[owner_prev].next = owner_first;
+  }
+  owner_idx = owner_first;
+
+  num_started = 0;
+  while(num_active){
+    owner = &owner_list[owner_idx];
+    i = owner->head;
+    owner->head = crond->job_list[i].next_due;
+    crond_job_run(crond, i, true);
+    num_started += 1;
+    if(owner->head == SIZE_MAX){
+      owner_list[owner_prev].next = owner->next;
+      num_active -= 1;
+    }
+    else{
+      owner_prev = owner_idx;
+    }
+    owner_idx = owner->next;
+  }
+  num_started += crond_at_run_due(crond);
+  crond->warp_jobs += num_started;
+  CROND_PROBE2(tick_end, crond_probe_ts(), (long)num_started);
+  crond_trace_running(crond);
+}
+
+/**
+ * Print a Prometheus metric family header.
+ *
+ * @param[in,out] fp   Metrics file.
+ * @param[in]     name Metric name.
+ * @param[in]     type Metric type.
+ * @param[in]     help Metric description.
+ */
+static void
+crond_metrics_fprint_header(FILE *const fp,
+                            const char *const name,
+                            const char *const type,
+                            const char *const help){
+  fprintf(fp, "# HELP %s %s\n", name, help);
+  fprintf(fp, "# TYPE %s %s\n", name, type);
+}
+
+/**
+ * Print a label value, escaping the characters that the Prometheus text
+ * format requires.
+ *
+ * @param[in,out] fp    Metrics file.
+ * @param[in]     value Label value.
+ */
+static void
+crond_metrics_fprint_label(FILE *const fp,
+                           const char *const value){
+  const char *c;
+
+  for(c = value; *c; c++){
+    if(*c == '\\' || *c == '"'){
+      fputc('\\', fp);
+      fputc(*c, fp);
+    }
+    else if(*c == '\n'){
+      fputs("\\n", fp);
+    }
+    else{
+      fputc(*c, fp);
+    }
+  }
+}
+
+/**
+ * Print the name and labels of a per-job metric sample.
+ *
+ * The source label contains the file the job got loaded from, see
+ * @ref crond_job_source_name. The caller prints the sample value.
+ *
+ * @param[in,out] fp      Metrics file.
+ * @param[in]     crond   See @ref crond.
+ * @param[in]     name    Metric name.
+ * @param[in]     job_idx Index of the job in @ref crond::job_list.
+ */
+static void
+crond_metrics_fprint_job_name(FILE *const fp,
+                              const struct crond *const crond,
+                              const char *const name,
+                              const size_t job_idx){
+  const struct crond_job *job;
+
+  job = &crond->job_list[job_idx];
+  fprintf(fp, "%s{job=\"%lu\",source=\"", name, (unsigned long)job_idx);
+  crond_metrics_fprint_label(fp, crond_job_source_name(crond, job));
+  fputs("\",command=\"", fp);
+  crond_metrics_fprint_label(fp, job->command);
+  fputs("\"} ", fp);
+}
+
+/**
+ * Print a histogram in the Prometheus text format.
+ *
+ * @param[in,out] fp   Metrics file.
+ * @param[in]     name Metric name.
+ * @param[in]     help Metric description.
+ * @param[in]     hist See @ref crond_histogram.
+ */
+static void
+crond_metrics_fprint_histogram(FILE *const fp,
+                               const char *const name,
+                               const char *const help,
+                               const struct crond_histogram *const hist){
+  size_t i;
+
+  crond_metrics_fprint_header(fp, name, "histogram", help);
+  for(i = 0; i < CROND_HISTOGRAM_NUM_BUCKETS; i++){
+    fprintf(fp,
+            "%s_bucket{le=\"%s\"} %lu\n",
+            name,
+            g_histogram_bucket_le[i],
+            hist->bucket[i]);
+  }
+  fprintf(fp, "%s_bucket{le=\"+Inf\"} %lu\n", name, hist->count);
+  fprintf(fp,
+          "%s_sum %lu.%06lu\n",
+          name,
+          hist->sum_usec / 1000000UL,
+          hist->sum_usec % 1000000UL);
+  fprintf(fp, "%s_count %lu\n", name, hist->count);
+}
+
+/**
+ * Print all metrics in the Prometheus text format.
+ *
+ * @param[in]     crond See @ref crond.
+ * @param[in,out] fp    Metrics file.
+ */
+static void
+crond_metrics_fprint(const struct crond *const crond,
+                     FILE *const fp){
+  size_t i;
+  const struct crond_job *job;
+  struct crond_mem mem;
+
+  crond_metrics_fprint_header(fp,
+                              "crond_jobs",
+                              "gauge",
+                              "Number of loaded jobs, "
+                              "including ephemeral jobs.");
+  fprintf(fp,
+          "crond_jobs %lu\n",
+          (unsigned long)(crond->num_jobs - crond->num_job_free));
+
+  crond_mem_count(crond, &mem);
+  crond_metrics_fprint_header(fp,
+                              "crond_memory_bytes",
+                              "gauge",
+                              "Bytes of memory used by the loaded jobs.");
+  fprintf(fp,
+          "crond_memory_bytes{kind=\"jobs\"} %lu\n"
+          "crond_memory_bytes{kind=\"schedules\"} %lu\n"
+          "crond_memory_bytes{kind=\"commands\"} %lu\n"
+          "crond_memory_bytes{kind=\"stdin\"} %lu\n"
+          "crond_memory_bytes{kind=\"environment\"} %lu\n"
+          "crond_memory_bytes{kind=\"indexes\"} %lu\n"
+          "crond_memory_bytes{kind=\"unused\"} %lu\n",
+          (unsigned long)mem.jobs,
+          (unsigned long)mem.schedules,
+          (unsigned long)mem.commands,
+          (unsigned long)mem.stdin_lines,
+          (unsigned long)mem.environment,
+          (unsigned long)mem.indexes,
+          (unsigned long)mem.unused);
+
+  crond_metrics_fprint_header(fp,
+                              "crond_at_jobs_pending",
+                              "gauge",
+                              "Number of at jobs waiting to run.");
+  fprintf(fp, "crond_at_jobs_pending %lu\n", (unsigned long)crond->num_at);
+
+  crond_metrics_fprint_header(fp,
+                              "crond_job_runs_total",
+                              "counter",
+                              "Number of times the job started.");
+  for(i = 0; i < crond->num_jobs; i++){
+    job = &crond->job_list[i];
+    if(job->command){
+      crond_metrics_fprint_job_name(fp, crond, "crond_job_runs_total", i);
+      fprintf(fp, "%lu\n", job->num_runs);
+    }
+  }
+
+  crond_metrics_fprint_header(fp,
+                              "crond_job_failures_total",
+                              "counter",
+                              "Number of times the job exited with an error.");
+  for(i = 0; i < crond->num_jobs; i++){
+    job = &crond->job_list[i];
+    if(job->command){
+      crond_metrics_fprint_job_name(fp, crond, "crond_job_failures_total", i);
+      fprintf(fp, "%lu\n", job->num_failures);
+    }
+  }
+
+  crond_metrics_fprint_header(fp,
+                              "crond_job_last_duration_seconds",
+                              "gauge",
+                              "Wall time taken by the last completed run.");
+  for(i = 0; i < crond->num_jobs; i++){
+    job = &crond->job_list[i];
+    if(job->command){
+      crond_metrics_fprint_job_name(fp,
+                                    crond,
+                                    "crond_job_last_duration_seconds",
+                                    i);
+      fprintf(fp,
+              "%lu.%03lu\n",
+              job->last_duration_ms / 1000,
+              job->last_duration_ms % 1000);
+    }
+  }
+
+  crond_metrics_fprint_header(fp,
+                              "crond_job_last_exit_code",
+                              "gauge",
+                              "Exit status of the last completed run.");
+  for(i = 0; i < crond->num_jobs; i++){
+    job = &crond->job_list[i];
+    if(job->command){
+      crond_metrics_fprint_job_name(fp, crond, "crond_job_last_exit_code", i);
+      fprintf(fp, "%d\n", job->last_exit_code);
+    }
+  }
+
+  crond_metrics_fprint_header(fp,
+                              "crond_job_running",
+                              "gauge",
+                              "Number of instances of the job still running.");
+  for(i = 0; i < crond->num_jobs; i++){
+    job = &crond->job_list[i];
+    if(job->command){
+      crond_metrics_fprint_job_name(fp, crond, "crond_job_running", i);
+      fprintf(fp, "%u\n", job->num_running);
+    }
+  }
+
+  crond_metrics_fprint_histogram(fp,
+                                 "crond_dispatch_lateness_seconds",
+                                 "Delay from the start of the minute until "
+                                 "the job started.",
+                                 &crond->hist_lateness);
+  crond_metrics_fprint_histogram(fp,
+                                 "crond_reload_duration_seconds",
+                                 "Time taken to reload the crontab.",
+                                 &crond->hist_reload);
+}
+
+/**
+ * Write the metrics file if the statistics changed.
+ *
+ * Updates get rate limited to one every @ref CROND_METRICS_INTERVAL_SEC
+ * seconds. The metrics get written to a temporary file and then renamed so
+ * that readers never see a partially written file. Failing to write the
+ * metrics does not stop crond.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     now   Current time.
+ * @param[in]     force Set to true to skip the rate limit.
+ */
+static void
+crond_metrics_update(struct crond *const crond,
+                     const struct timespec *const now,
+                     const bool force){
+  FILE *fp;
+  bool written;
+
+  if(crond->path_metrics &&
+     crond->metrics_dirty &&
+     crond_readonly(crond) == false &&
+     (force ||
+      now->tv_sec - crond->ts_metrics.tv_sec >= CROND_METRICS_INTERVAL_SEC ||
+      now->tv_sec < crond->ts_metrics.tv_sec)){
+    written = false;
+    fp = fopen(crond->path_metrics_tmp, "w");
+    if(fp){
+      crond_metrics_fprint(crond, fp);
+      if(ferror(fp)){
+        fclose(fp);
+      }
+      else if(fclose(fp) == 0 &&
+              rename(crond->path_metrics_tmp, crond->path_metrics) == 0){
+        written = true;
+      }
+    }
+    if(written == false){
+      crond_fprintf_stderr("failed to write metrics: %s", crond->path_metrics);
+    }
+    crond->metrics_dirty = false;
+    memcpy(&crond->ts_metrics, now, sizeof(crond->ts_metrics));
+  }
+}
+
+/**
+ * Get path to the crond lock file.
+ *
+ * @param[in] path_crontab Path to crontab file.
+ * @retval    char*        Path to the lock file. The caller must free this
+ *                         when finished.
+ * @retval    NULL         Memory allocation failed.
+ */
+CRON_LINKAGE char *
+crond_get_path_lock_file(const char *const path_crontab){
+  return crond_get_path_suffix(path_crontab, ".lock");
+}
+
+/**
+ * Create a lock file for this user.
+ *
+ * The lock file contains the process ID of crond and gets locked with
+ * flock, which the kernel releases when crond exits for any reason. A
+ * lock file left behind by a crond that crashed or got killed does not
+ * stop the next crond from starting.
+ *
+ * After @ref crond_reexec, the new program image keeps the lock file
+ * inherited from the previous one. A dry run with -n does not take the
+ * lock, so that it can run next to the crond running the jobs.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_lock_file_create(struct crond *const crond){
+  const int oflag = O_CREAT | O_WRONLY | O_CLOEXEC;
+  const mode_t mode = S_IRUSR | S_IWUSR;
+  struct stat sb_fd;
+  struct stat sb_path;
+  bool retry;
+
+  crond->path_lock_file = crond_get_path_lock_file(crond->path_crontab);
+  if(crond->path_lock_file == NULL){
+    crond_errx_noexit(crond, "failed to get lock file path");
+  }
+  else if(crond->path_record){
+    crond->fd_lock_file = -1;
+  }
+  else if(crond->flags & CROND_FLAG_REEXEC){
+    /* Inherited from crond_reexec. */
+  }
+  else{
+    do{
+      retry = false;
+      crond->fd_lock_file = open(crond->path_lock_file, oflag, mode);
+      if(crond->fd_lock_file < 0){
+        crond_errx_noexit(crond, "failed to create lock file");
+      }
+      else if(flock(crond->fd_lock_file, LOCK_EX | LOCK_NB) != 0){
+        if(errno == EWOULDBLOCK){
+          crond_errx_noexit(crond,
+                            "crond already running: %s",
+                            crond->path_lock_file);
+        }
+        else{
+          crond_errx_noexit(crond, "failed to lock lock file");
+        }
+        close(crond->fd_lock_file);
+        crond->fd_lock_file = -1;
+      }
+      else if(fstat(crond->fd_lock_file, &sb_fd) != 0 ||
+              lstat(crond->path_lock_file, &sb_path) != 0 ||
+              sb_fd.st_dev != sb_path.st_dev ||
+              sb_fd.st_ino != sb_path.st_ino){
+        /*
+         * The previous crond removed the lock file after it got opened
+         * here, so the lock does not protect the current lock file.
+         */
+        close(crond->fd_lock_file);
+        crond->fd_lock_file = -1;
+        retry = true;
+      }
+      else if(ftruncate(crond->fd_lock_file, 0) != 0 ||
+              dprintf(crond->fd_lock_file, "%ld\n", (long)getpid()) < 0){
+        crond_errx_noexit(crond, "failed to write lock file");
+      }
+    } while(retry);
+  }
+}
+
+/**
+ * Remove the lock file.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_lock_file_delete(struct crond *const crond){
+  if(crond->fd_lock_file > 0){
+    /*
+     * Remove the file while still holding the lock, see
+     * crond_lock_file_create.
+     */
+    if(remove(crond->path_lock_file) != 0){
+      crond_fprintf_stderr("failed to remove lock file: %s",
+                           crond->path_lock_file);
+    }
+    if(close(crond->fd_lock_file) != 0){
+      crond_errx_noexit(crond, "failed to close lock file");
+    }
   }
-  bytes_to_write = datasz;
-  while(bytes_to_write){
-    bytes_written = write(pipe_write[1],
-                          &data[datasz - bytes_to_write],
-                          bytes_to_write);
-    if(bytes_written < 0){
-      if(errno != EINTR){
-        exit(EXIT_FAILURE);
-      }
+}
+
+/**
+ * Set a file descriptor to non-blocking and close-on-exec.
+ *
+ * @param[in] fd File descriptor.
+ * @retval    0  Successfully set the flags.
+ * @retval    -1 Failed to set the flags.
+ */
+static int
+crond_fd_set_nonblock(const int fd){
+  int fl;
+  int rc;
+
+  rc = -1;
+  fl = fcntl(fd, F_GETFL);
+  if(fl >= 0 &&
+     fcntl(fd, F_SETFL, fl | O_NONBLOCK) == 0 &&
+     fcntl(fd, F_SETFD, FD_CLOEXEC) == 0){
+    rc = 0;
+  }
+  return rc;
+}
+
+/**
+ * Create the control socket next to the crontab file.
+ *
+ * Any existing socket file gets replaced because the lock file guarantees
+ * that no other crond process uses it. Failing to create the control
+ * socket does not stop crond.
+ *
+ * After @ref crond_reexec, the new program image keeps listening on the
+ * inherited socket so that no connection gets refused. A dry run with -n
+ * leaves the socket to the crond running the jobs.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_control_open(struct crond *const crond){
+  const mode_t mode = S_IRUSR | S_IWUSR;
+
+  if((crond->flags & CROND_FLAG_REEXEC) == 0){
+    crond->fd_control = -1;
+  }
+  if(crond->status_code == 0 && crond->path_record == NULL){
+    if(cron_get_control_addr(crond->path_crontab,
+                             &crond->addr_control) != 0){
+      crond_fprintf_stderr("control socket path too long");
+      memset(&crond->addr_control, 0, sizeof(crond->addr_control));
+    }
+    else if(crond->fd_control >= 0){
+      /* Inherited from crond_reexec. */
     }
     else{
-      bytes_to_write -= (size_t)bytes_written;
+      unlink(crond->addr_control.sun_path);
+      crond->fd_control = socket(AF_UNIX, SOCK_STREAM, 0);
+      if(crond->fd_control < 0 ||
+         crond_fd_set_nonblock(crond->fd_control) != 0 ||
+         bind(crond->fd_control,
+              (const struct sockaddr *)&crond->addr_control,
+              sizeof(crond->addr_control)) != 0 ||
+         chmod(crond->addr_control.sun_path, mode) != 0 ||
+         listen(crond->fd_control, CROND_CONTROL_MAX_CLIENTS) != 0){
+        crond_fprintf_stderr("failed to create control socket: %s",
+                             crond->addr_control.sun_path);
+        if(crond->fd_control >= 0){
+          close(crond->fd_control);
+          crond->fd_control = -1;
+          unlink(crond->addr_control.sun_path);
+        }
+      }
     }
   }
-  if(close(pipe_write[1]) != 0){
-    exit(EXIT_FAILURE);
-  }
 }
 
 /**
- * Send mail of job output to the user.
+ * Close a control socket connection.
  *
- * @param[in] crond       See @ref crond.
- * @param[in] command_str The shell command that ran when launching the job.
- * @param[in] body        Program output to send in the mail body.
- * @param[in] bodysz      Number of bytes in @p body.
+ * @param[in,out] crond      See @ref crond.
+ * @param[in]     client_idx Index of the connection in
+ *                           @ref crond::client_list.
  */
 static void
-crond_mailx(const struct crond *const crond,
-            const char *const command_str,
-            const char *const body,
-            const size_t bodysz){
-  char subject[CROND_MAX_SUBJECT_LEN];
-  pid_t pid_mailx;
-  int pipe_write[2];
+crond_control_client_close(struct crond *const crond,
+                           const size_t client_idx){
+  struct crond_client *client;
 
-  /* Allow subject to get truncated. */
-  if(snprintf(subject,
-              sizeof(subject),
-              "Cron <%s> %s",
-              crond->email_to,
-              command_str) < 0){
-    exit(EXIT_FAILURE);
+  client = &crond->client_list[client_idx];
+  close(client->fd);
+  free(client->out_buf);
+  crond->num_clients -= 1;
+  memmove(client,
+          &crond->client_list[crond->num_clients],
+          sizeof(*client));
+}
+
+/**
+ * Close the control socket, all of its connections, and remove the socket
+ * file.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_control_close(struct crond *const crond){
+  while(crond->num_clients){
+    crond_control_client_close(crond, crond->num_clients - 1);
+  }
+  free(crond->client_list);
+  crond->client_list = NULL;
+  if(crond->fd_control >= 0){
+    close(crond->fd_control);
+    crond->fd_control = -1;
+    unlink(crond->addr_control.sun_path);
   }
+}
 
-  if(pipe(pipe_write) != 0){
-    exit(EXIT_FAILURE);
+/**
+ * Accept pending connections on the control socket.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     now   Current time.
+ */
+static void
+crond_control_accept(struct crond *const crond,
+                     const struct timespec *const now){
+  int fd;
+  struct crond_client *client_list;
+  struct crond_client *client;
+
+  while(crond->num_clients < CROND_CONTROL_MAX_CLIENTS &&
+        (fd = accept(crond->fd_control, NULL, NULL)) >= 0){
+    client_list = NULL;
+    if(fd < FD_SETSIZE && crond_fd_set_nonblock(fd) == 0){
+      client_list = crond_reallocarray(crond->client_list,
+                                       crond->num_clients + 1,
+                                       sizeof(*crond->client_list));
+    }
+    if(client_list == NULL){
+      close(fd);
+    }
+    else{
+      crond->client_list = client_list;
+      client = &crond->client_list[crond->num_clients];
+      memset(client, 0, sizeof(*client));
+      client->fd = fd;
+      client->accept_sec = now->tv_sec;
+      crond->num_clients += 1;
+    }
   }
-  pid_mailx = fork();
-  if(pid_mailx == -1){
-    exit(EXIT_FAILURE);
+}
+
+/**
+ * Get the job referenced by a control request argument.
+ *
+ * Ephemeral jobs can also get referenced by INDEX.SERIAL, which only
+ * matches the job while it remains loaded and does not match a later job
+ * that reuses the same index.
+ *
+ * @param[in]  crond   See @ref crond.
+ * @param[in]  arg     Job index in decimal, or INDEX.SERIAL.
+ * @param[out] job_idx Index of the job in @ref crond::job_list.
+ * @retval     0       Found the job.
+ * @retval     -1      @p arg does not reference a loaded job.
+ */
+static int
+crond_control_job_idx(const struct crond *const crond,
+                      const char *const arg,
+                      size_t *const job_idx){
+  unsigned long ul;
+  unsigned long serial;
+  const struct crond_job *job;
+  char *ep;
+  int rc;
+
+  rc = -1;
+  if(arg && isdigit((unsigned char)*arg)){
+    errno = 0;
+    ul = strtoul(arg, &ep, 10);
+    if(errno == 0 && ul < crond->num_jobs){
+      job = &crond->job_list[ul];
+      if(*ep == '.' && isdigit((unsigned char)ep[1])){
+        serial = strtoul(&ep[1], &ep, 10);
+        if(errno != 0 || job->ephemeral == false || job->serial != serial){
+          job = NULL;
+        }
+      }
+      if(job && job->command && *ep == '\0'){
+        *job_idx = (size_t)ul;
+        rc = 0;
+      }
+    }
   }
-  else if(pid_mailx == 0){
-#ifdef CRON_TEST
-    g_test_seam_err_in_fork_mailx = true;
-#endif /* CRON_TEST */
-    if(dup2(pipe_write[0], STDIN_FILENO) >= 0 &&
-       close(pipe_write[0])              == 0 &&
-       close(pipe_write[1])              == 0){
-      execlp("mailx", "mailx", "-s", subject, crond->email_to, NULL);
+  return rc;
+}
+
+/**
+ * Add an ephemeral job in response to the add control command.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     arg   TTL in seconds followed by a crontab line. A TTL of
+ *                      0 keeps the job until it gets removed.
+ * @param[in,out] fp    Response stream.
+ */
+static void
+crond_control_add(struct crond *const crond,
+                  const char *const arg,
+                  FILE *const fp){
+  unsigned long ttl;
+  char *ep;
+  time_t expire;
+  size_t job_idx;
+  const struct crond_job *job;
+
+  ep = NULL;
+  ttl = 0;
+  if(arg && isdigit((unsigned char)*arg)){
+    errno = 0;
+    ttl = strtoul(arg, &ep, 10);
+    if(errno != 0 || *ep != ' ' || ttl > LONG_MAX / 2){
+      ep = NULL;
     }
-    exit(EXIT_FAILURE);
+  }
+  if(ep == NULL){
+    fputs("error: invalid ttl\n", fp);
   }
   else{
-    crond_fd_write(pipe_write, body, bodysz);
-    crond_waitpid(crond, pid_mailx);
+    ep += strspn(ep, " ");
+    expire = 0;
+    if(ttl){
+      expire = crond->ts_now.tv_sec + (time_t)ttl;
+    }
+    if(crond_ephemeral_add(crond,
+                           ep,
+                           crond->job_serial,
+                           expire,
+                           &job_idx) == false){
+      fputs("error: invalid job\n", fp);
+    }
+    else{
+      job = &crond->job_list[job_idx];
+      crond->job_serial += 1;
+      if(crond_ephemeral_save(crond, job, ep) != 0){
+        crond_job_remove(crond, job_idx);
+        fputs("error: failed to persist job\n", fp);
+      }
+      else{
+        crond_verbose(crond, "added ephemeral job: %s", job->command);
+        fprintf(fp,
+                "ok %lu.%lu\n",
+                (unsigned long)job_idx,
+                job->serial);
+      }
+    }
   }
 }
 
 /**
- * Launch the job in a new process.
+ * Print the loaded jobs in response to the list control command.
  *
- * This will create two child processes:
- *   - A monitor process that checks for STDOUT and STDERR output from
- *     the command. If it does generate output, then that will get mailed to
- *     the user.
- *   - A command process that runs the job in the shell.
+ * Each line contains the job index (INDEX.SERIAL for ephemeral jobs),
+ * state, number of running instances, next run time, and command.
  *
- * @verbatim
-   <crond>----------------------------> Continue processing next job and sleep
-        |      |       |
-        |      |       |
-        |      |       <jobmon>----------------> No email if no STDOUT/STDERR
-        |      |              |
-        |      |              |
-        |      |              |
-        |      |              |
-        |      |              <command>--------> /bin/sh
-        |      |
-        |      |
-        |      <jobmon>------------------------> Send email with STDOUT/STDERR
-        |             |         ^         ^
-        |             |         |         |
-        |             |         | STDOUT  | STDERR
-        |             |         |         |
-        |             <command>----------------> /bin/sh
-        |
-        |
-        <jobmon>-----------------------------> Send email with STDOUT/STDERR
-              |         ^         ^
-              |         |         |
-              |         | STDOUT  | STDERR
-              |         |         |
-              <command>----------------------> /bin/sh
- * @endverbatim
+ * @param[in]     crond See @ref crond.
+ * @param[in,out] fp    Response stream.
+ */
+static void
+crond_control_list(const struct crond *const crond,
+                   FILE *const fp){
+  size_t i;
+  const struct crond_job *job;
+  struct tm tm_next;
+  char next[sizeof("YYYY-MM-DDTHH:MM")];
+
+  for(i = 0; i < crond->num_jobs; i++){
+    job = &crond->job_list[i];
+    if(job->command == NULL){
+      continue;
+    }
+    if(crond_job_next(job, crond_job_tm(crond, job), &tm_next) != 0 ||
+       strftime(next, sizeof(next), "%Y-%m-%dT%H:%M", &tm_next) == 0){
+      strcpy(next, "-");
+    }
+    fprintf(fp, "%lu", (unsigned long)i);
+    if(job->ephemeral){
+      fprintf(fp, ".%lu", job->serial);
+    }
+    fprintf(fp,
+            " %s %u %s %s\n",
+            job->at_time ? "at" : job->paused ? "paused" : "active",
+            job->num_running,
+            next,
+            job->command);
+  }
+}
+
+/**
+ * Run a control request and store the response in the connection.
  *
- * @param[in] crond See @ref crond.
- * @param[in] job   See @ref crond_job.
+ * Requests:
+ *   - list        : Print the loaded jobs, see @ref crond_control_list.
+ *   - run <job>   : Run a job now.
+ *   - reload      : Reload the crontab file.
+ *   - pause <job> : Skip the scheduled runs of a job.
+ *   - resume <job>: Stop skipping the scheduled runs of a job.
+ *   - stats       : Print the metrics, see @ref crond_metrics_fprint.
+ *   - add <ttl> <line>: Add an ephemeral job, see @ref crond_control_add.
+ *   - remove <job>: Remove an ephemeral job.
+ *   - at <time> <command>: Queue an at job, see @ref crond_control_at.
+ *   - atq         : Print the pending at jobs, see @ref crond_control_atq.
+ *   - atrm <at job>: Remove a pending at job.
+ *
+ * Failed requests get a response starting with "error:".
+ *
+ * @param[in,out] crond  See @ref crond.
+ * @param[in,out] client See @ref crond_client.
  */
 static void
-crond_job_run(const struct crond *const crond,
-              const struct crond_job *const job){
-  pid_t pid_jobmon;
-  pid_t pid_cmd;
-  int pipe_read[2];
-  int pipe_write[2];
-  ssize_t bytes_read;
-  char read_buf[CRON_READ_BUFFER_SZ];
-  char *mail_body;
-  size_t mail_body_sz;
-  size_t old_mail_body_sz;
-  char *new_mail_body;
+crond_control_request(struct crond *const crond,
+                      struct crond_client *const client){
+  FILE *fp;
+  char *cmd;
+  char *arg;
+  size_t job_idx;
 
-  crond_verbose(crond, "running job: %s", job->command);
-  pid_jobmon = fork();
-  if(pid_jobmon == -1){
-    crond_verbose(crond, "failed to execute job");
+  cmd = client->in_buf;
+  cmd[strcspn(cmd, "\r\n")] = '\0';
+  arg = strchr(cmd, ' ');
+  if(arg){
+    *arg = '\0';
+    arg += 1;
   }
-  else if(pid_jobmon == 0){
-#ifdef CRON_TEST
-    g_test_seam_err_in_fork_jobmon = true;
-#endif /* CRON_TEST */
-    if(pipe(pipe_read ) != 0 ||
-       pipe(pipe_write) != 0){
-      exit(EXIT_FAILURE);
+  crond_verbose(crond, "control request: %s", cmd);
+  fp = open_memstream(&client->out_buf, &client->out_len);
+  if(fp){
+    if(strcmp(cmd, "list") == 0){
+      crond_control_list(crond, fp);
     }
-    pid_cmd = fork();
-    if(pid_cmd == -1){
-      exit(EXIT_FAILURE);
+    else if(strcmp(cmd, "stats") == 0){
+      crond_metrics_fprint(crond, fp);
     }
-    else if(pid_cmd == 0){
-      if(dup2(pipe_read[1] , STDOUT_FILENO) >= 0 &&
-         dup2(pipe_read[1] , STDERR_FILENO) >= 0 &&
-         dup2(pipe_write[0], STDIN_FILENO ) >= 0 &&
-         close(pipe_read[0])                == 0 &&
-         close(pipe_read[1])                == 0 &&
-         close(pipe_write[0])               == 0 &&
-         close(pipe_write[1])               == 0){
-        execle(crond->path_shell,
-               crond->path_shell,
-               "-c",
-               job->command,
-               NULL,
-               NULL);
-      }
-      exit(EXIT_FAILURE);
+    else if(strcmp(cmd, "reload") == 0){
+      crond_crontab_reparse(crond, true);
+      fputs("ok\n", fp);
     }
-    if(close(pipe_read[1]) != 0){
-      exit(EXIT_FAILURE);
+    else if(strcmp(cmd, "add") == 0){
+      crond_control_add(crond, arg, fp);
     }
-    crond_fd_write(pipe_write, job->stdin_lines, job->stdin_lines_len);
-    mail_body = NULL;
-    mail_body_sz = 0;
-    do{
-      bytes_read = read(pipe_read[0], read_buf, sizeof(read_buf));
-      if(bytes_read < 0){
-        if(errno != EINTR){
-          exit(EXIT_FAILURE);
-        }
+    else if(strcmp(cmd, "at") == 0){
+      crond_control_at(crond, arg, fp);
+    }
+    else if(strcmp(cmd, "atq") == 0){
+      crond_control_atq(crond, fp);
+    }
+    else if(strcmp(cmd, "atrm") == 0){
+      crond_control_atrm(crond, arg, fp);
+    }
+    else if(strcmp(cmd, "run"   ) == 0 ||
+            strcmp(cmd, "pause" ) == 0 ||
+            strcmp(cmd, "resume") == 0 ||
+            strcmp(cmd, "remove") == 0){
+      if(crond_control_job_idx(crond, arg, &job_idx) != 0){
+        fputs("error: no such job\n", fp);
       }
-      else if(bytes_read){
-        old_mail_body_sz = mail_body_sz;
-        if(si_add_size_t(mail_body_sz, (size_t)bytes_read, &mail_body_sz)){
-          exit(EXIT_FAILURE);
+      else if(strcmp(cmd, "remove") == 0 &&
+              crond->job_list[job_idx].ephemeral == false){
+        fputs("error: not an ephemeral job\n", fp);
+      }
+      else{
+        if(strcmp(cmd, "remove") == 0){
+          crond_ephemeral_remove(crond, job_idx);
+        }
+        else if(strcmp(cmd, "run") == 0){
+          crond_job_run(crond, job_idx, false);
         }
         else{
-          new_mail_body = realloc(mail_body, mail_body_sz);
-          if(new_mail_body == NULL){
-            free(mail_body);
-            exit(EXIT_FAILURE);
-          }
-          mail_body = new_mail_body;
-          memcpy(&mail_body[old_mail_body_sz], read_buf, (size_t)bytes_read);
+          crond->job_list[job_idx].paused = strcmp(cmd, "pause") == 0;
         }
+        fputs("ok\n", fp);
       }
-    } while(bytes_read);
-    if(close(pipe_read[0]) != 0){
-      exit(EXIT_FAILURE);
     }
-    crond_waitpid(crond, pid_cmd);
-    if(mail_body){
-      crond_mailx(crond,
-                  job->command,
-                  mail_body,
-                  mail_body_sz);
+    else{
+      fputs("error: unknown command\n", fp);
+    }
+    if(fclose(fp) != 0){
+      free(client->out_buf);
+      client->out_buf = NULL;
+    }
+  }
+}
+
+/**
+ * Read a request from a control socket connection.
+ *
+ * @param[in,out] crond      See @ref crond.
+ * @param[in]     client_idx Index of the connection in
+ *                           @ref crond::client_list.
+ * @retval        true       Keep the connection open.
+ * @retval        false      Close the connection.
+ */
+static bool
+crond_control_read(struct crond *const crond,
+                   const size_t client_idx){
+  struct crond_client *client;
+  ssize_t bytes_read;
+  bool keep_open;
+
+  client = &crond->client_list[client_idx];
+  keep_open = true;
+  bytes_read = read(client->fd,
+                    &client->in_buf[client->in_len],
+                    sizeof(client->in_buf) - client->in_len - 1);
+  if(bytes_read < 0){
+    if(errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK){
+      keep_open = false;
+    }
+  }
+  else if(bytes_read == 0){
+    keep_open = false;
+  }
+  else{
+    client->in_len += (size_t)bytes_read;
+    client->in_buf[client->in_len] = '\0';
+    if(strchr(client->in_buf, '\n') ||
+       client->in_len == sizeof(client->in_buf) - 1){
+      crond_control_request(crond, client);
+      if(client->out_buf == NULL){
+        keep_open = false;
+      }
+    }
+  }
+  return keep_open;
+}
+
+/**
+ * Send the remaining response on a control socket connection.
+ *
+ * @param[in,out] client See @ref crond_client.
+ * @retval        true   Keep the connection open.
+ * @retval        false  Close the connection.
+ */
+static bool
+crond_control_write(struct crond_client *const client){
+  ssize_t bytes_written;
+  bool keep_open;
+
+  keep_open = true;
+  bytes_written = write(client->fd,
+                        &client->out_buf[client->out_off],
+                        client->out_len - client->out_off);
+  if(bytes_written < 0){
+    if(errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK){
+      keep_open = false;
+    }
+  }
+  else{
+    client->out_off += (size_t)bytes_written;
+    if(client->out_off == client->out_len){
+      keep_open = false;
+    }
+  }
+  return keep_open;
+}
+
+/**
+ * Add the control socket descriptors to the sets passed to pselect.
+ *
+ * @param[in]     crond    See @ref crond.
+ * @param[in,out] readfds  Descriptors waiting for a request.
+ * @param[in,out] writefds Descriptors waiting to send a response.
+ * @return                 Highest descriptor number plus one.
+ */
+static int
+crond_control_fd_set(const struct crond *const crond,
+                     fd_set *const readfds,
+                     fd_set *const writefds){
+  size_t i;
+  const struct crond_client *client;
+  int nfds;
+
+  nfds = 0;
+  FD_ZERO(readfds);
+  FD_ZERO(writefds);
+  if(crond->fd_control >= 0 &&
+     crond->num_clients < CROND_CONTROL_MAX_CLIENTS){
+    FD_SET(crond->fd_control, readfds);
+    nfds = crond->fd_control + 1;
+  }
+  for(i = 0; i < crond->num_clients; i++){
+    client = &crond->client_list[i];
+    if(client->out_buf){
+      FD_SET(client->fd, writefds);
+    }
+    else{
+      FD_SET(client->fd, readfds);
+    }
+    if(client->fd >= nfds){
+      nfds = client->fd + 1;
     }
-    exit(EXIT_SUCCESS);
   }
+  return nfds;
 }
 
 /**
- * Check if each job needs to run and execute the job if it does.
+ * Serve the control socket descriptors that pselect reported as ready.
  *
- * @param[in] crond See @ref crond.
+ * Connections that have not completed within
+ * @ref CROND_CONTROL_TIMEOUT_SEC seconds get closed.
+ *
+ * @param[in,out] crond    See @ref crond.
+ * @param[in]     readfds  Descriptors ready for reading.
+ * @param[in]     writefds Descriptors ready for writing.
+ * @param[in]     now      Current time.
  */
 static void
-crond_job_list_run(const struct crond *const crond){
+crond_control_serve(struct crond *const crond,
+                    const fd_set *const readfds,
+                    const fd_set *const writefds,
+                    const struct timespec *const now){
   size_t i;
-  const struct crond_job *job;
+  struct crond_client *client;
+  bool keep_open;
 
-  for(i = 0; i < crond->num_jobs; i++){
-    job = &crond->job_list[i];
-    if(crond_job_should_run(crond, job)){
-      crond_job_run(crond, job);
+  i = crond->num_clients;
+  while(i > 0){
+    i -= 1;
+    client = &crond->client_list[i];
+    if(client->out_buf && FD_ISSET(client->fd, writefds)){
+      keep_open = crond_control_write(client);
+    }
+    else if(client->out_buf == NULL && FD_ISSET(client->fd, readfds)){
+      keep_open = crond_control_read(crond, i);
+    }
+    else{
+      keep_open = true;
     }
+    if(keep_open == false ||
+       now->tv_sec - client->accept_sec >= CROND_CONTROL_TIMEOUT_SEC ||
+       now->tv_sec < client->accept_sec){
+      crond_control_client_close(crond, i);
+    }
+  }
+  if(crond->fd_control >= 0 && FD_ISSET(crond->fd_control, readfds)){
+    crond_control_accept(crond, now);
   }
 }
 
 /**
- * Get path to the crond lock file.
+ * Get the drop-in directory path and create the inotify instance that
+ * watches it, see @ref crond_dropin_scan.
  *
- * @param[in] path_crontab Path to crontab file.
- * @retval    char*        Path to the lock file. The caller must free this
- *                         when finished.
- * @retval    NULL         Memory allocation failed.
+ * Failing to create the inotify instance does not stop crond, which then
+ * checks the drop-in directory for changes once a minute.
+ *
+ * @param[in,out] crond See @ref crond.
  */
-CRON_LINKAGE char *
-crond_get_path_lock_file(const char *const path_crontab){
-  const char *const lock_file_suffix = ".lock";
-  char *path_lock_file;
-  size_t path_crontab_len;
-  size_t lock_file_suffix_len;
-  size_t alloc_len;
-  char *copy_ptr;
-
-  path_lock_file = NULL;
-  if(path_crontab){
-    path_crontab_len = strlen(path_crontab);
-    lock_file_suffix_len = strlen(lock_file_suffix);
-    if(si_add_size_t(path_crontab_len,
-                     lock_file_suffix_len + 1,
-                     &alloc_len) == 0){
-      path_lock_file = malloc(alloc_len);
-      if(path_lock_file){
-        copy_ptr = stpcpy(path_lock_file, path_crontab);
-        stpcpy(copy_ptr, lock_file_suffix);
+static void
+crond_dropin_open(struct crond *const crond){
+  if(crond->status_code == 0){
+    crond->path_dropin = crond_get_path_suffix(crond->path_crontab,
+                                               CROND_DROPIN_SUFFIX);
+    if(crond->path_dropin == NULL){
+      crond_errx_noexit(crond, "failed to get drop-in directory path");
+    }
+    else{
+      crond->fd_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+      if(crond->fd_inotify < 0){
+        crond_fprintf_stderr("failed to watch drop-in directory");
       }
     }
   }
-  return path_lock_file;
 }
 
 /**
- * Create a lock file for this user.
+ * Discard the pending inotify events.
  *
- * @param[in,out] crond See @ref crond.
+ * The events only wake crond up to check the drop-in directory, so their
+ * contents do not matter.
+ *
+ * @param[in] crond See @ref crond.
  */
 static void
-crond_lock_file_create(struct crond *const crond){
-  const int oflag = O_CREAT | O_EXCL | O_WRONLY | O_TRUNC | O_CLOEXEC;
-  const mode_t mode = S_IWUSR;
+crond_dropin_read(const struct crond *const crond){
+  char buf[4096];
 
-  crond->path_lock_file = crond_get_path_lock_file(crond->path_crontab);
-  if(crond->path_lock_file == NULL){
-    crond_errx_noexit(crond, "failed to get lock file path");
-  }
-  else{
-    crond->fd_lock_file = open(crond->path_lock_file, oflag, mode);
-    if(crond->fd_lock_file < 0){
-      if(errno == EEXIST){
-        crond_errx_noexit(crond,
-                          "crond already running: %s",
-                          crond->path_lock_file);
-      }
-      else{
-        crond_errx_noexit(crond, "failed to create lock file");
-      }
-    }
+  while(read(crond->fd_inotify, buf, sizeof(buf)) > 0){
+    /* Keep reading until no events remain. */
   }
 }
 
 /**
- * Remove the lock file.
+ * Close the inotify instance and free @ref crond::source_list.
  *
  * @param[in,out] crond See @ref crond.
  */
 static void
-crond_lock_file_delete(struct crond *const crond){
-  if(crond->fd_lock_file > 0){
-    if(close(crond->fd_lock_file) != 0){
-      crond_errx_noexit(crond, "failed to close lock file");
-    }
-    if(remove(crond->path_lock_file) != 0){
-      crond_fprintf_stderr("failed to remove lock file: %s",
-                           crond->path_lock_file);
-    }
+crond_dropin_close(struct crond *const crond){
+  size_t i;
+
+  if(crond->fd_inotify >= 0){
+    close(crond->fd_inotify);
+    crond->fd_inotify = -1;
   }
+  for(i = 0; i < crond->num_sources; i++){
+    free(crond->source_list[i].name);
+  }
+  free(crond->source_list);
+  crond->source_list = NULL;
+  crond->num_sources = 0;
 }
 
 /**
@@ -989,21 +5806,23 @@ static void
 crond_gettime(struct crond *const crond){
   struct timespec timespec;
 
-  if(clock_gettime(CLOCK_REALTIME, &timespec) != 0){
-    crond_errx_noexit(crond, "clock_gettime");
-  }
-  else{
+  if(crond_clock(crond, CLOCK_REALTIME, &timespec) == 0){
+    memcpy(&crond->ts_now, &timespec, sizeof(crond->ts_now));
     crond->tm = localtime(&timespec.tv_sec);
     if(crond->tm == NULL){
       crond_errx_noexit(crond, "localtime_r");
     }
+    else{
+      crond_zone_list_update(crond);
+    }
   }
 }
 
 /**
- * Catch the SIGTERM/SIGINT signals and set the global indicator.
+ * Catch the SIGTERM/SIGINT/SIGHUP/SIGCHLD/SIGUSR2 signals and set the
+ * global indicator.
  *
- * @param[in] signum SIGTERM or SIGHUP.
+ * @param[in] signum SIGTERM, SIGINT, SIGHUP, SIGCHLD, or SIGUSR2.
  */
 static void
 crond_signal_handler(const int signum){
@@ -1013,27 +5832,52 @@ crond_signal_handler(const int signum){
   else if(signum == SIGINT){
     g_signal_sigint = 1;
   }
+  else if(signum == SIGHUP){
+    g_signal_sighup = 1;
+  }
+  else if(signum == SIGCHLD){
+    g_signal_sigchld = 1;
+  }
+  else if(signum == SIGUSR2){
+    g_signal_sigusr2 = 1;
+  }
 }
 
 /**
  * Set up the default signal handlers.
  *
+ *   - SIGCHLD: Cron will catch this and reap the job monitor process.
  *   - SIGHUP : Cron will catch this and reload the crontab file.
  *   - SIGINT : Cron will catch this and cleanly exit.
  *   - SIGTERM: Cron will catch this and cleanly exit.
+ *   - SIGUSR2: Cron will catch this and execute itself again.
+ *
+ * These signals stay blocked except while crond sleeps in
+ * @ref crond_sleep, so that they cannot arrive between checking the signal
+ * indicators and going to sleep.
  *
  * @param[in,out] crond See @ref crond.
  */
 static void
 crond_signal_set(struct crond *const crond){
   struct sigaction sact;
+  sigset_t sigmask_block;
 
   sact.sa_handler = crond_signal_handler;
   sact.sa_flags = SA_RESTART;
   if(sigemptyset(&sact.sa_mask) != 0 ||
      cron_sigaction(SIGHUP , &sact, NULL) != 0 ||
      cron_sigaction(SIGINT , &sact, NULL) != 0 ||
-     cron_sigaction(SIGTERM, &sact, NULL) != 0){
+     cron_sigaction(SIGTERM, &sact, NULL) != 0 ||
+     cron_sigaction(SIGCHLD, &sact, &crond->sigact_sigchld_orig) != 0 ||
+     cron_sigaction(SIGUSR2, &sact, NULL) != 0 ||
+     sigemptyset(&sigmask_block) != 0 ||
+     sigaddset(&sigmask_block, SIGCHLD) != 0 ||
+     sigaddset(&sigmask_block, SIGHUP ) != 0 ||
+     sigaddset(&sigmask_block, SIGINT ) != 0 ||
+     sigaddset(&sigmask_block, SIGTERM) != 0 ||
+     sigaddset(&sigmask_block, SIGUSR2) != 0 ||
+     sigprocmask(SIG_BLOCK, &sigmask_block, &crond->sigmask_orig) != 0){
     crond_errx_noexit(crond, "signal set");
   }
 }
@@ -1093,22 +5937,12 @@ crond_get_user_name(char *const user_name,
  */
 static void
 crond_get_email_to(struct crond *const crond){
-  char host_name[CROND_MAX_HOST_NAME_SZ];
   char user_name[CROND_MAX_USER_NAME];
-  char *email_to;
-
-  /*
-   * Do not care if this truncates since we will force a null-terminator
-   * after the call.
-   */
-  gethostname(host_name, sizeof(host_name));
-  host_name[sizeof(host_name) - 1] = '\0';
 
   crond_get_user_name(user_name, sizeof(user_name));
-
-  email_to = stpcpy(crond->email_to, user_name);
-  email_to = stpcpy(email_to, "@");
-  stpcpy(email_to, host_name);
+  if(crond_set_email_to(crond, user_name) != 0){
+    crond_errx_noexit(crond, "failed to set email address");
+  }
 }
 
 /**
@@ -1117,6 +5951,7 @@ crond_get_email_to(struct crond *const crond){
  * This should only happen if:
  *   - An error occurred causing the exit status code to get set.
  *   - SIGTERM signal caught.
+ *   - The virtual clock passed the end time given to -w.
  *
  * @param[in] crond See @ref crond.
  * @retval    true  Cron should exit.
@@ -1128,7 +5963,9 @@ crond_should_exit(const struct crond *const crond){
 
   if(crond->status_code == 0 &&
      g_signal_sigterm   == 0 &&
-     g_signal_sigint    == 0){
+     g_signal_sigint    == 0 &&
+     ((crond->flags & CROND_FLAG_WARP) == 0 ||
+      crond->warp_now <= crond->warp_end)){
     should_exit = false;
   }
   else{
@@ -1137,10 +5974,545 @@ crond_should_exit(const struct crond *const crond){
   return should_exit;
 }
 
+/**
+ * Signals blocked by crond that get passed to the new program image
+ * in @ref crond_reexec.
+ */
+static const int
+g_crond_reexec_signals[] = {SIGCHLD, SIGHUP, SIGINT, SIGTERM, SIGUSR2};
+
+/**
+ * Set or clear the close-on-exec flag of a file descriptor.
+ *
+ * @param[in] fd      File descriptor, or -1 to do nothing.
+ * @param[in] cloexec Set to true to close the file descriptor on exec.
+ * @retval    0       Successfully set the flag.
+ * @retval    -1      Failed to set the flag.
+ */
+static int
+crond_fd_set_cloexec(const int fd,
+                     const bool cloexec){
+  int rc;
+
+  rc = 0;
+  if(fd >= 0 && fcntl(fd, F_SETFD, cloexec ? FD_CLOEXEC : 0) != 0){
+    rc = -1;
+  }
+  return rc;
+}
+
+/**
+ * Execute crond again to load a new program image without stopping.
+ *
+ * The new program image keeps the same process ID, so it inherits the
+ * lock file, the control socket, the trace file, and the job monitor
+ * processes, which it can still wait for. The rest of the state gets
+ * written to an unlinked temporary file passed through
+ * @ref CROND_REEXEC_ENV, see @ref crond_reexec_restore.
+ *
+ * The signals stay blocked across the exec, so they remain pending until
+ * the new program image sleeps. The open control socket connections get
+ * closed, the metrics start over, and the ephemeral jobs only survive if
+ * they got persisted with -p. crond keeps running if the exec fails.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_reexec(struct crond *const crond){
+  FILE *fp;
+  size_t i;
+  const struct crond_running *running;
+  const struct crond_job *job;
+  char fd_str[32];
+  int fd_state;
+
+  crond_verbose(crond, "re-executing: %s", crond->argv[0]);
+  while(crond->num_clients){
+    crond_control_client_close(crond, crond->num_clients - 1);
+  }
+  crond_reap_jobmon(crond);
+  if(crond->trace_buf){
+    crond_trace_flush(crond);
+  }
+  crond_state_write(crond);
+  fp = tmpfile();
+  if(fp == NULL){
+    crond_fprintf_stderr("failed to create re-exec state");
+  }
+  else{
+    fprintf(fp,
+            "lock %d\ncontrol %d\ntrace %d\nminute %ld\nserial %lu\n",
+            crond->fd_lock_file,
+            crond->fd_control,
+            crond->fd_trace,
+            (long)crond->last_minute,
+            crond->job_serial);
+    for(i = 0; i < sizeof(g_crond_reexec_signals) / sizeof(int); i++){
+      if(sigismember(&crond->sigmask_orig, g_crond_reexec_signals[i]) == 0){
+        fprintf(fp, "unblock %d\n", g_crond_reexec_signals[i]);
+      }
+    }
+    for(i = 0; i < crond->num_running; i++){
+      running = &crond->running_list[i];
+      job = NULL;
+      if(running->job_idx != SIZE_MAX){
+        job = &crond->job_list[running->job_idx];
+      }
+      if(job && job->at_time){
+        fprintf(fp,
+                "at %ld %ld %lu %ld\n",
+                (long)running->pid,
+                (long)job->at_time,
+                job->serial,
+                (long)running->start_sec);
+      }
+      else{
+        fprintf(fp,
+                "running %ld %08lx %ld %d %lu\n",
+                (long)running->pid,
+                running->hash,
+                (long)running->start_sec,
+                running->adopted ? 1 : 0,
+                running->proc_start);
+      }
+    }
+    fd_state = fileno(fp);
+    if(fflush(fp) != 0 ||
+       ferror(fp) ||
+       lseek(fd_state, 0, SEEK_SET) != 0 ||
+       crond_fd_set_cloexec(fd_state, false) != 0 ||
+       crond_fd_set_cloexec(crond->fd_lock_file, false) != 0 ||
+       crond_fd_set_cloexec(crond->fd_control, false) != 0 ||
+       crond_fd_set_cloexec(crond->fd_trace, false) != 0){
+      crond_fprintf_stderr("failed to write re-exec state");
+    }
+    else{
+      sprintf(fd_str, "%d", fd_state);
+      if(setenv(CROND_REEXEC_ENV, fd_str, 1) == 0){
+        execvp(crond->argv[0], crond->argv);
+        unsetenv(CROND_REEXEC_ENV);
+      }
+      crond_fprintf_stderr("failed to re-execute: %s", crond->argv[0]);
+    }
+    crond_fd_set_cloexec(crond->fd_lock_file, true);
+    crond_fd_set_cloexec(crond->fd_control, true);
+    crond_fd_set_cloexec(crond->fd_trace, true);
+    fclose(fp);
+  }
+}
+
+/**
+ * Restore the state passed by the previous program image in
+ * @ref crond_reexec.
+ *
+ * This does nothing unless @ref CROND_REEXEC_ENV has been set. The running
+ * at jobs get loaded back into @ref crond::job_list so that
+ * @ref crond_at_load does not queue them again. The other running jobs get
+ * attached once the crontab has been loaded, see
+ * @ref crond_running_attach.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_reexec_restore(struct crond *const crond){
+  const char *env;
+  char *ep;
+  long fd_state;
+  FILE *fp;
+  char *line;
+  size_t len;
+  long num;
+  long pid;
+  unsigned long hash;
+  long start_sec;
+  unsigned long proc_start;
+  int adopted;
+  int signum;
+  struct crond_at entry;
+  size_t job_idx;
+
+  env = getenv(CROND_REEXEC_ENV);
+  if(env && crond->status_code == 0){
+    fp = NULL;
+    errno = 0;
+    fd_state = strtol(env, &ep, 10);
+    if(errno == 0 && *ep == '\0' && ep != env &&
+       fd_state >= 0 && fd_state <= INT_MAX){
+      fp = fdopen((int)fd_state, "r");
+    }
+    if(fp == NULL){
+      crond_errx_noexit(crond, "invalid re-exec state: %s", env);
+    }
+    else{
+      crond->flags |= CROND_FLAG_REEXEC;
+      crond->fd_lock_file = -1;
+      crond->fd_control = -1;
+      crond->fd_trace = -1;
+      if(crond->path_at == NULL){
+        crond->path_at = crond_get_path_suffix(crond->path_crontab,
+                                               CROND_AT_SUFFIX);
+      }
+      line = NULL;
+      len = 0;
+      while(getline(&line, &len, fp) != -1){
+        proc_start = 0;
+        if(sscanf(line, "lock %d", &crond->fd_lock_file) == 1 ||
+           sscanf(line, "control %d", &crond->fd_control) == 1 ||
+           sscanf(line, "trace %d", &crond->fd_trace) == 1 ||
+           sscanf(line, "serial %lu", &crond->job_serial) == 1){
+          /* Restored the value. */
+        }
+        else if(sscanf(line, "minute %ld", &num) == 1){
+          crond->last_minute = (time_t)num;
+        }
+        else if(sscanf(line, "unblock %d", &signum) == 1){
+          sigdelset(&crond->sigmask_orig, signum);
+        }
+        else if(sscanf(line,
+                       "running %ld %lx %ld %d %lu",
+                       &pid,
+                       &hash,
+                       &start_sec,
+                       &adopted,
+                       &proc_start) >= 4){
+          crond_running_insert(crond,
+                               (pid_t)pid,
+                               SIZE_MAX,
+                               hash,
+                               (time_t)start_sec,
+                               proc_start,
+                               adopted != 0);
+        }
+        else if(sscanf(line,
+                       "at %ld %ld %lu %ld",
+                       &pid,
+                       &num,
+                       &entry.serial,
+                       &start_sec) == 4){
+          entry.when = (time_t)num;
+          if(crond->path_at &&
+             crond_at_job_load(crond, &entry, &job_idx) == 0){
+            crond_running_insert(crond,
+                                 (pid_t)pid,
+                                 job_idx,
+                                 0,
+                                 (time_t)start_sec,
+                                 0,
+                                 false);
+          }
+        }
+      }
+      free(line);
+      fclose(fp);
+      unsetenv(CROND_REEXEC_ENV);
+      if(crond_fd_set_cloexec(crond->fd_lock_file, true) != 0 ||
+         crond_fd_set_cloexec(crond->fd_control, true) != 0 ||
+         crond_fd_set_cloexec(crond->fd_trace, true) != 0 ||
+         crond->fd_lock_file < 0){
+        crond_errx_noexit(crond, "failed to restore re-exec state");
+      }
+      crond_verbose(crond,
+                    "restored %lu running jobs",
+                    (unsigned long)crond->num_running);
+    }
+  }
+}
+
+/**
+ * Sleep until the start of the next minute.
+ *
+ * The sleep gets interrupted to reap job monitor processes, reload the
+ * crontab after a SIGHUP or a change in the drop-in directory, execute
+ * crond again after a SIGUSR2, update the metrics file, and serve the
+ * control socket.
+ *
+ * @param[in,out] crond See @ref crond.
+ */
+static void
+crond_sleep(struct crond *const crond){
+  unsigned int sleep_sec;
+  time_t deadline;
+  struct timespec now;
+  struct timespec timeout;
+  sigset_t sigmask_wait;
+  fd_set readfds;
+  fd_set writefds;
+  int nfds;
+  int nready;
+
+  /* tm_sec = [0,60] */
+  sleep_sec = 60 - (unsigned int)crond->tm->tm_sec;
+  if(sleep_sec == 0){
+    sleep_sec += 1;
+  }
+  crond_verbose(crond, "sleeping for %u seconds", sleep_sec);
+  crond_record_flush(crond, false);
+  deadline = crond->ts_now.tv_sec + (time_t)sleep_sec;
+  memcpy(&sigmask_wait, &crond->sigmask_orig, sizeof(sigmask_wait));
+  sigdelset(&sigmask_wait, SIGCHLD);
+  sigdelset(&sigmask_wait, SIGHUP);
+  sigdelset(&sigmask_wait, SIGINT);
+  sigdelset(&sigmask_wait, SIGTERM);
+  sigdelset(&sigmask_wait, SIGUSR2);
+  while(crond_should_exit(crond) == false &&
+        crond_clock(crond, CLOCK_REALTIME, &now) == 0){
+    if(g_signal_sigchld){
+      g_signal_sigchld = 0;
+      crond_reap_jobmon(crond);
+    }
+    if(g_signal_sighup){
+      g_signal_sighup = 0;
+      crond_crontab_reparse(crond, false);
+    }
+    if(g_signal_sigusr2){
+      g_signal_sigusr2 = 0;
+      if(crond->path_record == NULL){
+        /* A dry run has no lock file to hand over. */
+        crond_reexec(crond);
+      }
+    }
+    crond_metrics_update(crond, &now, false);
+    crond_trace_update(crond, &now, false);
+    crond_catchup_run(crond, now.tv_sec);
+    crond_state_write(crond);
+    crond_running_poll(crond);
+    if((crond->flags & CROND_FLAG_WARP) && crond->num_running == 0){
+      /* Skip the idle time once the jobs of this minute have exited. */
+      crond->warp_now = deadline;
+      crond->warp_minutes += 1;
+      break;
+    }
+    if(now.tv_sec >= deadline){
+      break;
+    }
+    timeout.tv_sec = deadline - now.tv_sec - 1;
+    timeout.tv_nsec = 1000000000L - now.tv_nsec;
+    if(timeout.tv_nsec >= 1000000000L){
+      /* pselect rejects a timespec with a full second of nanoseconds. */
+      timeout.tv_sec += 1;
+      timeout.tv_nsec = 0;
+    }
+    nfds = crond_control_fd_set(crond, &readfds, &writefds);
+    if(crond->fd_inotify >= 0){
+      FD_SET(crond->fd_inotify, &readfds);
+      if(crond->fd_inotify >= nfds){
+        nfds = crond->fd_inotify + 1;
+      }
+    }
+    if((crond->num_clients || crond->num_catchup || crond->num_adopted ||
+        (crond->flags & CROND_FLAG_WARP)) &&
+       timeout.tv_sec > 0){
+      /*
+       * Wake up to close connections that timed out, to start the next
+       * catch-up run, and to check if the adopted jobs exited. The virtual
+       * clock does not move while waiting for the jobs to exit.
+       */
+      timeout.tv_sec = 0;
+      timeout.tv_nsec = 999999999L;
+    }
+    nready = pselect(nfds, &readfds, &writefds, NULL, &timeout, &sigmask_wait);
+    if(nready < 0){
+      if(errno != EINTR){
+        crond_errx_noexit(crond, "pselect");
+      }
+    }
+    else if(nready > 0 || crond->num_clients){
+      if(nready > 0 &&
+         crond->fd_inotify >= 0 &&
+         FD_ISSET(crond->fd_inotify, &readfds)){
+        crond_dropin_read(crond);
+        crond_crontab_reparse(crond, false);
+      }
+      crond_control_serve(crond, &readfds, &writefds, &now);
+    }
+  }
+}
+
+/**
+ * Parse the -d option, which sets how the jobs scheduled around a daylight
+ * saving time change run.
+ *
+ * The option contains the policy for the wall times skipped when the
+ * clocks go forward, run or skip, and the policy for the wall times
+ * repeated when the clocks go back, once or twice, separated by a comma.
+ *
+ * @param[in,out] crond  See @ref crond.
+ * @param[in]     policy Option argument, like run,once.
+ * @retval        0      Set the policy in @ref crond::flags.
+ * @retval        -1     Invalid policy.
+ */
+static int
+crond_dst_policy_parse(struct crond *const crond,
+                       const char *const policy){
+  int rc;
+
+  rc = 0;
+  crond->flags &= ~(CROND_FLAG_DST_GAP_SKIP | CROND_FLAG_DST_OVERLAP_TWICE);
+  if(strncmp(policy, "skip,", strlen("skip,")) == 0){
+    crond->flags |= CROND_FLAG_DST_GAP_SKIP;
+  }
+  else if(strncmp(policy, "run,", strlen("run,")) != 0){
+    rc = -1;
+  }
+  if(rc == 0){
+    if(strcmp(strchr(policy, ',') + 1, "twice") == 0){
+      crond->flags |= CROND_FLAG_DST_OVERLAP_TWICE;
+    }
+    else if(strcmp(strchr(policy, ',') + 1, "once") != 0){
+      rc = -1;
+    }
+  }
+  return rc;
+}
+
+/**
+ * Parse a local wall time like 2024-01-31T23:59.
+ *
+ * @param[in]  str Start of the wall time.
+ * @param[out] len Number of characters in the wall time.
+ * @retval     >=0 Time.
+ * @retval     -1  Invalid wall time.
+ */
+static time_t
+crond_warp_time(const char *const str,
+                int *const len){
+  struct tm tm;
+  int mday;
+  int mon;
+  time_t t;
+
+  memset(&tm, 0, sizeof(tm));
+  *len = 0;
+  t = -1;
+  if(sscanf(str,
+            "%4d-%2d-%2dT%2d:%2d%n",
+            &tm.tm_year,
+            &tm.tm_mon,
+            &tm.tm_mday,
+            &tm.tm_hour,
+            &tm.tm_min,
+            len) == 5 &&
+     tm.tm_mon  >= 1 && tm.tm_mon  <= 12 &&
+     tm.tm_mday >= 1 && tm.tm_mday <= 31 &&
+     tm.tm_hour >= 0 && tm.tm_hour <= 23 &&
+     tm.tm_min  >= 0 && tm.tm_min  <= 59){
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    mday = tm.tm_mday;
+    mon = tm.tm_mon;
+    t = mktime(&tm);
+    if(tm.tm_mday != mday || tm.tm_mon != mon){
+      /* mktime moved a day like February 30 into the next month. */
+      t = -1;
+    }
+  }
+  return t;
+}
+
+/**
+ * Parse the -w option, which runs crond on a virtual clock.
+ *
+ * The option contains the first and last minute to run, as local wall
+ * times separated by a comma. The virtual clock starts at the first minute
+ * and moves to the next minute as soon as the jobs started in the current
+ * minute exit, without waiting for the real time to pass. crond exits after
+ * checking the jobs of the last minute.
+ *
+ * @param[in,out] crond See @ref crond.
+ * @param[in]     range Option argument, like 2024-01-01T00:00,2024-12-31T23:59.
+ * @retval        0     Set @ref crond::warp_now and @ref crond::warp_end.
+ * @retval        -1    Invalid time range.
+ */
+static int
+crond_warp_parse(struct crond *const crond,
+                 const char *const range){
+  int len;
+  int len_end;
+  int rc;
+
+  rc = -1;
+  crond->warp_now = crond_warp_time(range, &len);
+  if(crond->warp_now >= 0 && range[len] == ','){
+    crond->warp_end = crond_warp_time(&range[len + 1], &len_end);
+    if(crond->warp_end >= crond->warp_now && range[len + 1 + len_end] == '\0'){
+      crond->flags |= CROND_FLAG_WARP;
+      rc = 0;
+    }
+  }
+  return rc;
+}
+
+/**
+ * Print the resources used to run on the virtual clock.
+ *
+ * The CPU time and maximum resident set size only include the crond
+ * process, not the jobs it started.
+ *
+ * @param[in] crond See @ref crond.
+ */
+static void
+crond_warp_report(const struct crond *const crond){
+  struct rusage usage;
+
+  if((crond->flags & CROND_FLAG_WARP) && getrusage(RUSAGE_SELF, &usage) == 0){
+    crond_fprintf_stderr("warp: %lu minutes, %lu jobs, "
+                         "%ld.%06ld s user, %ld.%06ld s system, "
+                         "%ld KiB max RSS",
+                         crond->warp_minutes,
+                         crond->warp_jobs,
+                         (long)usage.ru_utime.tv_sec,
+                         (long)usage.ru_utime.tv_usec,
+                         (long)usage.ru_stime.tv_sec,
+                         (long)usage.ru_stime.tv_usec,
+                         usage.ru_maxrss);
+  }
+}
+
 /**
  * Main entry point for cron.
  *
- * Usage: crond [-v]
+ * Usage: crond [-sv] [-c lookback_hours] [-d dst_policy] [-g drain_sec]
+ *              [-m metrics_file] [-n dry_run_log] [-p ephemeral_dir]
+ *              [-t trace_file] [-u max_user_jobs] [-w start,end]
+ *
+ * crond listens on a control socket next to the crontab file, see
+ * @ref crond_control_request. At jobs queued through the control socket
+ * get stored in a spool directory next to the crontab file, see
+ * @ref crond_at_load. The files in a drop-in directory next to the crontab
+ * file get loaded in addition to the crontab, see @ref crond_dropin_scan.
+ * On SIGUSR2, crond executes itself again without stopping, see
+ * @ref crond_reexec.
+ *
+ *   - -v: Print verbose messages to STDERR.
+ *   - -c: Record the last successful run of each job in a state file next
+ *         to the crontab file. On startup, jobs that missed a scheduled run
+ *         within the last @p lookback_hours hours run once to catch up,
+ *         see @ref crond_catchup_run.
+ *   - -d: How the jobs scheduled around a daylight saving time change
+ *         run, see @ref crond_dst_policy_parse and @ref crond_job_due.
+ *         Defaults to run,once.
+ *   - -g: On SIGTERM or SIGINT, stop starting jobs and wait up to
+ *         @p drain_sec seconds for the running jobs. The jobs still running
+ *         get handed off to the next crond process started with -g, see
+ *         @ref crond_drain.
+ *   - -m: Periodically write job statistics to @p metrics_file using the
+ *         Prometheus text format.
+ *   - -n: Dry run. Write a line to @p dry_run_log, or stdout if it is -,
+ *         for each job instead of running it, see @ref crond_job_record.
+ *         crond does not take the lock file or open the control socket.
+ *   - -p: Persist the ephemeral jobs added through the control socket in
+ *         @p ephemeral_dir and load them again on startup.
+ *   - -s: System mode. crond must run as root and runs the crontab of every
+ *         user as that user, see @ref crond_user_list_load. The lock file,
+ *         control socket, and other files stay next to the crontab of
+ *         root.
+ *   - -t: Write a timeline of the job executions to @p trace_file using the
+ *         Chrome Trace Event Format.
+ *   - -u: Do not start a job while @p max_user_jobs jobs of the same user
+ *         are running. Without -s, this limits all jobs.
+ *   - -w: Replay the wall times from @p start to @p end on a virtual clock,
+ *         then exit, see @ref crond_warp_parse.
  *
  * @param[in]     argc         Number of arguments in @p argv.
  * @param[in,out] argv         Argument list.
@@ -1150,50 +6522,169 @@ crond_should_exit(const struct crond *const crond){
 CRON_LINKAGE int
 crond_main(const int argc,
            char *const argv[]){
-  unsigned int sleep_sec;
   struct crond crond;
   int c;
+  unsigned long lookback_hours;
+  unsigned long drain_sec;
+  unsigned long user_max_running;
+  char *ep;
 
   memset(&crond, 0, sizeof(crond));
-  while((c = getopt(argc, argv, "v")) != -1){
+  crond.argv = argv;
+  crond.fd_inotify = -1;
+  crond.wd_dropin = -1;
+  crond.metrics_dirty = true;
+  while((c = getopt(argc, argv, "vc:d:g:m:n:p:st:u:w:")) != -1){
     switch(c){
       case 'v':
         crond.flags |= CROND_FLAG_VERBOSE;
         break;
+      case 'c':
+        errno = 0;
+        lookback_hours = strtoul(optarg, &ep, 10);
+        if(errno || *ep || !isdigit((unsigned char)*optarg) ||
+           lookback_hours > LONG_MAX / 3600){
+          crond_errx_noexit(&crond, "invalid lookback: %s", optarg);
+        }
+        crond.catchup_lookback = (time_t)(lookback_hours * 3600);
+        crond.flags |= CROND_FLAG_CATCHUP;
+        break;
+      case 'd':
+        if(crond_dst_policy_parse(&crond, optarg) != 0){
+          crond_errx_noexit(&crond, "invalid DST policy: %s", optarg);
+        }
+        break;
+      case 'g':
+        errno = 0;
+        drain_sec = strtoul(optarg, &ep, 10);
+        if(errno || *ep || !isdigit((unsigned char)*optarg) ||
+           drain_sec > LONG_MAX / 2){
+          crond_errx_noexit(&crond, "invalid drain time: %s", optarg);
+        }
+        crond.drain_sec = (time_t)drain_sec;
+        crond.flags |= CROND_FLAG_DRAIN;
+        break;
+      case 'm':
+        crond.path_metrics = optarg;
+        break;
+      case 'n':
+        crond.path_record = optarg;
+        break;
+      case 'p':
+        crond.path_ephemeral = optarg;
+        break;
+      case 's':
+        crond.flags |= CROND_FLAG_SYSTEM;
+        break;
+      case 't':
+        crond.path_trace = optarg;
+        break;
+      case 'u':
+        errno = 0;
+        user_max_running = strtoul(optarg, &ep, 10);
+        if(errno || *ep || !isdigit((unsigned char)*optarg)){
+          crond_errx_noexit(&crond, "invalid user job limit: %s", optarg);
+        }
+        crond.user_max_running = (size_t)user_max_running;
+        break;
+      case 'w':
+        if(crond_warp_parse(&crond, optarg) != 0){
+          crond_errx_noexit(&crond, "invalid time range: %s", optarg);
+        }
+        break;
       default:
         crond_errx_noexit(&crond, "invalid argument: %s", optarg);
         break;
     }
   }
 
+  if((crond.flags & CROND_FLAG_SYSTEM) && geteuid() != 0){
+    crond_errx_noexit(&crond, "system mode requires root");
+  }
+
   crond.path_crontab = cron_get_path_crontab();
   if(crond.path_crontab == NULL){
     crond_errx_noexit(&crond, "failed to get crontab path");
   }
 
+  if(crond.path_metrics){
+    crond.path_metrics_tmp = crond_get_path_suffix(crond.path_metrics, ".tmp");
+    if(crond.path_metrics_tmp == NULL){
+      crond_errx_noexit(&crond, "failed to get metrics file path");
+    }
+  }
+
+  if(crond.flags & CROND_FLAG_CATCHUP){
+    crond.path_state = crond_get_path_suffix(crond.path_crontab,
+                                             CROND_STATE_SUFFIX);
+    crond.path_state_tmp = crond_get_path_suffix(crond.path_state, ".tmp");
+    if(crond.path_state_tmp == NULL){
+      crond_errx_noexit(&crond, "failed to get job state file path");
+    }
+  }
+
+  if((crond.flags & CROND_FLAG_DRAIN) && crond_readonly(&crond) == false){
+    crond.path_handoff = crond_get_path_suffix(crond.path_crontab,
+                                               CROND_HANDOFF_SUFFIX);
+    crond.path_handoff_tmp = crond_get_path_suffix(crond.path_handoff,
+                                                   ".tmp");
+    if(crond.path_handoff_tmp == NULL){
+      crond_errx_noexit(&crond, "failed to get handoff file path");
+    }
+  }
+
   crond_get_shell(&crond);
   crond_get_email_to(&crond);
   crond_signal_set(&crond);
+  crond_reexec_restore(&crond);
+  crond_record_open(&crond);
   crond_lock_file_create(&crond);
+  crond_trace_open(&crond);
+  crond_control_open(&crond);
+  crond_dropin_open(&crond);
+  crond_ephemeral_load(&crond);
+  crond_at_load(&crond);
+  crond_state_load(&crond);
+  crond_handoff_load(&crond);
   while(crond_should_exit(&crond) == false){
-    crond_crontab_reparse(&crond);
+    crond_crontab_reparse(&crond, false);
     crond_gettime(&crond);
-    crond_job_list_run(&crond);
-    crond_gettime(&crond);
-
+    if(crond_should_exit(&crond) == false &&
+       crond.ts_now.tv_sec - crond.tm->tm_sec != crond.last_minute){
+      /* Skip the minute already checked before crond_reexec. */
+      crond_job_list_run(&crond);
+      crond_gettime(&crond);
+    }
     if(crond_should_exit(&crond) == false){
-      /* tm_sec = [0,60] */
-      sleep_sec = 60 - (unsigned int)crond.tm->tm_sec;
-      if(sleep_sec == 0){
-        sleep_sec += 1;
-      }
-      crond_verbose(&crond, "sleeping for %u seconds", sleep_sec);
-      sleep(sleep_sec);
+      crond_sleep(&crond);
     }
-    crond_reap_jobmon();
   }
-  crond_job_list_free(&crond);
+  crond_drain(&crond);
+  crond_reap_jobmon(&crond);
+  crond_state_write(&crond);
+  crond_metrics_update(&crond, &crond.ts_now, true);
+  crond_trace_close(&crond);
+  crond_record_flush(&crond, true);
+  crond_warp_report(&crond);
+  crond_job_list_free(&crond, true, SIZE_MAX);
   crond_lock_file_delete(&crond);
+  crond_control_close(&crond);
+  crond_dropin_close(&crond);
+  sigprocmask(SIG_SETMASK, &crond.sigmask_orig, NULL);
+  cron_sigaction(SIGCHLD, &crond.sigact_sigchld_orig, NULL);
+  free(crond.running_list);
+  crond_user_list_free(crond.user_list, crond.num_users);
+  free(crond.at_queue);
+  free(crond.path_at);
+  free(crond.state_list);
+  free(crond.path_state);
+  free(crond.path_state_tmp);
+  free(crond.path_handoff);
+  free(crond.path_handoff_tmp);
+  free(crond.path_dropin);
+  free(crond.owner_list);
+  crond_zone_list_free(&crond);
+  free(crond.path_metrics_tmp);
   free(crond.path_lock_file);
   free(crond.path_crontab);
   return crond.status_code;
@@ -11,10 +11,14 @@
 #ifndef CROND_H
 #define CROND_H
 
+#include <signal.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <time.h>
 
+#include "cron.h"
+#include "cron_expr.h"
+
 /**
  * Maximum host name size allowed by cron.
  */
@@ -33,66 +37,723 @@
 #define CROND_MAX_SUBJECT_LEN  (80)
 
 /**
- * @defgroup crond_flag crond flags
+ * Number of bytes of job output read at a time by the job monitor.
+ *
+ * The job monitor passes each read on to mailx, so this also bounds the
+ * memory it uses for the output.
+ */
+#define CROND_OUTPUT_BUF_SZ (65536)
+
+/**
+ * Minimum number of seconds between updates to the metrics file.
+ *
+ * Job completions that happen within this interval get batched together
+ * into a single write.
+ */
+#define CROND_METRICS_INTERVAL_SEC (15)
+
+/**
+ * Number of finite buckets in a @ref crond_histogram.
+ */
+#define CROND_HISTOGRAM_NUM_BUCKETS (6)
+
+/**
+ * Number of bytes of trace events buffered by crond before writing them to
+ * the trace file.
+ */
+#define CROND_TRACE_BUF_SZ (16384)
+
+/**
+ * Minimum number of seconds between writes of buffered trace events.
+ */
+#define CROND_TRACE_FLUSH_SEC (5)
+
+/**
+ * Maximum number of control socket connections served at the same time.
+ *
+ * Additional connections wait in the listen backlog.
+ */
+#define CROND_CONTROL_MAX_CLIENTS (16)
+
+/**
+ * Close control socket connections that have not completed after this
+ * many seconds.
+ */
+#define CROND_CONTROL_TIMEOUT_SEC (5)
+
+/**
+ * Append this to the crontab path to get the at job spool directory.
+ */
+#define CROND_AT_SUFFIX ".at"
+
+/**
+ * Append this to the crontab path to get the job state file.
+ */
+#define CROND_STATE_SUFFIX ".state"
+
+/**
+ * Append this to the crontab path to get the file listing the job monitor
+ * processes handed off to the next crond process.
+ */
+#define CROND_HANDOFF_SUFFIX ".running"
+
+/**
+ * Append this to the crontab path to get the drop-in directory.
+ *
+ * Each file in the drop-in directory contains additional crontab lines,
+ * see @ref crond_dropin_scan.
+ */
+#define CROND_DROPIN_SUFFIX ".d"
+
+/**
+ * Number of seconds ahead that the UTC offset changes of each time zone
+ * get looked up, see @ref crond_zone.
+ */
+#define CROND_ZONE_SCAN_SEC (7L * 24 * 60 * 60)
+
+/**
+ * Directory containing the time zone files when TZDIR is not set.
+ */
+#define CROND_ZONE_DIR "/usr/share/zoneinfo"
+
+/**
+ * Minimum number of seconds between the start of each missed job during
+ * catch-up.
+ */
+#define CROND_CATCHUP_STAGGER_SEC (5)
+
+/**
+ * Environment variable containing the file descriptor of the state passed
+ * to the new crond program image on SIGUSR2, see @ref crond_reexec.
+ */
+#define CROND_REEXEC_ENV "CROND_REEXEC_FD"
+
+/**
+ * @defgroup crond_flag crond flags
+ *
+ * Option flags when running crond.
+ */
+
+/**
+ * Print verbose messages to STDERR.
+ *
+ * @ingroup crond_flag
+ */
+#define CROND_FLAG_VERBOSE (1 << 0)
+
+/**
+ * Run the jobs that missed a scheduled run while crond was not running.
+ *
+ * @ingroup crond_flag
+ */
+#define CROND_FLAG_CATCHUP (1 << 1)
+
+/**
+ * Wait for the running jobs before exiting and hand off the jobs still
+ * running to the next crond process.
+ *
+ * @ingroup crond_flag
+ */
+#define CROND_FLAG_DRAIN (1 << 2)
+
+/**
+ * The lock file, control socket, trace file, and running jobs got
+ * inherited from the crond process that re-executed itself.
+ *
+ * @ingroup crond_flag
+ */
+#define CROND_FLAG_REEXEC (1 << 3)
+
+/**
+ * Run the crontab of every user from a single crond process started as
+ * root, see @ref crond_user_list_load.
+ *
+ * @ingroup crond_flag
+ */
+#define CROND_FLAG_SYSTEM (1 << 4)
+
+/**
+ * Do not run the jobs scheduled in the wall times skipped when the clocks
+ * go forward, instead of running them once right after the change.
+ *
+ * @ingroup crond_flag
+ */
+#define CROND_FLAG_DST_GAP_SKIP (1 << 5)
+
+/**
+ * Run the jobs scheduled in the wall times repeated when the clocks go
+ * back each time those wall times occur, instead of only the first time.
+ *
+ * @ingroup crond_flag
+ */
+#define CROND_FLAG_DST_OVERLAP_TWICE (1 << 6)
+
+/**
+ * Read the current time from a virtual clock that skips ahead to the next
+ * minute as soon as the running jobs exit, see @ref crond::warp_now.
+ *
+ * @ingroup crond_flag
+ */
+#define CROND_FLAG_WARP (1 << 7)
+
+/**
+ * Cron daemon job.
+ */
+struct crond_job{
+  /**
+   * Shell command to execute.
+   */
+  char *command;
+
+  /**
+   * If set, pass this to the command through STDIN.
+   */
+  char *stdin_lines;
+
+  /**
+   * Number of bytes in @ref stdin_lines.
+   */
+  size_t stdin_lines_len;
+
+  /**
+   * Number of times this job has been started.
+   */
+  unsigned long num_runs;
+
+  /**
+   * Number of times this job exited with a non-zero status.
+   */
+  unsigned long num_failures;
+
+  /**
+   * Wall time in milliseconds taken by the last completed run, including
+   * the time spent delivering the output.
+   */
+  unsigned long last_duration_ms;
+
+  /**
+   * Exit status of the last completed run.
+   *
+   * Commands killed by a signal get reported as 128 plus the signal number.
+   */
+  int last_exit_code;
+
+  /**
+   * Number of job monitor processes currently running this job.
+   */
+  unsigned int num_running;
+
+  /**
+   * Serial number of an ephemeral job, unique within the crond process.
+   *
+   * Ephemeral jobs get referenced as INDEX.SERIAL so that
+   * a stale reference does not match a job that reused the same slot.
+   */
+  unsigned long serial;
+
+  /**
+   * FNV-1a hash of the crontab line, used to find the job in
+   * @ref crond::state_list, or 0 for at jobs.
+   */
+  unsigned long hash;
+
+  /**
+   * Remove the ephemeral job after this time, or 0 to keep it until it
+   * gets removed through the control socket.
+   */
+  time_t expire;
+
+  /**
+   * Index of the next unused slot in @ref crond::job_list.
+   *
+   * This only gets used while the slot is unused.
+   */
+  size_t next_free;
+
+  /**
+   * Time an at job got queued to run, or 0 for other jobs.
+   *
+   * At jobs run once and get removed from the job list and the spool
+   * directory after they complete.
+   */
+  time_t at_time;
+
+  /**
+   * File the job got loaded from.
+   *
+   * This is 0 for the crontab file, or the index in
+   * @ref crond::source_list plus one for a file in the drop-in directory.
+   */
+  size_t source;
+
+  /**
+   * Index of the next job of the same owner that is due in the current
+   * minute, see @ref crond_owner.
+   *
+   * This only gets used while dispatching the jobs of a minute.
+   */
+  size_t next_due;
+
+  /**
+   * Time zone used to match the schedule of this job.
+   *
+   * This is 0 for the local time zone, or the index in
+   * @ref crond::zone_list plus one for a zone set with CRON_TZ.
+   */
+  size_t zone;
+
+  /**
+   * User that owns the crontab of this job in system mode, see
+   * @ref crond_user.
+   *
+   * Jobs added through the control socket belong to the crond user.
+   */
+  uid_t uid;
+
+  /**
+   * Schedule of the job.
+   */
+  struct cron_expr expr;
+
+  /**
+   * Set to true to skip the scheduled runs of this job.
+   *
+   * This gets changed through the control socket.
+   */
+  bool paused;
+
+  /**
+   * Set to true if the job got added through the control socket instead
+   * of the crontab file.
+   *
+   * Ephemeral jobs stay loaded when the crontab gets reloaded.
+   */
+  bool ephemeral;
+
+  /**
+   * Padding for alignment.
+   */
+  char pad[2];
+};
+
+/**
+ * File in the crontab drop-in directory, see @ref crond::source_list.
+ */
+struct crond_source{
+  /**
+   * File name in the drop-in directory, or NULL if the slot is unused.
+   */
+  char *name;
+
+  /**
+   * Modification time of the file when it got loaded.
+   */
+  struct timespec mtime;
+
+  /**
+   * Set to true if the jobs of this file need to get reloaded.
+   */
+  bool dirty;
+
+  /**
+   * Set to true if the file got found by the last directory scan.
+   */
+  bool seen;
+
+  /**
+   * Padding for alignment.
+   */
+  char pad[6];
+};
+
+/**
+ * UTC offset of a time zone starting at a point in time, see
+ * @ref crond_zone::transition_list.
+ */
+struct crond_zone_transition{
+  /**
+   * Time the offset takes effect.
+   */
+  time_t at;
+
+  /**
+   * Number of seconds to add to UTC to get the wall time in the zone.
+   */
+  long offset;
+};
+
+/**
+ * State of a time zone around a UTC offset change, see
+ * @ref crond_zone::dst.
+ */
+enum crond_dst{
+  /**
+   * Each wall time occurs once.
+   */
+  CROND_DST_NONE,
+
+  /**
+   * The clocks went forward within the last minute, skipping the wall
+   * times from @ref crond_zone::gap_wall_start to
+   * @ref crond_zone::gap_wall_end.
+   */
+  CROND_DST_GAP,
+
+  /**
+   * The clocks went back, and the current wall time already occurred
+   * before the change.
+   */
+  CROND_DST_OVERLAP
+};
+
+/**
+ * Time zone set with a CRON_TZ line, see @ref crond::zone_list, or the
+ * local time zone, see @ref crond::zone_local.
+ *
+ * The UTC offsets of the zone get looked up once from the time zone
+ * database for the next @ref CROND_ZONE_SCAN_SEC seconds, so that matching
+ * a job in the zone does not require changing the TZ environment variable.
+ */
+struct crond_zone{
+  /**
+   * TZ environment variable of the zone, TZ=Area/City, or NULL for the
+   * local time zone.
+   *
+   * This also gets passed to the jobs in the zone.
+   */
+  char *env_tz;
+
+  /**
+   * UTC offsets of the zone, sorted by @ref crond_zone_transition::at.
+   *
+   * The first entry covers all times before the second entry.
+   */
+  struct crond_zone_transition *transition_list;
+
+  /**
+   * Number of entries in @ref transition_list.
+   */
+  size_t num_transitions;
+
+  /**
+   * Index of the entry in @ref transition_list in effect at
+   * @ref crond::ts_now.
+   */
+  size_t transition_idx;
+
+  /**
+   * The offsets in @ref transition_list need to get looked up again
+   * after this time.
+   */
+  time_t until;
+
+  /**
+   * First wall time skipped when the clocks went forward, as seconds
+   * since the epoch, if @ref dst is @ref CROND_DST_GAP.
+   */
+  time_t gap_wall_start;
+
+  /**
+   * First wall time after the skipped wall times, if @ref dst is
+   * @ref CROND_DST_GAP.
+   */
+  time_t gap_wall_end;
+
+  /**
+   * Wall time in the zone at @ref crond::ts_now.
+   */
+  struct tm tm;
+
+  /**
+   * State of the zone at @ref crond::ts_now.
+   */
+  enum crond_dst dst;
+
+  /**
+   * Padding for alignment.
+   */
+  char pad[4];
+};
+
+/**
+ * Queue of the jobs of one owner that are due in the current minute, see
+ * @ref crond::owner_list.
+ *
+ * In system mode the owner of a job is its user. Otherwise the owner is
+ * the file the job got loaded from, see @ref crond_job::source.
+ */
+struct crond_owner{
+  /**
+   * Index in @ref crond::job_list of the next job to start, or SIZE_MAX
+   * if no jobs are left.
+   */
+  size_t head;
+
+  /**
+   * Index in @ref crond::job_list of the last queued job.
+   */
+  size_t tail;
+
+  /**
+   * Index in @ref crond::owner_list of the next owner with queued jobs.
+   */
+  size_t next;
+};
+
+/**
+ * Persisted state of a job, see @ref crond::state_list.
+ */
+struct crond_state{
+  /**
+   * See @ref crond_job::hash.
+   */
+  unsigned long hash;
+
+  /**
+   * Start time of the last successful run, or the time crond first loaded
+   * the job if it has not completed successfully yet.
+   */
+  time_t last_run;
+
+  /**
+   * Set to true if the job missed a scheduled run while crond was not
+   * running and has not been caught up yet.
+   */
+  bool catchup;
+
+  /**
+   * Padding for alignment.
+   */
+  char pad[7];
+};
+
+/**
+ * Pending at job in @ref crond::at_queue.
+ *
+ * The spool file of the job gets named WHEN.SERIAL.
+ */
+struct crond_at{
+  /**
+   * Run the job at or after this time.
+   */
+  time_t when;
+
+  /**
+   * Serial number of the job, unique within the spool directory.
+   */
+  unsigned long serial;
+};
+
+/**
+ * Job monitor process that has not been reaped yet.
+ */
+struct crond_running{
+  /**
+   * Time when the job monitor process started.
+   */
+  struct timespec start;
+
+  /**
+   * Wall clock time when the job monitor process started.
+   */
+  time_t start_sec;
+
+  /**
+   * Index of the job in @ref crond::job_list.
+   *
+   * This gets set to SIZE_MAX if the job list got reloaded while the job
+   * was still running, until a job with the same @ref hash gets loaded.
+   */
+  size_t job_idx;
+
+  /**
+   * See @ref crond_job::hash.
+   */
+  unsigned long hash;
+
+  /**
+   * Start time of the job monitor process in clock ticks after boot, or 0
+   * if unknown.
+   *
+   * This tells an adopted job monitor apart from a later process that
+   * reused its process ID, see @ref crond_proc_running.
+   */
+  unsigned long proc_start;
+
+  /**
+   * Process ID of the job monitor.
+   */
+  pid_t pid;
+
+  /**
+   * See @ref crond_job::uid.
+   */
+  uid_t uid;
+
+  /**
+   * Set to true if the job monitor got handed off by a previous crond
+   * process.
+   *
+   * crond cannot wait for these processes, so it polls them until they
+   * exit. Their exit status does not get collected.
+   */
+  bool adopted;
+
+  /**
+   * Padding for alignment.
+   */
+  char pad[7];
+};
+
+/**
+ * User with a crontab file in system mode.
+ */
+struct crond_user{
+  /**
+   * User name.
+   */
+  char *name;
+
+  /**
+   * Home directory, used as the working directory of the jobs.
+   */
+  char *home;
+
+  /**
+   * Path to the crontab file of the user.
+   */
+  char *path_crontab;
+
+  /**
+   * Modification time of @ref path_crontab.
+   */
+  struct timespec mtime_crontab;
+
+  /**
+   * User ID that the jobs run as.
+   */
+  uid_t uid;
+
+  /**
+   * Primary group ID that the jobs run as.
+   */
+  gid_t gid;
+};
+
+/**
+ * Connection to the crond control socket.
  *
- * Option flags when running crond.
+ * Each connection sends one request line and receives the response before
+ * crond closes the connection.
  */
+struct crond_client{
+  /**
+   * Response to send, or NULL if the request has not been received yet.
+   */
+  char *out_buf;
+
+  /**
+   * Number of bytes in @ref out_buf.
+   */
+  size_t out_len;
+
+  /**
+   * Number of bytes in @ref out_buf already sent.
+   */
+  size_t out_off;
+
+  /**
+   * Number of bytes received in @ref in_buf.
+   */
+  size_t in_len;
+
+  /**
+   * Time when crond accepted the connection.
+   */
+  time_t accept_sec;
+
+  /**
+   * Connected socket.
+   */
+  int fd;
+
+  /**
+   * Request line received from the client.
+   */
+  char in_buf[CRON_CONTROL_REQUEST_SZ];
+
+  /**
+   * Padding for alignment.
+   */
+  char pad[4];
+};
 
 /**
- * Print verbose messages to STDERR.
+ * Cumulative histogram of durations measured in microseconds.
  *
- * @ingroup crond_flag
+ * The bucket boundaries are shared by all histograms and match the
+ * Prometheus histogram type.
  */
-#define CROND_FLAG_VERBOSE (1 << 0)
+struct crond_histogram{
+  /**
+   * Number of observations less than or equal to each bucket boundary.
+   */
+  unsigned long bucket[CROND_HISTOGRAM_NUM_BUCKETS];
 
-/**
- * Cron daemon job.
- */
-struct crond_job{
   /**
-   * Shell command to execute.
+   * Total number of observations.
    */
-  char *command;
+  unsigned long count;
 
   /**
-   * If set, pass this to the command through STDIN.
+   * Sum of all observations in microseconds.
    */
-  char *stdin_lines;
+  unsigned long sum_usec;
+};
 
+/**
+ * Bytes of memory used by the loaded jobs, see @ref crond_mem_count.
+ *
+ * The sizes count the bytes requested from the allocator, without its
+ * overhead.
+ */
+struct crond_mem{
   /**
-   * Number of bytes in @ref stdin_lines.
+   * Slots in @ref crond::job_list used by jobs, without their schedules.
    */
-  size_t stdin_lines_len;
+  size_t jobs;
 
   /**
-   * The minutes to run the job.
+   * Schedules of the jobs, see @ref crond_job::expr.
    */
-  bool minute[60];
+  size_t schedules;
 
   /**
-   * The hours to run the job.
+   * Shell commands of the jobs, see @ref crond_job::command.
    */
-  bool hour[24];
+  size_t commands;
 
   /**
-   * The days of the month to run the job.
+   * Lines passed to the jobs through STDIN, see
+   * @ref crond_job::stdin_lines.
    */
-  bool day[31];
+  size_t stdin_lines;
 
   /**
-   * The months of the year to run the job.
+   * Time zones set with CRON_TZ and their UTC offsets, see
+   * @ref crond::zone_list.
    */
-  bool month[12];
+  size_t environment;
 
   /**
-   * The days of the week to run the job.
+   * Lists used to look up jobs, their owners, users, files, and state.
    */
-  bool weekday[7];
+  size_t indexes;
 
   /**
-   * Padding for alignment.
+   * Unused slots in @ref crond::job_list.
    */
-  bool pad[2];
+  size_t unused;
 };
 
 /**
@@ -117,9 +778,9 @@ struct crond{
   int fd_lock_file;
 
   /**
-   * Padding for alignment.
+   * Listening control socket, or -1 if unavailable.
    */
-  char pad_1[4];
+  int fd_control;
 
   /**
    * Lock file path.
@@ -144,6 +805,234 @@ struct crond{
    */
   struct tm *tm;
 
+  /**
+   * Current time corresponding to @ref tm.
+   */
+  struct timespec ts_now;
+
+  /**
+   * Write Prometheus metrics to this file, or NULL if disabled.
+   */
+  const char *path_metrics;
+
+  /**
+   * Temporary file written before renaming to @ref path_metrics.
+   */
+  char *path_metrics_tmp;
+
+  /**
+   * Time of the last update to @ref path_metrics.
+   */
+  struct timespec ts_metrics;
+
+  /**
+   * Write Chrome Trace Event JSON to this file, or NULL if disabled.
+   */
+  const char *path_trace;
+
+  /**
+   * Trace events waiting to get written to @ref fd_trace.
+   *
+   * This stays NULL if tracing is disabled.
+   */
+  char *trace_buf;
+
+  /**
+   * Number of bytes used in @ref trace_buf.
+   */
+  size_t trace_buf_len;
+
+  /**
+   * Time of the last write to @ref fd_trace.
+   */
+  struct timespec ts_trace;
+
+  /**
+   * File descriptor of @ref path_trace opened in append mode.
+   */
+  int fd_trace;
+
+  /**
+   * Process ID of crond used to group all trace events.
+   */
+  pid_t pid_trace;
+
+  /**
+   * Dry run log, see @ref crond_job_record, or NULL to run the jobs.
+   */
+  const char *path_record;
+
+  /**
+   * Stream of @ref path_record, which is stdout if the path is -.
+   */
+  FILE *fp_record;
+
+  /**
+   * Open control socket connections.
+   *
+   * See @ref crond_client.
+   */
+  struct crond_client *client_list;
+
+  /**
+   * Number of entries in @ref client_list.
+   */
+  size_t num_clients;
+
+  /**
+   * Job monitor processes that have not been reaped yet.
+   *
+   * See @ref crond_running.
+   */
+  struct crond_running *running_list;
+
+  /**
+   * Number of entries in @ref running_list.
+   */
+  size_t num_running;
+
+  /**
+   * Number of entries in @ref running_list handed off by a previous crond
+   * process, see @ref crond_running::adopted.
+   */
+  size_t num_adopted;
+
+  /**
+   * Maximum number of seconds to wait for running jobs when exiting.
+   */
+  time_t drain_sec;
+
+  /**
+   * File listing the job monitor processes handed off to the next crond
+   * process, or NULL if draining is disabled.
+   */
+  char *path_handoff;
+
+  /**
+   * Temporary file written before renaming to @ref path_handoff.
+   */
+  char *path_handoff_tmp;
+
+  /**
+   * Argument list used to execute crond again on SIGUSR2.
+   */
+  char *const *argv;
+
+  /**
+   * Start of the last minute checked by @ref crond_job_list_run.
+   *
+   * This gets passed to the new crond program image on SIGUSR2 so that it
+   * does not run the jobs of the same minute again.
+   */
+  time_t last_minute;
+
+  /**
+   * Users with a crontab file in system mode.
+   */
+  struct crond_user *user_list;
+
+  /**
+   * Number of users in @ref user_list.
+   */
+  size_t num_users;
+
+  /**
+   * Maximum number of jobs that can run at once for each user, or 0 for
+   * no limit.
+   */
+  size_t user_max_running;
+
+  /**
+   * Crontab drop-in directory, see @ref CROND_DROPIN_SUFFIX.
+   */
+  char *path_dropin;
+
+  /**
+   * Files found in @ref path_dropin.
+   *
+   * Slots of removed files get reused, so the index of a file does not
+   * change while it exists.
+   */
+  struct crond_source *source_list;
+
+  /**
+   * Number of slots in @ref source_list.
+   */
+  size_t num_sources;
+
+  /**
+   * inotify instance watching @ref path_dropin, or -1 if not available.
+   */
+  int fd_inotify;
+
+  /**
+   * inotify watch descriptor of @ref path_dropin, or -1 if the directory
+   * is not being watched yet.
+   */
+  int wd_dropin;
+
+  /**
+   * Owners of the jobs due in the current minute.
+   *
+   * This gets reused for every minute and only grows.
+   */
+  struct crond_owner *owner_list;
+
+  /**
+   * Number of slots in @ref owner_list.
+   */
+  size_t owner_max;
+
+  /**
+   * Time zones set with CRON_TZ lines.
+   *
+   * Zones stay in the list until crond exits, so that the jobs can refer
+   * to them by index.
+   */
+  struct crond_zone *zone_list;
+
+  /**
+   * Number of zones in @ref zone_list.
+   */
+  size_t num_zones;
+
+  /**
+   * UTC offset changes of the local time zone, used to handle the jobs
+   * scheduled around a daylight saving time change.
+   */
+  struct crond_zone zone_local;
+
+  /**
+   * Zone of the jobs in the crontab lines being loaded, see
+   * @ref crond_job::zone, or SIZE_MAX to skip those jobs because of an
+   * invalid CRON_TZ line.
+   */
+  size_t zone_load;
+
+  /**
+   * Time between the start of the minute and the time each job started.
+   */
+  struct crond_histogram hist_lateness;
+
+  /**
+   * Time taken to reload the crontab file.
+   */
+  struct crond_histogram hist_reload;
+
+  /**
+   * Signal mask in effect before crond blocked the signals it handles.
+   *
+   * Child processes restore this mask before running a job.
+   */
+  sigset_t sigmask_orig;
+
+  /**
+   * SIGCHLD action in effect before crond installed its own handler.
+   *
+   * This gets restored when crond exits.
+   */
+  struct sigaction sigact_sigchld_orig;
+
   /**
    * Previous modification time of the crontab file.
    *
@@ -154,30 +1043,175 @@ struct crond{
   /**
    * List of jobs to execute.
    *
+   * Removing an ephemeral job leaves an unused slot with a NULL
+   * @ref crond_job::command, which gets reused by the next job added.
+   *
    * See @ref crond_job.
    */
   struct crond_job *job_list;
 
   /**
-   * Number of jobs in @ref job_list.
+   * Number of slots in @ref job_list, including unused slots.
    */
   size_t num_jobs;
 
+  /**
+   * Index of the first unused slot in @ref job_list.
+   *
+   * The unused slots form a list through @ref crond_job::next_free.
+   */
+  size_t job_free;
+
+  /**
+   * Number of unused slots in @ref job_list.
+   */
+  size_t num_job_free;
+
+  /**
+   * Serial number assigned to the next ephemeral job or at job.
+   */
+  unsigned long job_serial;
+
+  /**
+   * Pending at jobs ordered as a binary min-heap on
+   * @ref crond_at::when.
+   *
+   * See @ref crond_at.
+   */
+  struct crond_at *at_queue;
+
+  /**
+   * Number of pending at jobs in @ref at_queue.
+   */
+  size_t num_at;
+
+  /**
+   * Number of entries allocated in @ref at_queue.
+   */
+  size_t at_queue_sz;
+
+  /**
+   * Spool directory containing one file for each at job.
+   */
+  char *path_at;
+
+  /**
+   * Directory used to persist the ephemeral jobs, or NULL to only keep
+   * them in memory.
+   */
+  const char *path_ephemeral;
+
+  /**
+   * Job state file, or NULL if catch-up is disabled.
+   */
+  char *path_state;
+
+  /**
+   * Temporary file written before renaming to @ref path_state.
+   */
+  char *path_state_tmp;
+
+  /**
+   * State of each loaded job sorted by @ref crond_state::hash.
+   *
+   * See @ref crond_state.
+   */
+  struct crond_state *state_list;
+
+  /**
+   * Number of entries in @ref state_list.
+   */
+  size_t num_state;
+
+  /**
+   * Number of entries in @ref state_list waiting for catch-up.
+   */
+  size_t num_catchup;
+
+  /**
+   * Only catch up runs missed within this many seconds.
+   */
+  time_t catchup_lookback;
+
+  /**
+   * Do not start another catch-up run before this time.
+   */
+  time_t ts_catchup;
+
+  /**
+   * Current time of the virtual clock if @ref CROND_FLAG_WARP is set.
+   */
+  time_t warp_now;
+
+  /**
+   * Exit after the virtual clock passes this time.
+   */
+  time_t warp_end;
+
+  /**
+   * Number of minutes the virtual clock advanced.
+   */
+  unsigned long warp_minutes;
+
+  /**
+   * Number of jobs started while running on the virtual clock.
+   */
+  unsigned long warp_jobs;
+
+  /**
+   * Address of the control socket.
+   *
+   * See @ref cron_get_control_addr.
+   */
+  struct sockaddr_un addr_control;
+
   /**
    * Send email with job output to this address.
    */
   char email_to[CROND_MAX_HOST_NAME_SZ + CROND_MAX_USER_NAME + 1];
 
+  /**
+   * Set when job statistics changed since the last metrics update.
+   */
+  bool metrics_dirty;
+
+  /**
+   * Set when @ref state_list changed since the last write to
+   * @ref path_state.
+   */
+  bool state_dirty;
+
+  /**
+   * Set after loading @ref path_state until the jobs have been checked
+   * for missed runs.
+   */
+  bool state_loaded;
+
   /**
    * Padding for alignment.
    */
-  char pad_2[7];
+  char pad[6];
 };
 
 #ifdef CRON_TEST
 void
 crond_crontab_parse_line(struct crond *const crond,
-                         const char *line);
+                         const char *line,
+                         const uid_t uid,
+                         const size_t source);
+
+void
+crond_job_list_free(struct crond *const crond,
+                    const bool ephemeral,
+                    const size_t source);
+
+void
+crond_mem_count(const struct crond *const crond,
+                struct crond_mem *const mem);
+
+int
+crond_user_switch(struct crond *const crond,
+                  const uid_t uid);
 #endif /* CRON_TEST */
 
 #endif /* CROND_H */
@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @brief Static tracepoints in the cron daemon.
+ * @author James Humphrey (humphreyj@somnisoft.com)
+ *
+ * Define CRON_USDT when compiling crond to place USDT probes on the
+ * scheduler and job paths. This requires the sys/sdt.h header from
+ * SystemTap. The probes can then get traced with tools like bpftrace or
+ * SystemTap without a debug build, for example:
+ *
+ * @verbatim
+   bpftrace -e 'usdt:./crond:crond:job_spawn { printf("%d\n", arg0); }'
+ * @endverbatim
+ *
+ * Each probe has a semaphore that the tracer increments while it traces
+ * the probe. The probe arguments only get evaluated when the semaphore is
+ * set, so an untraced probe costs one load and branch. Tracers that do not
+ * set semaphores, like perf, do not see the probes fire.
+ *
+ * Without CRON_USDT, the probe macros expand to nothing and their
+ * arguments do not get evaluated.
+ *
+ * Probes and their arguments:
+ *   - reparse_start(ts)
+ *   - reparse_end(ts, num_jobs)
+ *   - tick_start(ts, num_jobs)
+ *   - tick_end(ts, num_started)
+ *   - job_spawn(job_idx, pid, ts)
+ *   - job_exec(job_idx, ts)
+ *   - job_output(job_idx, output_len, ts)
+ *   - job_mail(job_idx, output_len, ts)
+ *   - job_reap(job_idx, pid, exit_code, ts)
+ *
+ * The ts arguments contain the CLOCK_MONOTONIC time in nanoseconds. The
+ * job_idx arguments contain the index of the job in the job list, or -1
+ * if the job list got reloaded while the job was running.
+ *
+ * This software has been placed into the public domain using CC0.
+ */
+#ifndef CROND_PROBE_H
+#define CROND_PROBE_H
+
+#ifdef CRON_USDT
+# define _SDT_HAS_SEMAPHORES 1
+# include <sys/sdt.h>
+
+/**
+ * Define the semaphore of a probe, which the tracer sets while it traces
+ * the probe.
+ */
+# define CROND_PROBE_SEMAPHORE(name)                                \
+  __extension__ volatile unsigned short crond_##name##_semaphore    \
+  __attribute__((section(".probes"))) = 0
+
+/**
+ * Check if a tracer traces a probe.
+ */
+# define CROND_PROBE_ENABLED(name)                                  \
+  __builtin_expect(crond_##name##_semaphore != 0, 0)
+
+/**
+ * Probe with one argument.
+ */
+# define CROND_PROBE1(name, a1)                                     \
+  do{                                                               \
+    if(CROND_PROBE_ENABLED(name)){                                  \
+      DTRACE_PROBE1(crond, name, a1);                               \
+    }                                                               \
+  }while(0)
+
+/**
+ * Probe with two arguments.
+ */
+# define CROND_PROBE2(name, a1, a2)                                 \
+  do{                                                               \
+    if(CROND_PROBE_ENABLED(name)){                                  \
+      DTRACE_PROBE2(crond, name, a1, a2);                           \
+    }                                                               \
+  }while(0)
+
+/**
+ * Probe with three arguments.
+ */
+# define CROND_PROBE3(name, a1, a2, a3)                             \
+  do{                                                               \
+    if(CROND_PROBE_ENABLED(name)){                                  \
+      DTRACE_PROBE3(crond, name, a1, a2, a3);                       \
+    }                                                               \
+  }while(0)
+
+/**
+ * Probe with four arguments.
+ */
+# define CROND_PROBE4(name, a1, a2, a3, a4)                         \
+  do{                                                               \
+    if(CROND_PROBE_ENABLED(name)){                                  \
+      DTRACE_PROBE4(crond, name, a1, a2, a3, a4);                   \
+    }                                                               \
+  }while(0)
+#else /* !(CRON_USDT) */
+/**
+ * Probe with one argument.
+ */
+# define CROND_PROBE1(name, a1)
+/**
+ * Probe with two arguments.
+ */
+# define CROND_PROBE2(name, a1, a2)
+/**
+ * Probe with three arguments.
+ */
+# define CROND_PROBE3(name, a1, a2, a3)
+/**
+ * Probe with four arguments.
+ */
+# define CROND_PROBE4(name, a1, a2, a3, a4)
+#endif /* CRON_USDT */
+
+#endif /* CROND_PROBE_H */
+
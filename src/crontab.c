@@ -10,7 +10,30 @@
  * This software has been placed into the public domain using CC0.
  */
 
+#include <ctype.h>
+
 #include "cron.h"
+#include "cron_expr.h"
+
+/**
+ * Maximum number of days in the time range of @ref crontab_simulate.
+ */
+#define CRONTAB_SIMULATE_MAX_DAYS (10 * 366)
+
+/**
+ * Number of busiest minutes printed by @ref crontab_simulate.
+ */
+#define CRONTAB_SIMULATE_PEAKS 10
+
+/**
+ * Number of minutes in a day of @ref crontab_simulate.
+ */
+#define CRONTAB_SIMULATE_DAY_MINUTES (24L * 60L)
+
+/**
+ * Maximum number of run times printed for each job by @ref crontab_next.
+ */
+#define CRONTAB_NEXT_MAX 10000
 
 /**
  * @defgroup crontab_flag Crontab flags
@@ -39,6 +62,47 @@
  */
 #define CRONTAB_OPTION_REMOVE (1 << 2)
 
+/**
+ * Send a command to the running crond (@ref crontab_control).
+ *
+ * @ingroup crontab_flag
+ */
+#define CRONTAB_OPTION_CONTROL (1 << 3)
+
+/**
+ * Simulate the schedule of a crontab (@ref crontab_simulate).
+ *
+ * @ingroup crontab_flag
+ */
+#define CRONTAB_OPTION_SIMULATE (1 << 4)
+
+/**
+ * Print the next run times of each job (@ref crontab_next).
+ *
+ * @ingroup crontab_flag
+ */
+#define CRONTAB_OPTION_NEXT (1 << 5)
+
+/**
+ * Job loaded by @ref crontab_simulate.
+ */
+struct crontab_job{
+  /**
+   * Schedule of the job.
+   */
+  struct cron_expr expr;
+
+  /**
+   * Crontab line of the job.
+   */
+  char *line;
+
+  /**
+   * Number of times the job runs in the simulated time range.
+   */
+  unsigned long count;
+};
+
 /**
  * Crontab context.
  */
@@ -53,6 +117,22 @@ struct crontab{
    */
   char *path_crontab_tmp;
 
+  /**
+   * Command sent to crond with the -c option.
+   */
+  const char *control_cmd;
+
+  /**
+   * Time range used with the -s option, in the form
+   * YYYY-MM-DDTHH:MM,YYYY-MM-DDTHH:MM.
+   */
+  const char *simulate_range;
+
+  /**
+   * Number of run times printed for each job with the -n option.
+   */
+  unsigned long next_count;
+
   /**
    * Program exit status set to one of the following values.
    *   - EXIT_SUCCESS
@@ -377,6 +457,847 @@ crontab_remove(struct crontab *const crontab){
   }
 }
 
+/**
+ * Send a command to the control socket of the running crond and print the
+ * response to STDOUT.
+ *
+ * crond responds to failed commands with a line starting with "error:".
+ *
+ * @param[in,out] crontab See @ref crontab.
+ */
+static void
+crontab_control(struct crontab *const crontab){
+  struct sockaddr_un addr;
+  int fd;
+  char buf[CRON_READ_BUFFER_SZ];
+  char request[CRON_CONTROL_REQUEST_SZ];
+  size_t request_len;
+  ssize_t bytes_read;
+  bool first_read;
+
+  request_len = strlen(crontab->control_cmd);
+  if(request_len + 1 >= sizeof(request) ||
+     strchr(crontab->control_cmd, '\n')){
+    crontab_errx_noexit(crontab, "Invalid command: %s", crontab->control_cmd);
+  }
+  else if(cron_get_control_addr(crontab->path_crontab, &addr) != 0){
+    crontab_errx_noexit(crontab, "Control socket path too long");
+  }
+  else{
+    stpcpy(stpcpy(request, crontab->control_cmd), "\n");
+    request_len += 1;
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0){
+      crontab_errx_noexit(crontab, "socket");
+    }
+    else{
+      if(connect(fd, (const struct sockaddr *)&addr, sizeof(addr)) != 0){
+        crontab_errx_noexit(crontab, "crond not running: %s", addr.sun_path);
+      }
+      else if(write(fd, request, request_len) != (ssize_t)request_len){
+        crontab_errx_noexit(crontab, "write: %s", addr.sun_path);
+      }
+      else{
+        first_read = true;
+        do{
+          bytes_read = read(fd, buf, sizeof(buf));
+          if(bytes_read < 0){
+            if(errno != EINTR){
+              crontab_errx_noexit(crontab, "read: %s", addr.sun_path);
+              break;
+            }
+          }
+          else if(bytes_read > 0){
+            if(first_read &&
+               bytes_read >= 6 &&
+               strncmp(buf, "error:", 6) == 0){
+              crontab->status_code = EXIT_FAILURE;
+            }
+            first_read = false;
+            fwrite(buf, 1, (size_t)bytes_read, stdout);
+          }
+        } while(bytes_read);
+      }
+      close(fd);
+    }
+  }
+}
+
+/**
+ * Reallocate memory with an unsigned wrap check.
+ *
+ * @param[in,out] ptr   Existing allocated memory, or NULL when allocating
+ *                      a new buffer.
+ * @param[in]     nmemb Number of elements to allocate.
+ * @param[in]     size  Size of each element in @p nmemb.
+ * @retval        void* Pointer to a reallocated buffer containing
+ *                      @p nmemb * @p size bytes.
+ * @retval        NULL  Failed to reallocate memory.
+ */
+static void *
+crontab_reallocarray(void *const ptr,
+                     const size_t nmemb,
+                     const size_t size){
+  void *alloc;
+  size_t size_mul;
+
+  if(si_mul_size_t(nmemb, size, &size_mul)){
+    alloc = NULL;
+  }
+  else{
+    alloc = realloc(ptr, size_mul);
+  }
+  return alloc;
+}
+
+/**
+ * Parse a wall time in the form YYYY-MM-DDTHH:MM.
+ *
+ * The simulation counts wall time minutes, so the time does not get
+ * converted from the local time zone.
+ *
+ * @param[in]  str    Wall time to parse.
+ * @param[out] minute Number of minutes from 1970-01-01T00:00 to @p str.
+ * @param[out] len    Number of characters parsed.
+ * @retval     0      Parsed the wall time.
+ * @retval     -1     Invalid wall time.
+ */
+static int
+crontab_simulate_time(const char *const str,
+                      long *const minute,
+                      size_t *const len){
+  struct tm tm;
+  int n;
+  int mday;
+  int mon;
+  time_t t;
+  int rc;
+
+  memset(&tm, 0, sizeof(tm));
+  n = 0;
+  rc = -1;
+  if(sscanf(str,
+            "%4d-%2d-%2dT%2d:%2d%n",
+            &tm.tm_year,
+            &tm.tm_mon,
+            &tm.tm_mday,
+            &tm.tm_hour,
+            &tm.tm_min,
+            &n) == 5 &&
+     tm.tm_mon  >= 1 && tm.tm_mon  <= 12 &&
+     tm.tm_mday >= 1 && tm.tm_mday <= 31 &&
+     tm.tm_hour >= 0 && tm.tm_hour <= 23 &&
+     tm.tm_min  >= 0 && tm.tm_min  <= 59){
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    mday = tm.tm_mday;
+    mon = tm.tm_mon;
+    t = timegm(&tm);
+    if(t != -1 && tm.tm_mday == mday && tm.tm_mon == mon){
+      /* timegm moves a day like April 31 into the next month. */
+      *minute = (long)(t / 60);
+      *len = (size_t)n;
+      rc = 0;
+    }
+  }
+  return rc;
+}
+
+/**
+ * Convert a wall time minute to a tm structure.
+ *
+ * @param[in]  minute See @ref crontab_simulate_time.
+ * @param[out] tm     Wall time.
+ */
+static void
+crontab_simulate_tm(const long minute,
+                    struct tm *const tm){
+  time_t t;
+
+  t = (time_t)minute * 60;
+  gmtime_r(&t, tm);
+}
+
+/**
+ * Load the jobs of a crontab file for @ref crontab_simulate.
+ *
+ * Lines get parsed with @ref cron_expr_compile like crond does. Blank
+ * lines and comments get ignored, and other lines that do not contain a
+ * job get counted in @p num_skipped.
+ *
+ * @param[in,out] crontab     See @ref crontab.
+ * @param[in]     fp          Crontab file.
+ * @param[out]    job_list    Loaded jobs, which the caller must free
+ *                            along with each @ref crontab_job::line.
+ * @param[out]    num_jobs    Number of jobs in @p job_list.
+ * @param[out]    num_skipped Number of lines skipped.
+ */
+static void
+crontab_simulate_load(struct crontab *const crontab,
+                      FILE *const fp,
+                      struct crontab_job **const job_list,
+                      size_t *const num_jobs,
+                      size_t *const num_skipped){
+  char *line;
+  size_t len;
+  ssize_t read_len;
+  size_t i;
+  size_t expr_len;
+  size_t max_jobs;
+  struct crontab_job *new_job_list;
+  struct crontab_job *job;
+
+  line = NULL;
+  len = 0;
+  max_jobs = 0;
+  while(crontab->status_code == 0 &&
+        (read_len = getline(&line, &len, fp)) != -1){
+    if(read_len && line[read_len - 1] == '\n'){
+      line[read_len - 1] = '\0';
+    }
+    i = strspn(line, " \t");
+    if(line[i] == '\0' || line[i] == '#'){
+      continue;
+    }
+    if(*num_jobs == max_jobs){
+      max_jobs = max_jobs ? max_jobs * 2 : 64;
+      new_job_list = crontab_reallocarray(*job_list,
+                                          max_jobs,
+                                          sizeof(**job_list));
+      if(new_job_list == NULL){
+        crontab_errx_noexit(crontab,
+                            "realloc: %lu jobs",
+                            (unsigned long)max_jobs);
+        break;
+      }
+      *job_list = new_job_list;
+    }
+    job = &(*job_list)[*num_jobs];
+    if(cron_expr_compile(&job->expr, &line[i], &expr_len) != 0 ||
+       line[i + expr_len] == '\0' ||
+       isblank(line[i + expr_len - 1]) == 0){
+      *num_skipped += 1;
+    }
+    else{
+      job->line = strdup(&line[i]);
+      job->count = 0;
+      if(job->line == NULL){
+        crontab_errx_noexit(crontab, "strdup");
+      }
+      else{
+        *num_jobs += 1;
+      }
+    }
+  }
+  free(line);
+  if(ferror(fp)){
+    crontab_errx_noexit(crontab, "ferror");
+  }
+}
+
+/**
+ * Order jobs by the days their schedule matches, then by their whole
+ * schedule, used by qsort.
+ *
+ * Schedules that match the same days end up next to each other so that
+ * @ref crontab_simulate can add their runs one day at a time, and
+ * identical schedules end up next to each other so that they get
+ * simulated once.
+ *
+ * @param[in] a Pointer to a @ref crontab_job pointer.
+ * @param[in] b Pointer to a @ref crontab_job pointer.
+ * @return      Result of memcmp on the schedules.
+ */
+static int
+crontab_simulate_compare(const void *const a,
+                         const void *const b){
+  const struct crontab_job *const *job_a;
+  const struct crontab_job *const *job_b;
+  int cmp;
+
+  job_a = a;
+  job_b = b;
+  cmp = memcmp((*job_a)->expr.day,
+               (*job_b)->expr.day,
+               sizeof((*job_a)->expr.day));
+  if(cmp == 0){
+    cmp = memcmp((*job_a)->expr.month,
+                 (*job_b)->expr.month,
+                 sizeof((*job_a)->expr.month));
+  }
+  if(cmp == 0){
+    cmp = memcmp((*job_a)->expr.weekday,
+                 (*job_b)->expr.weekday,
+                 sizeof((*job_a)->expr.weekday));
+  }
+  if(cmp == 0){
+    cmp = memcmp(&(*job_a)->expr, &(*job_b)->expr, sizeof((*job_a)->expr));
+  }
+  return cmp;
+}
+
+/**
+ * Check if two schedules match the same days.
+ *
+ * @param[in] a First schedule.
+ * @param[in] b Second schedule.
+ * @retval    true  The day, month, and weekday fields are equal.
+ * @retval    false The schedules match different days.
+ */
+static bool
+crontab_simulate_same_days(const struct cron_expr *const a,
+                           const struct cron_expr *const b){
+  return memcmp(a->day, b->day, sizeof(a->day)) == 0 &&
+         memcmp(a->month, b->month, sizeof(a->month)) == 0 &&
+         memcmp(a->weekday, b->weekday, sizeof(a->weekday)) == 0;
+}
+
+/**
+ * Find the days of the time range that a schedule matches.
+ *
+ * Only the day, month, and weekday fields of @p expr get checked.
+ *
+ * @param[in]  expr     Schedule to check.
+ * @param[in]  start    First minute of the range, see
+ *                      @ref crontab_simulate_time.
+ * @param[in]  end      Minute after the range.
+ * @param[out] day_list First minute of each matching day, which needs
+ *                      room for every day of the range.
+ * @return              Number of days in @p day_list.
+ */
+static size_t
+crontab_simulate_days(const struct cron_expr *const expr,
+                      const long start,
+                      const long end,
+                      long *const day_list){
+  struct cron_expr days;
+  struct tm tm;
+  long day;
+  size_t num_days;
+
+  days = *expr;
+  memset(days.minute, 0xff, sizeof(days.minute));
+  memset(days.hour, 0xff, sizeof(days.hour));
+  num_days = 0;
+  day = start - ((start % CRONTAB_SIMULATE_DAY_MINUTES) +
+                 CRONTAB_SIMULATE_DAY_MINUTES) % CRONTAB_SIMULATE_DAY_MINUTES;
+  for(; day < end; day += CRONTAB_SIMULATE_DAY_MINUTES){
+    crontab_simulate_tm(day, &tm);
+    if(cron_expr_match(&days, &tm)){
+      day_list[num_days] = day;
+      num_days += 1;
+    }
+  }
+  return num_days;
+}
+
+/**
+ * Get the minutes of a day in the time range.
+ *
+ * The first and last day of the range can be partial days.
+ *
+ * @param[in]  day   First minute of the day.
+ * @param[in]  start First minute of the range.
+ * @param[in]  end   Minute after the range.
+ * @param[out] lo    First minute of the day in the range.
+ * @param[out] hi    Minute of the day after the range.
+ */
+static void
+crontab_simulate_clip(const long day,
+                      const long start,
+                      const long end,
+                      long *const lo,
+                      long *const hi){
+  *lo = start > day ? start - day : 0;
+  *hi = end < day + CRONTAB_SIMULATE_DAY_MINUTES ?
+        end - day : CRONTAB_SIMULATE_DAY_MINUTES;
+}
+
+/**
+ * Add one schedule to the runs per minute of the day of its day group.
+ *
+ * Only the minute and hour fields of @p expr get checked, since all
+ * schedules in the group match the days in @p day_list.
+ *
+ * @param[in]     expr     Schedule to simulate.
+ * @param[in]     start    First minute of the range, see
+ *                         @ref crontab_simulate_time.
+ * @param[in]     end      Minute after the range.
+ * @param[in]     day_list Days matched by @p expr, see
+ *                         @ref crontab_simulate_days.
+ * @param[in]     num_days Number of days in @p day_list.
+ * @param[in]     weight   Number of jobs with this schedule.
+ * @param[in,out] profile  Number of jobs started in each minute of a
+ *                         matching day, with
+ *                         @ref CRONTAB_SIMULATE_DAY_MINUTES entries.
+ * @param[out]    prefix   Scratch space with
+ *                         @ref CRONTAB_SIMULATE_DAY_MINUTES + 1 entries.
+ * @return                 Number of times the schedule runs.
+ */
+static unsigned long
+crontab_simulate_schedule(const struct cron_expr *const expr,
+                          const long start,
+                          const long end,
+                          const long *const day_list,
+                          const size_t num_days,
+                          const unsigned long weight,
+                          unsigned long *const profile,
+                          unsigned long *const prefix){
+  struct cron_expr times;
+  struct tm tm;
+  long minute;
+  long lo;
+  long hi;
+  size_t i;
+  unsigned long count;
+
+  times = *expr;
+  memset(times.day, 0xff, sizeof(times.day));
+  memset(times.month, 0xff, sizeof(times.month));
+  memset(times.weekday, 0xff, sizeof(times.weekday));
+  memset(&tm, 0, sizeof(tm));
+  tm.tm_mday = 1;
+  prefix[0] = 0;
+  for(minute = 0; minute < CRONTAB_SIMULATE_DAY_MINUTES; minute++){
+    tm.tm_hour = (int)(minute / 60);
+    tm.tm_min = (int)(minute % 60);
+    prefix[minute + 1] = prefix[minute];
+    if(cron_expr_match(&times, &tm)){
+      profile[minute] += weight;
+      prefix[minute + 1] += 1;
+    }
+  }
+  count = 0;
+  for(i = 0; i < num_days; i++){
+    crontab_simulate_clip(day_list[i], start, end, &lo, &hi);
+    count += prefix[hi] - prefix[lo];
+  }
+  return count;
+}
+
+/**
+ * Add the runs per minute of the day of a day group to every matching day.
+ *
+ * @param[in]     start       First minute of the range, see
+ *                            @ref crontab_simulate_time.
+ * @param[in]     end         Minute after the range.
+ * @param[in]     day_list    Days matched by the group.
+ * @param[in]     num_days    Number of days in @p day_list.
+ * @param[in]     profile     See @ref crontab_simulate_schedule.
+ * @param[in,out] minute_list Number of jobs started in each minute of
+ *                            the range.
+ */
+static void
+crontab_simulate_add(const long start,
+                     const long end,
+                     const long *const day_list,
+                     const size_t num_days,
+                     const unsigned long *const profile,
+                     unsigned long *const minute_list){
+  size_t i;
+  long minute;
+  long lo;
+  long hi;
+
+  for(i = 0; i < num_days; i++){
+    crontab_simulate_clip(day_list[i], start, end, &lo, &hi);
+    for(minute = lo; minute < hi; minute++){
+      minute_list[day_list[i] - start + minute] += profile[minute];
+    }
+  }
+}
+
+/**
+ * Print the results of @ref crontab_simulate.
+ *
+ * @param[in,out] crontab     See @ref crontab.
+ * @param[in]     start       First minute of the range.
+ * @param[in]     num_minutes Number of minutes in the range.
+ * @param[in]     minute_list Number of jobs started in each minute.
+ * @param[in]     job_list    Simulated jobs.
+ * @param[in]     num_jobs    Number of jobs in @p job_list.
+ * @param[in]     num_skipped Number of lines skipped while loading.
+ */
+static void
+crontab_simulate_print(struct crontab *const crontab,
+                       const long start,
+                       const long num_minutes,
+                       const unsigned long *const minute_list,
+                       const struct crontab_job *const job_list,
+                       const size_t num_jobs,
+                       const size_t num_skipped){
+  unsigned long *hist;
+  unsigned long max;
+  unsigned long total;
+  long peak_list[CRONTAB_SIMULATE_PEAKS];
+  size_t num_peaks;
+  size_t i;
+  long minute;
+  struct tm tm;
+  char when[sizeof("YYYY-MM-DDTHH:MM")];
+
+  max = 0;
+  total = 0;
+  num_peaks = 0;
+  for(minute = 0; minute < num_minutes; minute++){
+    total += minute_list[minute];
+    if(minute_list[minute] > max){
+      max = minute_list[minute];
+    }
+    if(minute_list[minute] &&
+       (num_peaks < CRONTAB_SIMULATE_PEAKS ||
+        minute_list[minute] > minute_list[peak_list[num_peaks - 1]])){
+      if(num_peaks < CRONTAB_SIMULATE_PEAKS){
+        num_peaks += 1;
+      }
+      for(i = num_peaks - 1;
+          i > 0 && minute_list[minute] > minute_list[peak_list[i - 1]];
+          i--){
+        peak_list[i] = peak_list[i - 1];
+      }
+      peak_list[i] = minute;
+    }
+  }
+  hist = crontab_reallocarray(NULL, (size_t)max + 1, sizeof(*hist));
+  if(hist == NULL){
+    crontab_errx_noexit(crontab, "realloc: %lu", max + 1);
+  }
+  else{
+    memset(hist, 0, ((size_t)max + 1) * sizeof(*hist));
+    for(minute = 0; minute < num_minutes; minute++){
+      hist[minute_list[minute]] += 1;
+    }
+    printf("minutes %ld\n", num_minutes);
+    printf("jobs %lu\n", (unsigned long)num_jobs);
+    printf("skipped %lu\n", (unsigned long)num_skipped);
+    printf("runs %lu\n", total);
+    for(i = 0; i <= max; i++){
+      if(hist[i]){
+        printf("concurrency %lu %lu\n", (unsigned long)i, hist[i]);
+      }
+    }
+    for(i = 0; i < num_peaks; i++){
+      crontab_simulate_tm(start + peak_list[i], &tm);
+      strftime(when, sizeof(when), "%Y-%m-%dT%H:%M", &tm);
+      printf("peak %s %lu\n", when, minute_list[peak_list[i]]);
+    }
+    for(i = 0; i < num_jobs; i++){
+      printf("job %lu %s\n", job_list[i].count, job_list[i].line);
+    }
+    free(hist);
+  }
+}
+
+/**
+ * Print how often the jobs of a crontab run in a time range.
+ *
+ * The jobs get loaded with the crond parser and counted over the wall
+ * time minutes in the range given with the -s option. Each distinct
+ * schedule gets checked once against the minutes of a day, and the runs
+ * of all schedules that match the same days get added to each of those
+ * days together, so the time does not grow with the number of runs. The
+ * start of the range is inclusive and the end is exclusive. The output
+ * contains these lines:
+ *
+ *   - minutes N: Number of minutes in the range.
+ *   - jobs N: Number of jobs loaded.
+ *   - skipped N: Number of lines that do not contain a valid job.
+ *   - runs N: Total number of job runs.
+ *   - concurrency C N: Number of minutes that start C jobs.
+ *   - peak YYYY-MM-DDTHH:MM C: One of the busiest minutes, busiest first.
+ *   - job N LINE: Number of runs of each job, in crontab order.
+ *
+ * CRON_TZ lines get skipped, so all jobs run in the same wall time, and
+ * each wall time minute gets counted once across daylight saving time
+ * changes.
+ *
+ * @param[in,out] crontab See @ref crontab.
+ * @param[in]     path    Crontab file to simulate.
+ */
+static void
+crontab_simulate(struct crontab *const crontab,
+                 const char *const path){
+  long start;
+  long end;
+  size_t len;
+  size_t len_end;
+  FILE *fp;
+  struct crontab_job *job_list;
+  struct crontab_job **order;
+  unsigned long *minute_list;
+  unsigned long *profile;
+  unsigned long *prefix;
+  long *day_list;
+  size_t num_jobs;
+  size_t num_skipped;
+  size_t num_days;
+  size_t i;
+  size_t j;
+  size_t k;
+  unsigned long count;
+
+  job_list = NULL;
+  order = NULL;
+  minute_list = NULL;
+  profile = NULL;
+  prefix = NULL;
+  day_list = NULL;
+  num_jobs = 0;
+  num_skipped = 0;
+  if(crontab_simulate_time(crontab->simulate_range, &start, &len) != 0 ||
+     crontab->simulate_range[len] != ',' ||
+     crontab_simulate_time(&crontab->simulate_range[len + 1],
+                           &end,
+                           &len_end) != 0 ||
+     crontab->simulate_range[len + 1 + len_end] != '\0' ||
+     end <= start ||
+     end - start > CRONTAB_SIMULATE_MAX_DAYS * 24L * 60L){
+    crontab_errx_noexit(crontab,
+                        "Invalid time range: %s",
+                        crontab->simulate_range);
+  }
+  else if((fp = fopen(path, "r")) == NULL){
+    crontab_errx_noexit(crontab, "fopen: %s", path);
+  }
+  else{
+    crontab_simulate_load(crontab, fp, &job_list, &num_jobs, &num_skipped);
+    fclose(fp);
+    if(crontab->status_code == 0){
+      order = crontab_reallocarray(NULL, num_jobs + 1, sizeof(*order));
+      minute_list = crontab_reallocarray(NULL,
+                                         (size_t)(end - start),
+                                         sizeof(*minute_list));
+      profile = crontab_reallocarray(NULL,
+                                     CRONTAB_SIMULATE_DAY_MINUTES,
+                                     sizeof(*profile));
+      prefix = crontab_reallocarray(NULL,
+                                    CRONTAB_SIMULATE_DAY_MINUTES + 1,
+                                    sizeof(*prefix));
+      day_list = crontab_reallocarray(NULL,
+                                      (size_t)((end - start) /
+                                               CRONTAB_SIMULATE_DAY_MINUTES +
+                                               2),
+                                      sizeof(*day_list));
+      if(order == NULL || minute_list == NULL || profile == NULL ||
+         prefix == NULL || day_list == NULL){
+        crontab_errx_noexit(crontab, "realloc: %ld minutes", end - start);
+      }
+      else{
+        memset(minute_list, 0, (size_t)(end - start) * sizeof(*minute_list));
+        for(i = 0; i < num_jobs; i++){
+          order[i] = &job_list[i];
+        }
+        qsort(order, num_jobs, sizeof(*order), crontab_simulate_compare);
+        for(k = 0; k < num_jobs; k = i){
+          num_days = crontab_simulate_days(&order[k]->expr,
+                                           start,
+                                           end,
+                                           day_list);
+          memset(profile,
+                 0,
+                 CRONTAB_SIMULATE_DAY_MINUTES * sizeof(*profile));
+          for(i = k;
+              i < num_jobs && crontab_simulate_same_days(&order[k]->expr,
+                                                         &order[i]->expr);
+              i = j){
+            for(j = i + 1;
+                j < num_jobs && crontab_simulate_compare(&order[i],
+                                                         &order[j]) == 0;
+                j++){
+            }
+            count = crontab_simulate_schedule(&order[i]->expr,
+                                              start,
+                                              end,
+                                              day_list,
+                                              num_days,
+                                              (unsigned long)(j - i),
+                                              profile,
+                                              prefix);
+            for(; i < j; i++){
+              order[i]->count = count;
+            }
+          }
+          crontab_simulate_add(start,
+                               end,
+                               day_list,
+                               num_days,
+                               profile,
+                               minute_list);
+        }
+        crontab_simulate_print(crontab,
+                               start,
+                               end - start,
+                               minute_list,
+                               job_list,
+                               num_jobs,
+                               num_skipped);
+      }
+    }
+  }
+  for(i = 0; i < num_jobs; i++){
+    free(job_list[i].line);
+  }
+  free(job_list);
+  free(order);
+  free(minute_list);
+  free(profile);
+  free(prefix);
+  free(day_list);
+}
+
+/**
+ * Set the time zone used by localtime() and mktime().
+ *
+ * @param[in] tz Value of the TZ environment variable, or NULL to remove it.
+ */
+static void
+crontab_set_tz(const char *const tz){
+  if(tz){
+    setenv("TZ", tz, 1);
+  }
+  else{
+    unsetenv("TZ");
+  }
+  tzset();
+}
+
+/**
+ * Print the next run times of one job.
+ *
+ * Each run time gets printed on its own line in local time and in UTC, or
+ * "never" if the schedule does not match within @ref CRON_EXPR_MAX_DAYS
+ * days.
+ *
+ * @param[in] crontab See @ref crontab.
+ * @param[in] expr    Schedule of the job.
+ * @param[in] now     Current local time.
+ */
+static void
+crontab_next_job(const struct crontab *const crontab,
+                 const struct cron_expr *const expr,
+                 const struct tm *const now){
+  struct tm wall;
+  struct tm next;
+  struct tm tm;
+  time_t t;
+  unsigned long i;
+  long offset;
+  char local[sizeof("YYYY-MM-DDTHH:MM")];
+  char utc[sizeof("YYYY-MM-DDTHH:MMZ")];
+
+  wall = *now;
+  for(i = 0; i < crontab->next_count; i++){
+    if(cron_expr_next(expr, &wall, &next) != 0){
+      puts("never");
+      break;
+    }
+    wall = next;
+    tm = next;
+    t = mktime(&tm);
+    if(t == -1 || localtime_r(&t, &tm) == NULL){
+      puts("never");
+      break;
+    }
+    offset = tm.tm_gmtoff;
+    strftime(local, sizeof(local), "%Y-%m-%dT%H:%M", &tm);
+    gmtime_r(&t, &tm);
+    strftime(utc, sizeof(utc), "%Y-%m-%dT%H:%MZ", &tm);
+    printf("%s%c%02ld%02ld %s\n",
+           local,
+           offset < 0 ? '-' : '+',
+           labs(offset) / 3600,
+           labs(offset) / 60 % 60,
+           utc);
+  }
+}
+
+/**
+ * Print the next run times of each job in a crontab.
+ *
+ * Each job line gets printed followed by its next run times, see
+ * @ref crontab_next_job. Lines that do not contain a valid job get
+ * reported as errors, so this can check crontab files before they get
+ * installed. CRON_TZ lines change the time zone of the following jobs like
+ * they do in crond.
+ *
+ * @param[in,out] crontab See @ref crontab.
+ * @param[in]     path    Crontab file, or "-" to read STDIN.
+ */
+static void
+crontab_next(struct crontab *const crontab,
+             const char *const path){
+  FILE *fp;
+  char *line;
+  size_t len;
+  ssize_t read_len;
+  size_t i;
+  size_t expr_len;
+  unsigned long line_num;
+  struct cron_expr expr;
+  const char *env_tz;
+  char *tz_orig;
+  time_t now;
+  struct tm *tm;
+
+  fp = NULL;
+  tz_orig = NULL;
+  env_tz = getenv("TZ");
+  if(env_tz && (tz_orig = strdup(env_tz)) == NULL){
+    crontab_errx_noexit(crontab, "strdup");
+  }
+  else if(strcmp(path, "-") == 0){
+    fp = stdin;
+  }
+  else if((fp = fopen(path, "r")) == NULL){
+    crontab_errx_noexit(crontab, "fopen: %s", path);
+  }
+  if(crontab->status_code == 0){
+    line = NULL;
+    len = 0;
+    line_num = 0;
+    now = time(NULL);
+    while((read_len = getline(&line, &len, fp)) != -1){
+      line_num += 1;
+      if(read_len && line[read_len - 1] == '\n'){
+        line[read_len - 1] = '\0';
+      }
+      i = strspn(line, " \t");
+      if(line[i] == '\0' || line[i] == '#'){
+        /* Blank line or comment. */
+      }
+      else if(strncmp(&line[i], "CRON_TZ=", strlen("CRON_TZ=")) == 0){
+        i += strlen("CRON_TZ=");
+        i += strspn(&line[i], " \t");
+        line[i + strcspn(&line[i], " \t")] = '\0';
+        crontab_set_tz(line[i] ? &line[i] : tz_orig);
+      }
+      else if(cron_expr_compile(&expr, &line[i], &expr_len) != 0 ||
+              line[i + expr_len] == '\0' ||
+              isblank(line[i + expr_len - 1]) == 0){
+        crontab_errx_noexit(crontab, "invalid job on line %lu: %s",
+                            line_num, line);
+      }
+      else if((tm = localtime(&now)) == NULL){
+        crontab_errx_noexit(crontab, "localtime");
+        break;
+      }
+      else{
+        printf("%s\n", &line[i]);
+        crontab_next_job(crontab, &expr, tm);
+      }
+    }
+    free(line);
+    if(ferror(fp)){
+      crontab_errx_noexit(crontab, "ferror: %s", path);
+    }
+    if(fp != stdin){
+      fclose(fp);
+    }
+    crontab_set_tz(tz_orig);
+  }
+  free(tz_orig);
+}
+
 /**
  * Set the crontab file to the contents of a file pointer.
  *
@@ -416,6 +1337,21 @@ crontab_file_set(struct crontab *const crontab,
  *
  * Usage: crontab [-e|-l|-r]
  *
+ * Usage: crontab -c command
+ *
+ * Usage: crontab -s YYYY-MM-DDTHH:MM,YYYY-MM-DDTHH:MM [file]
+ *
+ * Usage: crontab -n count [file|-]
+ *
+ * The -c option sends a command to the running crond. See
+ * @ref crontab_control.
+ *
+ * The -s option prints how often the jobs in the crontab, or in @p file,
+ * run in a time range. See @ref crontab_simulate.
+ *
+ * The -n option prints the next @p count run times of each job in the
+ * crontab, in @p file, or in STDIN. See @ref crontab_next.
+ *
  * @param[in]     argc         Number of arguments in @p argv.
  * @param[in,out] argv         Argument list.
  * @retval        EXIT_SUCCESS Successful.
@@ -427,19 +1363,36 @@ crontab_main(int argc,
   struct crontab crontab;
   int c;
   FILE *fp_in;
+  char *endptr;
 
   memset(&crontab, 0, sizeof(crontab));
-  while((c = getopt(argc, argv, "elr")) != -1){
+  while((c = getopt(argc, argv, "c:eln:rs:")) != -1){
     switch(c){
+      case 'c':
+        crontab.flags |= CRONTAB_OPTION_CONTROL;
+        crontab.control_cmd = optarg;
+        break;
       case 'e':
         crontab.flags |= CRONTAB_OPTION_EDIT;
         break;
       case 'l':
         crontab.flags |= CRONTAB_OPTION_LIST;
         break;
+      case 'n':
+        crontab.flags |= CRONTAB_OPTION_NEXT;
+        crontab.next_count = strtoul(optarg, &endptr, 10);
+        if(*optarg < '0' || *optarg > '9' || *endptr != '\0' ||
+           crontab.next_count < 1 || crontab.next_count > CRONTAB_NEXT_MAX){
+          crontab_errx_noexit(&crontab, "Invalid count: %s", optarg);
+        }
+        break;
       case 'r':
         crontab.flags |= CRONTAB_OPTION_REMOVE;
         break;
+      case 's':
+        crontab.flags |= CRONTAB_OPTION_SIMULATE;
+        crontab.simulate_range = optarg;
+        break;
       default:
         crontab_errx_noexit(&crontab, "Invalid option: %s", optarg);
         break;
@@ -459,6 +1412,15 @@ crontab_main(int argc,
     else if(crontab.flags == CRONTAB_OPTION_REMOVE){
       crontab_remove(&crontab);
     }
+    else if(crontab.flags == CRONTAB_OPTION_CONTROL){
+      crontab_control(&crontab);
+    }
+    else if(crontab.flags == CRONTAB_OPTION_SIMULATE && argc <= 1){
+      crontab_simulate(&crontab, argc ? argv[0] : crontab.path_crontab);
+    }
+    else if(crontab.flags == CRONTAB_OPTION_NEXT && argc <= 1){
+      crontab_next(&crontab, argc ? argv[0] : crontab.path_crontab);
+    }
     else if(crontab.flags == 0){
       if(argc == 0){
         crontab_file_set(&crontab, stdin);
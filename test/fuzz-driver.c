@@ -43,7 +43,7 @@ main(void){
     assert(ferror(fp) == 0);
   }
   buf[buflen] = '\0';
-  crond_crontab_parse_line(&crond, buf);
+  crond_crontab_parse_line(&crond, buf, 0, 0);
   free(buf);
 
   return 0;
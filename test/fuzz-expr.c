@@ -0,0 +1,63 @@
+/**
+ * @file
+ * @brief Fuzz testing for the cron expression library.
+ * @author James Humphrey (humphreyj@somnisoft.com)
+ *
+ * This software has been placed into the public domain using CC0.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/cron_expr.h"
+
+/**
+ * Fuzz test the cron expression compiler and search functions.
+ *
+ * Usage: fuzz-expr
+ *
+ * @retval 0 All tests passed.
+ */
+int
+main(void){
+  struct cron_expr expr;
+  struct tm from;
+  struct tm tm;
+  FILE *fp;
+  char *buf;
+  size_t bufsz;
+  size_t buflen;
+  size_t bytes_read;
+  size_t len;
+
+  fp = stdin;
+  buf = NULL;
+  bufsz = 0;
+  buflen = 0;
+  while(!feof(fp)){
+    bufsz += 1000;
+    buf = realloc(buf, bufsz);
+    assert(buf);
+    bytes_read = fread(&buf[buflen], 1, bufsz - buflen, fp);
+    buflen += bytes_read;
+    assert(ferror(fp) == 0);
+  }
+  buf[buflen] = '\0';
+  if(cron_expr_compile(&expr, buf, &len) == 0){
+    assert(len <= buflen);
+    memset(&from, 0, sizeof(from));
+    from.tm_mday = 1;
+    from.tm_year = 124;
+    if(cron_expr_next(&expr, &from, &tm) == 0){
+      assert(cron_expr_match(&expr, &tm));
+    }
+    if(cron_expr_prev(&expr, &from, &tm) == 0){
+      assert(cron_expr_match(&expr, &tm));
+    }
+  }
+  free(buf);
+
+  return 0;
+}
@@ -55,6 +55,18 @@ bool g_test_seam_err_in_fork_mailx = false;
  */
 int g_test_seam_err_ctr_clock_gettime = -1;
 
+/**
+ * Add this number of seconds to the CLOCK_REALTIME time returned by
+ * @ref test_seam_clock_gettime.
+ */
+time_t g_test_seam_clock_realtime_offset = 0;
+
+/**
+ * Drop the nanoseconds from the CLOCK_REALTIME time returned by
+ * @ref test_seam_clock_gettime.
+ */
+bool g_test_seam_clock_realtime_whole_sec = false;
+
 /**
  * Error counter for @ref test_seam_close.
  */
@@ -255,7 +267,7 @@ test_seam_force_errno(const int errno_alternative){
 }
 
 /**
- * Control when clock_gettime() fails.
+ * Control when clock_gettime() fails or shift the CLOCK_REALTIME time.
  *
  * @param[in]  clock_id Clock type.
  * @param[out] res      Store the time here.
@@ -273,6 +285,12 @@ test_seam_clock_gettime(clockid_t clock_id,
   }
   else{
     rc = clock_gettime(clock_id, res);
+    if(rc == 0 && clock_id == CLOCK_REALTIME){
+      res->tv_sec += g_test_seam_clock_realtime_offset;
+      if(g_test_seam_clock_realtime_whole_sec){
+        res->tv_nsec = 0;
+      }
+    }
   }
   return rc;
 }
@@ -336,6 +354,7 @@ test_seam_execle(const char *path,
   va_list ap;
   char **argv;
   char **envp;
+  char *const *envp_arg;
   char *s;
   size_t argv_len;
   size_t envp_len;
@@ -367,19 +386,14 @@ test_seam_execle(const char *path,
       }
       argv_len += 1;
     }
+    envp_arg = va_arg(ap, char *const *);
     envp_len = 0;
-    while(1){
-      s = va_arg(ap, char *);
-      if(s){
-        envp[envp_len] = strdup(s);
-        assert(envp[envp_len]);
-      }
-      else{
-        envp[envp_len] = NULL;
-        break;
-      }
+    while(envp_arg && envp_arg[envp_len]){
+      envp[envp_len] = strdup(envp_arg[envp_len]);
+      assert(envp[envp_len]);
       envp_len += 1;
     }
+    envp[envp_len] = NULL;
     va_end(ap);
     rc = execvpe(path, argv, envp);
     free(argv);
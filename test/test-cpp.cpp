@@ -0,0 +1,238 @@
+/**
+ * @file
+ * @brief Test the C++ interface to the cron expression library.
+ * @author James Humphrey (humphreyj@somnisoft.com)
+ *
+ * The same crontab lines get compiled by @ref cron::expr::parse and by
+ * @ref cron_expr_compile, which crond_crontab_parse_line() uses, and both
+ * must produce identical schedules.
+ *
+ * This software has been placed into the public domain using CC0.
+ */
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../src/cron.hpp"
+
+using namespace cron::literals;
+using namespace std::chrono;
+
+/**
+ * Times used to compare the search functions, 2024-02-28T23:59:30Z,
+ * 1999-12-31T23:59:00Z, and 2023-03-26T01:30:00Z.
+ */
+static constexpr sys_seconds
+g_search_from[] = {
+  sys_seconds{seconds{1709164770}},
+  sys_seconds{seconds{946684740}},
+  sys_seconds{seconds{1679794200}}
+};
+
+static_assert("* * * * *"_cron.match(sys_seconds{seconds{0}}));
+static_assert("@daily"_cron == "0 0 * * *"_cron);
+static_assert("@yearly"_cron == "0 0 1 1 *"_cron);
+static_assert(!cron::expr::parse("60 * * * *"));
+static_assert(!cron::expr::parse("* * * * * touch"));
+static_assert(cron::expr::parse("5-1,30 0 * * *") ==
+              cron::expr::parse("1-5,30 0 * * *"));
+static_assert(cron::expr::parse("0 12 29 2 *\t")->next(g_search_from[0]) ==
+              sys_days{2024y / February / 29} + 12h);
+static_assert(!cron::expr::parse("0 0 30 2 *")->next(g_search_from[0]));
+
+#ifdef TEST_CPP_INVALID
+/**
+ * Invalid literal, which must fail to compile.
+ */
+static constexpr cron::expr g_invalid = "60 * * * *"_cron;
+#endif /* TEST_CPP_INVALID */
+
+/**
+ * Convert a time to a UTC wall time for the C library.
+ *
+ * @param[in] t Time.
+ * @return      Wall time.
+ */
+static std::tm
+test_cpp_tm(const sys_seconds t){
+  const std::time_t tt = t.time_since_epoch().count();
+  std::tm tm;
+
+  assert(gmtime_r(&tt, &tm));
+  return tm;
+}
+
+/**
+ * Convert a UTC wall time from the C library to a time.
+ *
+ * @param[in] tm Wall time.
+ * @return       Time.
+ */
+static sys_seconds
+test_cpp_time(std::tm tm){
+  return sys_seconds{seconds{timegm(&tm)}};
+}
+
+/**
+ * Compare the C++ and C results for one crontab line.
+ *
+ * @param[in] line Crontab line.
+ */
+static void
+test_cpp_line(const std::string &line){
+  struct cron_expr c_expr;
+  std::size_t c_len;
+  const bool c_valid = cron_expr_compile(&c_expr, line.c_str(), &c_len) == 0;
+  const std::optional<cron::expr> e =
+    c_valid ? cron::expr::parse(line.substr(0, c_len)) : std::nullopt;
+  std::tm tm;
+  std::tm tm_c;
+
+  if(!c_valid){
+    assert(!cron::expr::parse(line));
+    return;
+  }
+  assert(e);
+  assert(std::memcmp(&e->c_expr(), &c_expr, sizeof(c_expr)) == 0);
+  for(const sys_seconds from : g_search_from){
+    tm = test_cpp_tm(from);
+    const std::optional<sys_seconds> next = e->next(from);
+    assert(next.has_value() == (cron_expr_next(&c_expr, &tm, &tm_c) == 0));
+    assert(!next || *next == test_cpp_time(tm_c));
+    const std::optional<sys_seconds> prev = e->prev(from);
+    assert(prev.has_value() == (cron_expr_prev(&c_expr, &tm, &tm_c) == 0));
+    assert(!prev || *prev == test_cpp_time(tm_c));
+    assert(!next || e->match(*next));
+  }
+}
+
+/**
+ * Test the occurrences range.
+ */
+static void
+test_cpp_occurrences(){
+  constexpr cron::expr e = "0 0 29 2 *"_cron;
+  std::vector<sys_seconds> list;
+
+  for(const sys_seconds t : e.after(g_search_from[1])){
+    list.push_back(t);
+    if(list.size() == 3){
+      break;
+    }
+  }
+  assert(list.size() == 3);
+  assert(list[0] == sys_days{2000y / February / 29});
+  assert(list[1] == sys_days{2004y / February / 29});
+  assert(list[2] == sys_days{2008y / February / 29});
+  assert(("0 0 31 2 *"_cron).after(g_search_from[1]).begin() ==
+         std::default_sentinel);
+}
+
+/**
+ * Time how long a function takes to run over a list of items.
+ *
+ * @param[in] name Name printed with the result.
+ * @param[in] list Items to pass to @p fn.
+ * @param[in] fn   Function to call for each item.
+ */
+template<typename T, typename F>
+static void
+test_cpp_bench(const char *const name,
+               const std::vector<T> &list,
+               F fn){
+  constexpr int ROUNDS = 10000;
+  const steady_clock::time_point start = steady_clock::now();
+
+  for(int round = 0; round < ROUNDS; round++){
+    for(const T &item : list){
+      fn(item);
+    }
+  }
+  const nanoseconds elapsed = steady_clock::now() - start;
+  assert(std::printf("%-12s %8.1f ns/op\n",
+                     name,
+                     static_cast<double>(elapsed.count()) /
+                     static_cast<double>(ROUNDS * list.size())) > 0);
+}
+
+/**
+ * Compare compiling and searching crontab lines with the C and C++ code.
+ *
+ * @param[in] lines Crontab lines.
+ */
+static void
+test_cpp_bench_all(const std::vector<std::string> &lines){
+  std::vector<struct cron_expr> c_list;
+  std::vector<cron::expr> cpp_list;
+  struct cron_expr c_expr;
+  std::size_t len;
+  volatile std::size_t sink = 0;
+
+  for(const std::string &line : lines){
+    if(cron_expr_compile(&c_expr, line.c_str(), &len) == 0){
+      c_list.push_back(c_expr);
+      cpp_list.push_back(*cron::expr::parse(line.substr(0, len)));
+    }
+  }
+  test_cpp_bench("c compile", lines, [&](const std::string &line){
+    sink = sink + (cron_expr_compile(&c_expr, line.c_str(), nullptr) == 0);
+  });
+  test_cpp_bench("c++ compile", lines, [&](const std::string &line){
+    sink = sink + cron::detail::compile(c_expr, line, len);
+  });
+  test_cpp_bench("c next", c_list, [&](const struct cron_expr &e){
+    std::tm tm = test_cpp_tm(g_search_from[0]);
+    std::tm next;
+    sink = sink + (cron_expr_next(&e, &tm, &next) == 0);
+  });
+  test_cpp_bench("c++ next", cpp_list, [&](const cron::expr &e){
+    sink = sink + e.next(g_search_from[0]).has_value();
+  });
+}
+
+/**
+ * Test the C++ interface against the C library.
+ *
+ * Usage: test-cpp [-b] FILE...
+ *
+ * Each FILE contains crontab lines to compare. The -b option also prints
+ * the time taken by the C and C++ code.
+ *
+ * @param[in] argc Number of arguments in @p argv.
+ * @param[in] argv Command line arguments.
+ * @retval    0    All tests passed.
+ */
+int
+main(int argc,
+     char *argv[]){
+  std::vector<std::string> lines;
+  std::string line;
+  bool bench = false;
+
+  for(int i = 1; i < argc; i++){
+    if(std::strcmp(argv[i], "-b") == 0){
+      bench = true;
+      continue;
+    }
+    std::ifstream file(argv[i]);
+    assert(file);
+    while(std::getline(file, line)){
+      lines.push_back(line);
+    }
+  }
+  assert(!lines.empty());
+  for(const std::string &l : lines){
+    test_cpp_line(l);
+  }
+  test_cpp_occurrences();
+  if(bench){
+    test_cpp_bench_all(lines);
+  }
+  return 0;
+}
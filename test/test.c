@@ -5,13 +5,18 @@
  *
  * This software has been placed into the public domain using CC0.
  */
+#include <sys/prctl.h>
+#include <sys/resource.h>
 #include <assert.h>
 #include <errno.h>
+#include <pwd.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "../src/cron.h"
+#include "../src/cron_expr.h"
+#include "../src/crond.h"
 #include "test.h"
 
 /**
@@ -24,6 +29,11 @@
  */
 #define PATH_TMP_SIMPLE "/tmp/test-cron-simple.txt"
 
+/**
+ * Path to the file written by the fake mailx in test/bin.
+ */
+#define PATH_TMP_MAILX "/tmp/test-cron-mailx.txt"
+
 /**
  * Path to the default crontab file retrieved from @ref cron_get_path_crontab.
  */
@@ -92,12 +102,152 @@ test_unit_si_all(void){
   test_unit_si_op_size(si_mul_size_t, SIZE_MAX, 2, SIZE_MAX / 2, 1);
 }
 
+/**
+ * Test harness for @ref cron_expr_compile.
+ *
+ * @param[in] str        Cron expression.
+ * @param[in] expect_rc  Expected return code.
+ * @param[in] expect_len Expected length of the expression, if it compiles.
+ */
+static void
+test_unit_expr_compile(const char *const str,
+                       const int expect_rc,
+                       const size_t expect_len){
+  struct cron_expr expr;
+  size_t len;
+  int rc;
+
+  rc = cron_expr_compile(&expr, str, &len);
+  assert(rc == expect_rc);
+  if(expect_rc == 0){
+    assert(len == expect_len);
+  }
+}
+
+/**
+ * Convert a wall time in the format YYYY-MM-DD HH:MM to a tm structure.
+ *
+ * @param[in]  str Wall time.
+ * @param[out] tm  Wall time with tm_wday set.
+ */
+static void
+test_unit_expr_tm(const char *const str,
+                  struct tm *const tm){
+  struct tm tm_wday;
+
+  memset(tm, 0, sizeof(*tm));
+  assert(sscanf(str,
+                "%d-%d-%d %d:%d",
+                &tm->tm_year,
+                &tm->tm_mon,
+                &tm->tm_mday,
+                &tm->tm_hour,
+                &tm->tm_min) == 5);
+  tm->tm_year -= 1900;
+  tm->tm_mon -= 1;
+  tm_wday = *tm;
+  assert(timegm(&tm_wday) != -1);
+  tm->tm_wday = tm_wday.tm_wday;
+}
+
+/**
+ * Test harness for @ref cron_expr_next and @ref cron_expr_prev.
+ *
+ * @param[in] str       Cron expression.
+ * @param[in] forward   Set to true to call @ref cron_expr_next, or false
+ *                      to call @ref cron_expr_prev.
+ * @param[in] from      Wall time to search from, YYYY-MM-DD HH:MM.
+ * @param[in] expect    Expected wall time found, YYYY-MM-DD HH:MM.
+ * @param[in] expect_rc Expected return code.
+ */
+static void
+test_unit_expr_search(const char *const str,
+                      const bool forward,
+                      const char *const from,
+                      const char *const expect,
+                      const int expect_rc){
+  struct cron_expr expr;
+  struct tm tm_from;
+  struct tm tm_expect;
+  struct tm tm;
+  int rc;
+
+  assert(cron_expr_compile(&expr, str, NULL) == 0);
+  test_unit_expr_tm(from, &tm_from);
+  if(forward){
+    rc = cron_expr_next(&expr, &tm_from, &tm);
+  }
+  else{
+    rc = cron_expr_prev(&expr, &tm_from, &tm);
+  }
+  assert(rc == expect_rc);
+  if(expect_rc == 0){
+    test_unit_expr_tm(expect, &tm_expect);
+    assert(tm.tm_year == tm_expect.tm_year);
+    assert(tm.tm_mon  == tm_expect.tm_mon);
+    assert(tm.tm_mday == tm_expect.tm_mday);
+    assert(tm.tm_hour == tm_expect.tm_hour);
+    assert(tm.tm_min  == tm_expect.tm_min);
+    assert(tm.tm_wday == tm_expect.tm_wday);
+    assert(tm.tm_sec == 0);
+    assert(cron_expr_match(&expr, &tm));
+  }
+}
+
+/**
+ * Run all test cases for the cron_expr_* functions.
+ */
+static void
+test_unit_expr_all(void){
+  struct cron_expr expr;
+  struct tm tm;
+
+  test_unit_expr_compile("* * * * *", 0, 9);
+  test_unit_expr_compile("* * * * * touch", 0, 10);
+  test_unit_expr_compile("1,2-4 0 31 12 6\t\tcmd", 0, 17);
+  test_unit_expr_compile("@daily", 0, 6);
+  test_unit_expr_compile("@hourly cmd", 0, 8);
+  test_unit_expr_compile("@invalid", -1, 0);
+  test_unit_expr_compile("60 * * * *", -1, 0);
+  test_unit_expr_compile("* 24 * * *", -1, 0);
+  test_unit_expr_compile("* * 0 * *", -1, 0);
+  test_unit_expr_compile("* * * 13 *", -1, 0);
+  test_unit_expr_compile("* * * * 7", -1, 0);
+  test_unit_expr_compile("* * * *", -1, 0);
+  test_unit_expr_compile("* * * * *x", -1, 0);
+  test_unit_expr_compile("", -1, 0);
+
+  assert(cron_expr_compile(&expr, "30 4 1 * 1", NULL) == 0);
+  test_unit_expr_tm("2024-01-01 04:30", &tm);
+  assert(cron_expr_match(&expr, &tm) == 1);
+  tm.tm_min = 31;
+  assert(cron_expr_match(&expr, &tm) == 0);
+
+  test_unit_expr_search("* * * * *", true,
+                        "2024-12-31 23:59", "2025-01-01 00:00", 0);
+  test_unit_expr_search("0 0 1 * *", true,
+                        "2024-01-31 12:00", "2024-02-01 00:00", 0);
+  test_unit_expr_search("0 12 29 2 *", true,
+                        "2024-03-01 00:00", "2028-02-29 12:00", 0);
+  test_unit_expr_search("0 0 30 2 *", true,
+                        "2024-01-01 00:00", NULL, -1);
+  test_unit_expr_search("@weekly", true,
+                        "2024-03-10 00:00", "2024-03-17 00:00", 0);
+  test_unit_expr_search("0 0 1 1 *", false,
+                        "2024-01-01 00:00", "2023-01-01 00:00", 0);
+  test_unit_expr_search("15 * * * *", false,
+                        "2024-03-01 00:10", "2024-02-29 23:15", 0);
+  test_unit_expr_search("0 12 29 2 *", false,
+                        "2024-02-29 12:00", "2020-02-29 12:00", 0);
+}
+
 /**
  * Run all unit tests.
  */
 static void
 test_unit_all(void){
   test_unit_si_all();
+  test_unit_expr_all();
 }
 
 /**
@@ -155,6 +305,42 @@ test_file_exists(const char *const path){
   return exists;
 }
 
+/**
+ * Check if a file contains a string.
+ *
+ * @param[in] path  Path to file.
+ * @param[in] str   String to search for in the file.
+ * @retval    true  File contains @p str.
+ * @retval    false File does not contain @p str.
+ */
+static bool
+test_file_contains(const char *const path,
+                   const char *const str){
+  FILE *fp;
+  char *buf;
+  size_t bufsz;
+  size_t buflen;
+  bool contains;
+
+  fp = fopen(path, "r");
+  assert(fp);
+  buf = NULL;
+  bufsz = 0;
+  buflen = 0;
+  while(!feof(fp)){
+    bufsz += 1000;
+    buf = realloc(buf, bufsz);
+    assert(buf);
+    buflen += fread(&buf[buflen], 1, bufsz - buflen - 1, fp);
+    assert(ferror(fp) == 0);
+  }
+  assert(fclose(fp) == 0);
+  buf[buflen] = '\0';
+  contains = strstr(buf, str) != NULL;
+  free(buf);
+  return contains;
+}
+
 /**
  * Check if the @ref PATH_TMP_SIMPLE file exists and remove it if it does.
  *
@@ -360,6 +546,257 @@ test_crontab_mkdir(void){
   assert(setenv("HOME", old_env, 1) == 0);
 }
 
+/**
+ * Run crontab with an option that prints a report about a crontab file.
+ *
+ * Usage: crontab option arg [file]
+ *
+ * @param[in] option             Option flag, like -s.
+ * @param[in] arg                Argument of @p option.
+ * @param[in] file               Crontab file, or NULL for the installed
+ *                               crontab.
+ * @param[in] expect_exit_status Expected exit code from @ref crontab_main.
+ * @param[in] expect_output      NULL-terminated list of strings expected
+ *                               in the output, or NULL to skip checking.
+ */
+static void
+test_crontab_report(const char *const option,
+                    const char *const arg,
+                    const char *const file,
+                    const int expect_exit_status,
+                    const char *const *const expect_output){
+  const char *const PATH_TMP_REPORT = "/tmp/test-cron-report.out";
+  pid_t pid;
+  int wstatus;
+  FILE *fp;
+  size_t i;
+
+  pid = fork();
+  assert(pid >= 0);
+  if(pid == 0){
+    fp = freopen(PATH_TMP_REPORT, "w", stdout);
+    assert(fp);
+    g_argc = file ? 4 : 3;
+    strcpy(g_argv[0], "crontab");
+    strcpy(g_argv[1], option);
+    strcpy(g_argv[2], arg);
+    if(file){
+      strcpy(g_argv[3], file);
+    }
+    test_crontab_main(expect_exit_status);
+    exit(EXIT_SUCCESS);
+  }
+  assert(waitpid(pid, &wstatus, 0) == pid);
+  assert(WEXITSTATUS(wstatus) == EXIT_SUCCESS);
+  for(i = 0; expect_output && expect_output[i]; i++){
+    assert(test_file_contains(PATH_TMP_REPORT, expect_output[i]));
+  }
+  assert(remove(PATH_TMP_REPORT) == 0);
+}
+
+/**
+ * Test the crontab -s schedule simulation.
+ */
+static void
+test_crontab_simulate_all(void){
+  const char *const PATH_SIMULATE = "test/crontabs/simulate.txt";
+  const char *const EXPECT_DAY[] = {
+    "minutes 1440\n",
+    "jobs 4\n",
+    "skipped 2\n",
+    "runs 50\n",
+    "concurrency 0 1415\n",
+    "concurrency 1 1\n",
+    "concurrency 2 23\n",
+    "concurrency 3 1\n",
+    "peak 2024-02-29T00:00 3\n",
+    "peak 2024-02-29T01:00 2\n",
+    "job 24 0 * * * * touch /tmp/test-cron-simulate-2.txt\n",
+    "job 1 30 2 * * * touch /tmp/test-cron-simulate-3.txt\n",
+    "job 1 0 0 29 2 * touch /tmp/test-cron-simulate-4.txt\n",
+    NULL
+  };
+  const char *const EXPECT_YEARS[] = {
+    "job 2 0 0 29 2 * touch /tmp/test-cron-simulate-4.txt\n",
+    NULL
+  };
+  const char *const EXPECT_INSTALLED[] = {
+    "jobs 1\n",
+    "runs 1440\n",
+    NULL
+  };
+  const char *const INVALID_RANGE[] = {
+    "2024-02-29T00:00",
+    "2024-02-29T00:00,",
+    "2024-02-29T00:00,2024-02-29T00:00",
+    "2024-02-29T00:00,2024-02-28T00:00",
+    "2024-13-01T00:00,2025-01-01T00:00",
+    "2024-04-31T00:00,2024-05-02T00:00",
+    "2024-01-01T00:00,2025-01-01T00:00x",
+    "2024-01-01T00:00,2035-01-01T00:00",
+    "2024-01-01T00:00;2025-01-01T00:00"
+  };
+  size_t i;
+
+  test_describe("simulate one day of a crontab");
+  test_crontab_report("-s",
+                      "2024-02-29T00:00,2024-03-01T00:00",
+                      PATH_SIMULATE,
+                      EXIT_SUCCESS,
+                      EXPECT_DAY);
+
+  test_describe("simulate several years of a crontab");
+  test_crontab_report("-s",
+                      "2024-01-01T00:00,2029-01-01T00:00",
+                      PATH_SIMULATE,
+                      EXIT_SUCCESS,
+                      EXPECT_YEARS);
+
+  test_describe("simulate the installed crontab");
+  test_crontab_report("-s",
+                      "2024-01-01T00:00,2024-01-02T00:00",
+                      NULL,
+                      EXIT_SUCCESS,
+                      EXPECT_INSTALLED);
+
+  test_describe("simulate an invalid time range");
+  for(i = 0; i < sizeof(INVALID_RANGE) / sizeof(*INVALID_RANGE); i++){
+    test_crontab_report("-s",
+                        INVALID_RANGE[i],
+                        PATH_SIMULATE,
+                        EXIT_FAILURE,
+                        NULL);
+  }
+
+  test_describe("simulate a crontab that does not exist");
+  test_crontab_report("-s",
+                      "2024-01-01T00:00,2024-01-02T00:00",
+                      "test/crontabs/noexist.txt",
+                      EXIT_FAILURE,
+                      NULL);
+
+  for(i = 0; i < 4; i++){
+    g_test_seam_err_ctr_realloc = (int)i;
+    test_crontab_report("-s",
+                        "2024-01-01T00:00,2024-01-02T00:00",
+                        PATH_SIMULATE,
+                        EXIT_FAILURE,
+                        NULL);
+    g_test_seam_err_ctr_realloc = -1;
+  }
+
+  g_test_seam_err_ctr_strdup = 0;
+  test_crontab_report("-s",
+                      "2024-01-01T00:00,2024-01-02T00:00",
+                      PATH_SIMULATE,
+                      EXIT_FAILURE,
+                      NULL);
+  g_test_seam_err_ctr_strdup = -1;
+
+  g_test_seam_err_ctr_ferror = 0;
+  test_crontab_report("-s",
+                      "2024-01-01T00:00,2024-01-02T00:00",
+                      PATH_SIMULATE,
+                      EXIT_FAILURE,
+                      NULL);
+  g_test_seam_err_ctr_ferror = -1;
+}
+
+/**
+ * Test the crontab -n run times.
+ */
+static void
+test_crontab_next_all(void){
+  const char *const PATH_NEXT = "test/crontabs/next.txt";
+  const char *const EXPECT_NEXT[] = {
+    "0 0 29 2 * touch /tmp/test-cron-next-1.txt\n"
+    "2024-02-29T00:00+0000 2024-02-29T00:00Z\n"
+    "2028-02-29T00:00+0000 2028-02-29T00:00Z\n"
+    "30 2 * * * touch /tmp/test-cron-next-2.txt\n"
+    "2024-02-29T02:30+0530 2024-02-28T21:00Z\n"
+    "2024-03-01T02:30+0530 2024-02-29T21:00Z\n"
+    "0 0 30 2 * touch /tmp/test-cron-next-3.txt\n"
+    "never\n",
+    NULL
+  };
+  const char *const EXPECT_INVALID[] = {
+    "0 0 * * * touch /tmp/test-cron-next-4.txt\n"
+    "2024-02-29T00:00+0000 2024-02-29T00:00Z\n",
+    NULL
+  };
+  const char *const INVALID_COUNT[] = {
+    "0",
+    "-1",
+    "x",
+    "1x",
+    "10001"
+  };
+  static struct tm tm;
+  const char *old_env;
+  size_t i;
+
+  old_env = getenv("TZ");
+  assert(setenv("TZ", "UTC", 1) == 0);
+  memset(&tm, 0, sizeof(tm));
+  tm.tm_min = 59;
+  tm.tm_hour = 23;
+  tm.tm_mday = 28;
+  tm.tm_mon = 1;
+  tm.tm_year = 124;
+  tm.tm_wday = 3;
+  g_test_seam_localtime_tm = &tm;
+
+  test_describe("print the next run times of each job");
+  test_crontab_report("-n", "2", PATH_NEXT, EXIT_SUCCESS, EXPECT_NEXT);
+
+  test_describe("print the next run times with an invalid job");
+  test_crontab_report("-n",
+                      "1",
+                      "test/crontabs/next-invalid.txt",
+                      EXIT_FAILURE,
+                      EXPECT_INVALID);
+
+  test_describe("print the next run times of the installed crontab");
+  test_crontab_report("-n", "1", NULL, EXIT_SUCCESS, NULL);
+
+  test_describe("print the next run times of a job in STDIN");
+  assert(system("echo '0 0 * * * true' | "
+                "build/debug/crontab -n 3 - | "
+                "grep -c Z$ | grep -q 3") == 0);
+
+  test_describe("print the next run times with an invalid count");
+  for(i = 0; i < sizeof(INVALID_COUNT) / sizeof(*INVALID_COUNT); i++){
+    test_crontab_report("-n", INVALID_COUNT[i], PATH_NEXT, EXIT_FAILURE, NULL);
+  }
+
+  test_describe("print the next run times of a crontab that does not exist");
+  test_crontab_report("-n",
+                      "1",
+                      "test/crontabs/noexist.txt",
+                      EXIT_FAILURE,
+                      NULL);
+
+  g_test_seam_err_ctr_strdup = 0;
+  test_crontab_report("-n", "1", PATH_NEXT, EXIT_FAILURE, NULL);
+  g_test_seam_err_ctr_strdup = -1;
+
+  g_test_seam_err_ctr_ferror = 0;
+  test_crontab_report("-n", "1", PATH_NEXT, EXIT_FAILURE, NULL);
+  g_test_seam_err_ctr_ferror = -1;
+
+  g_test_seam_err_ctr_localtime = 0;
+  test_crontab_report("-n", "1", PATH_NEXT, EXIT_FAILURE, NULL);
+  g_test_seam_err_ctr_localtime = -1;
+
+  g_test_seam_localtime_tm = NULL;
+  if(old_env){
+    assert(setenv("TZ", old_env, 1) == 0);
+  }
+  else{
+    assert(unsetenv("TZ") == 0);
+  }
+}
+
 /**
  * Run all test cases for the crontab program.
  */
@@ -513,15 +950,21 @@ test_crontab_all(void){
   /* Add a crontab using STDIN. */
   assert(system("build/debug/crontab < " PATH_CRONTAB_SIMPLE) == 0);
   test_crontab_list_check_file(PATH_CRONTAB_SIMPLE);
+
+  test_crontab_simulate_all();
+  test_crontab_next_all();
 }
 
 /**
- * Fork a new crond process.
+ * Fork a new crond process with an additional command line option.
  *
- * @return Child process ID.
+ * @param[in] opt       Option flag passed to crond, or NULL for none.
+ * @param[in] opt_value Value of @p opt, or NULL if the option has no value.
+ * @return              Child process ID.
  */
 static pid_t
-test_crond_fork(void){
+test_crond_fork_opt(const char *const opt,
+                    const char *const opt_value){
   pid_t pid;
   int exit_status;
 
@@ -531,12 +974,30 @@ test_crond_fork(void){
     g_argc = 2;
     strcpy(g_argv[0], "crond");
     strcpy(g_argv[1], "-v");
+    if(opt){
+      strcpy(g_argv[g_argc], opt);
+      g_argc += 1;
+    }
+    if(opt_value){
+      strcpy(g_argv[g_argc], opt_value);
+      g_argc += 1;
+    }
     exit_status = crond_main(g_argc, g_argv);
     exit(exit_status);
   }
   return pid;
 }
 
+/**
+ * Fork a new crond process.
+ *
+ * @return Child process ID.
+ */
+static pid_t
+test_crond_fork(void){
+  return test_crond_fork_opt(NULL, NULL);
+}
+
 /**
  * Wait for the crond process to exit.
  *
@@ -560,7 +1021,7 @@ test_crond_wait(const pid_t pid,
  * @param[in] tm_min  Minute.
  * @param[in] tm_hour Hour
  * @param[in] tm_mday Day of the month.
- * @param[in] tm_mon  Month of the year.
+ * @param[in] tm_mon  Month of the year (1-12).
  * @param[in] tm_wday Day of the week.
  */
 static void
@@ -577,7 +1038,7 @@ test_crond_set_tm(const int tm_sec,
   g_test_tm.tm_min  = tm_min;
   g_test_tm.tm_hour = tm_hour;
   g_test_tm.tm_mday = tm_mday;
-  g_test_tm.tm_mon  = tm_mon;
+  g_test_tm.tm_mon  = tm_mon - 1;
   g_test_tm.tm_wday = tm_wday;
   g_test_seam_localtime_tm = &g_test_tm;
 }
@@ -706,20 +1167,93 @@ test_crond_stdin_lines(void){
 }
 
 /**
- * Test scenarios that send job output through mailx.
+ * Put the fake mailx in test/bin at the front of PATH.
+ *
+ * @return Previous PATH. Pass this to @ref test_mailx_path_restore.
+ */
+static char *
+test_mailx_path_set(void){
+  char cwd[1000];
+  char path[3000];
+  char *old_path;
+
+  old_path = getenv("PATH");
+  assert(old_path);
+  old_path = strdup(old_path);
+  assert(old_path);
+  assert(getcwd(cwd, sizeof(cwd)));
+  assert((size_t)snprintf(path,
+                          sizeof(path),
+                          "%s/test/bin:%s",
+                          cwd,
+                          old_path) < sizeof(path));
+  assert(setenv("PATH", path, 1) == 0);
+  return old_path;
+}
+
+/**
+ * Restore the PATH changed by @ref test_mailx_path_set.
+ *
+ * @param[in] old_path Previous PATH.
+ */
+static void
+test_mailx_path_restore(char *const old_path){
+  assert(setenv("PATH", old_path, 1) == 0);
+  free(old_path);
+}
+
+/**
+ * Wait for the fake mailx to record a mail and verify it.
  *
- * @todo Verify mailx output.
+ * The mail can arrive after crond exits, because the job monitor keeps
+ * running until the job finishes.
+ *
+ * @param[in] command Command of the job in the mail subject.
+ * @param[in] bodysz  Expected number of bytes in the mail body.
+ */
+static void
+test_mailx_verify(const char *const command,
+                  const unsigned long bodysz){
+  char subject[1000];
+  unsigned long mail_bodysz;
+  FILE *fp;
+  int i;
+
+  for(i = 0; i < 120 && !test_file_exists(PATH_TMP_MAILX); i++){
+    test_sleep_max_file();
+  }
+  fp = fopen(PATH_TMP_MAILX, "r");
+  assert(fp);
+  assert(fgets(subject, sizeof(subject), fp));
+  assert(fscanf(fp, "%lu", &mail_bodysz) == 1);
+  assert(fclose(fp) == 0);
+  assert(strncmp(subject, "Cron <", strlen("Cron <")) == 0);
+  assert(strstr(subject, "> ") &&
+         strcmp(strstr(subject, "> ") + 2, command) == 0);
+  assert(mail_bodysz == bodysz);
+  assert(remove(PATH_TMP_MAILX) == 0);
+}
+
+/**
+ * Test scenarios that send job output through mailx.
  */
 static void
 test_crond_mailx(void){
   int i;
   const char *old_env;
+  char *old_path;
 
+  old_path = test_mailx_path_set();
+  if(test_file_exists(PATH_TMP_MAILX)){
+    assert(remove(PATH_TMP_MAILX) == 0);
+  }
   test_crontab_add("test/crontabs/mailx.txt", EXIT_SUCCESS);
 
   test_crond_set_tm(0, 4, 4, 4, 4, 4);
 
+  test_describe("mail the output of a job");
   test_crond_verify_file_create("/tmp/test-cron-echo-output.txt");
+  test_mailx_verify("test/echo-output.sh\n", 52);
 
   test_describe("(1) Get username using getpwuid instead of env variable");
   test_describe("(2) Test getpwuid does not return an entry (empty username)");
@@ -746,15 +1280,50 @@ test_crond_mailx(void){
   g_test_seam_err_ctr_read = -1;
   g_test_seam_err_force_errno = 0;
 
-  g_test_seam_err_ctr_si_add_size_t = 2;
+  g_test_seam_err_ctr_si_add_size_t = 4;
   test_crond_fork_main(EXIT_SUCCESS);
   g_test_seam_err_ctr_si_add_size_t = -1;
 
-  g_test_seam_err_ctr_realloc = 1;
+  test_describe("failed to allocate the output buffer in the job monitor");
+  g_test_seam_err_req_fork_jobmon = true;
+  g_test_seam_err_ctr_malloc = 0;
   test_crond_fork_main(EXIT_SUCCESS);
-  g_test_seam_err_ctr_realloc = -1;
+  g_test_seam_err_ctr_malloc = -1;
+  g_test_seam_err_req_fork_jobmon = false;
+
+  test_describe("failed to ignore SIGPIPE in the job monitor");
+  g_test_seam_err_req_fork_jobmon = true;
+  g_test_seam_err_ctr_sigaction = 0;
+  test_crond_fork_main(EXIT_SUCCESS);
+  g_test_seam_err_ctr_sigaction = -1;
+  g_test_seam_err_req_fork_jobmon = false;
+
+  test_describe("failed to pass output to mailx, but the job keeps running");
+  g_test_seam_err_req_fork_jobmon = true;
+  g_test_seam_err_force_errno = EIO;
+  g_test_seam_err_ctr_write = 0;
+  test_crond_verify_file_create("/tmp/test-cron-echo-output.txt");
+  g_test_seam_err_ctr_write = -1;
+  g_test_seam_err_force_errno = 0;
+  g_test_seam_err_req_fork_jobmon = false;
+
+  test_describe("failed to close the mailx pipe after the output");
+  g_test_seam_err_req_fork_jobmon = true;
+  g_test_seam_err_ctr_close = 8;
+  test_crond_verify_file_create("/tmp/test-cron-echo-output.txt");
+  g_test_seam_err_ctr_close = -1;
+  g_test_seam_err_req_fork_jobmon = false;
+  test_sleep_max_file();
+  if(test_file_exists(PATH_TMP_MAILX)){
+    assert(remove(PATH_TMP_MAILX) == 0);
+  }
 
+  test_describe("failed to set the email address");
   g_test_seam_err_ctr_snprintf = 0;
+  test_crond_fork_main(EXIT_FAILURE);
+  g_test_seam_err_ctr_snprintf = -1;
+
+  g_test_seam_err_ctr_snprintf = 1;
   test_crond_verify_file_create("/tmp/test-cron-echo-output.txt");
   g_test_seam_err_ctr_snprintf = -1;
 
@@ -790,6 +1359,51 @@ test_crond_mailx(void){
   test_crond_fork_main(EXIT_SUCCESS);
   g_test_seam_err_ctr_execlp = -1;
 
+  test_sleep_max_file();
+  if(test_file_exists(PATH_TMP_MAILX)){
+    assert(remove(PATH_TMP_MAILX) == 0);
+  }
+  test_mailx_path_restore(old_path);
+  g_test_seam_localtime_tm = NULL;
+}
+
+/**
+ * Test that the job monitor passes a large output to mailx without keeping
+ * it in memory.
+ *
+ * The crond process gets a data segment limit much smaller than the
+ * output, which the job monitor and mailx inherit.
+ */
+static void
+test_crond_output_large(void){
+  struct rlimit rlim;
+  char *old_path;
+  pid_t pid;
+  int exit_status;
+
+  old_path = test_mailx_path_set();
+  test_crontab_add("test/crontabs/output-large.txt", EXIT_SUCCESS);
+  test_crond_set_tm(0, 4, 4, 4, 4, 4);
+
+  test_describe("mail 128 MiB of output with a 32 MiB data limit");
+  pid = fork();
+  assert(pid >= 0);
+  if(pid == 0){
+    rlim.rlim_cur = 32UL * 1024 * 1024;
+    rlim.rlim_max = rlim.rlim_cur;
+    assert(setrlimit(RLIMIT_DATA, &rlim) == 0);
+    g_argc = 2;
+    strcpy(g_argv[0], "crond");
+    strcpy(g_argv[1], "-v");
+    exit_status = crond_main(g_argc, g_argv);
+    exit(exit_status);
+  }
+  test_sleep_max_file();
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  test_mailx_verify("head -c 134217728 /dev/zero\n", 134217728);
+
+  test_mailx_path_restore(old_path);
   g_test_seam_localtime_tm = NULL;
 }
 
@@ -948,8 +1562,8 @@ test_crond_simple_file(void){
     g_test_seam_err_ctr_dup2 = -1;
   }
 
-  test_describe("fail to close dup2'ed file descriptors in job process");
-  for(i = 0; i < 4; i++){
+  test_describe("fail to close descriptors in job monitor and job process");
+  for(i = 0; i < 7; i++){
     g_test_seam_err_req_fork_jobmon = true;
     g_test_seam_err_ctr_close = i;
     test_crond_fork_main(EXIT_SUCCESS);
@@ -1007,51 +1621,1443 @@ test_crond_simple_file(void){
 }
 
 /**
- * Run all test cases for crond.
+ * Test counting the memory used by the loaded jobs.
  */
 static void
-test_crond_all(void){
-  int i;
+test_crond_mem(void){
+  struct crond crond;
+  struct crond_mem mem;
+
+  test_describe("count the memory of the loaded jobs");
+  memset(&crond, 0, sizeof(crond));
+  crond_mem_count(&crond, &mem);
+  assert(mem.jobs == 0 && mem.schedules == 0 && mem.commands == 0);
+  assert(mem.unused == 0 && mem.indexes == 0 && mem.environment == 0);
+
+  crond_crontab_parse_line(&crond, "* * * * * echo a%line1%line2", 0, 0);
+  crond_crontab_parse_line(&crond, "0 0 * * * true", 0, 1);
+  crond_mem_count(&crond, &mem);
+  assert(mem.jobs == 2 * (sizeof(struct crond_job) - sizeof(struct cron_expr)));
+  assert(mem.schedules == 2 * sizeof(struct cron_expr));
+  assert(mem.commands == sizeof("echo a") + sizeof("true"));
+  assert(mem.stdin_lines == strlen("line1\nline2\n"));
+  assert(mem.unused == 0);
+
+  test_describe("count the slot of a removed job as unused");
+  crond_job_list_free(&crond, false, 1);
+  crond_mem_count(&crond, &mem);
+  assert(mem.jobs == sizeof(struct crond_job) - sizeof(struct cron_expr));
+  assert(mem.commands == sizeof("echo a"));
+  assert(mem.unused == sizeof(struct crond_job));
+  crond_job_list_free(&crond, true, SIZE_MAX);
+  assert(crond.job_list == NULL);
+}
+
+/**
+ * Test the Prometheus metrics file.
+ */
+static void
+test_crond_metrics(void){
+  const char *const PATH_METRICS = "/tmp/test-cron-metrics.prom";
+  char mem_line[100];
   pid_t pid;
 
-  test_crond_remove_lock_file();
-  test_crontab_remove(EXIT_SUCCESS);
+  test_crontab_add("test/crontabs/metrics.txt", EXIT_SUCCESS);
+  remove(PATH_METRICS);
+  test_crond_set_tm(0, 1, 1, 1, 1, 1);
 
-  test_describe("invalid argument");
-  g_argc = 2;
+  test_describe("write job statistics to the metrics file");
+  pid = test_crond_fork_opt("-m", PATH_METRICS);
+  test_sleep_max_file();
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  test_simple_file_verify_remove(true);
+  assert(test_file_contains(PATH_METRICS, "crond_jobs 2\n"));
+  assert(test_file_contains(PATH_METRICS,
+                            "crond_job_runs_total{job=\"0\","
+                            "source=\"crontab\","
+                            "command=\"touch /tmp/test-cron-simple.txt\"}"
+                            " 1\n"));
+  assert(test_file_contains(PATH_METRICS,
+                            "crond_job_failures_total{job=\"0\","
+                            "source=\"crontab\","
+                            "command=\"touch /tmp/test-cron-simple.txt\"}"
+                            " 0\n"));
+  assert(test_file_contains(PATH_METRICS,
+                            "crond_job_failures_total{job=\"1\","
+                            "source=\"crontab\","
+                            "command=\"exit 3 # \\\"quoted\\\"\"} 1\n"));
+  assert(test_file_contains(PATH_METRICS,
+                            "crond_job_last_exit_code{job=\"1\","
+                            "source=\"crontab\","
+                            "command=\"exit 3 # \\\"quoted\\\"\"} 3\n"));
+  assert(test_file_contains(PATH_METRICS,
+                            "crond_job_running{job=\"1\","
+                            "source=\"crontab\","
+                            "command=\"exit 3 # \\\"quoted\\\"\"} 0\n"));
+  assert(test_file_contains(PATH_METRICS,
+                            "crond_dispatch_lateness_seconds_count 2\n"));
+  assert(test_file_contains(PATH_METRICS,
+                            "crond_reload_duration_seconds_count 1\n"));
+  assert(snprintf(mem_line,
+                  sizeof(mem_line),
+                  "crond_memory_bytes{kind=\"schedules\"} %lu\n",
+                  (unsigned long)(2 * sizeof(struct cron_expr))) > 0);
+  assert(test_file_contains(PATH_METRICS, mem_line));
+  assert(test_file_contains(PATH_METRICS,
+                            "crond_memory_bytes{kind=\"commands\"} 50\n"));
+  assert(test_file_contains(PATH_METRICS,
+                            "crond_memory_bytes{kind=\"stdin\"} 0\n"));
+  assert(remove(PATH_METRICS) == 0);
+
+  test_describe("metrics directory does not exist");
+  pid = test_crond_fork_opt("-m", "/tmp/test-cron-noexist/metrics.prom");
+  test_sleep_max_file();
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  test_simple_file_verify_remove(true);
+
+  test_describe("failed to allocate the temporary metrics file path");
+  g_argc = 3;
   strcpy(g_argv[0], "crond");
-  strcpy(g_argv[1], "-a");
+  strcpy(g_argv[1], "-m");
+  strcpy(g_argv[2], PATH_METRICS);
+  g_test_seam_err_ctr_malloc = 1;
   test_crond_main(EXIT_FAILURE);
-  strcpy(g_argv[1], "-v");
+  g_test_seam_err_ctr_malloc = -1;
+  assert(test_file_exists(PATH_METRICS) == false);
 
-  g_test_seam_err_ctr_sigemptyset = 0;
-  test_crond_main(EXIT_FAILURE);
-  g_test_seam_err_ctr_sigemptyset = -1;
-  for(i = 0; i < 3; i++){
-    g_test_seam_err_ctr_sigaction = i;
-    test_crond_main(EXIT_FAILURE);
-    g_test_seam_err_ctr_sigaction = -1;
-  }
+  g_test_seam_localtime_tm = NULL;
+}
 
-  for(i = 0; i < 2; i++){
-    g_test_seam_err_ctr_si_add_size_t = i;
-    test_crond_main(EXIT_FAILURE);
-    g_test_seam_err_ctr_si_add_size_t = -1;
-  }
+/**
+ * Test the Chrome Trace Event file.
+ */
+static void
+test_crond_trace(void){
+  const char *const PATH_TRACE = "/tmp/test-cron-trace.json";
+  pid_t pid;
+  int i;
 
-  for(i = 0; i < 2; i++){
-    g_test_seam_err_ctr_malloc = i;
-    test_crond_main(EXIT_FAILURE);
-    g_test_seam_err_ctr_malloc = -1;
-  }
+  test_crontab_add("test/crontabs/trace.txt", EXIT_SUCCESS);
+  remove(PATH_TRACE);
+  test_crond_set_tm(0, 1, 1, 1, 1, 1);
 
-  g_test_seam_err_ctr_clock_gettime = 0;
+  test_describe("write job phases to the trace file");
+  pid = test_crond_fork_opt("-t", PATH_TRACE);
+  test_sleep_max_file();
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  test_simple_file_verify_remove(true);
+  /* The job monitor appends its events after delivering the output. */
+  for(i = 0; i < 20; i++){
+    if(test_file_contains(PATH_TRACE, "{\"name\":\"output\"")){
+      break;
+    }
+    test_sleep_max_file();
+  }
+  assert(test_file_exists("/tmp/test-cron-echo-output.txt"));
+  assert(remove("/tmp/test-cron-echo-output.txt") == 0);
+  assert(test_file_contains(PATH_TRACE,
+                            "[\n{\"name\":\"process_name\",\"ph\":\"M\""));
+  assert(test_file_contains(PATH_TRACE,
+                            "\"tid\":1,\"args\":{\"name\":"
+                            "\"touch /tmp/test-cron-simple.txt\"}}"));
+  assert(test_file_contains(PATH_TRACE,
+                            "\"tid\":2,\"args\":{\"name\":"
+                            "\"test/echo-output.sh\"}}"));
+  assert(test_file_contains(PATH_TRACE,
+                            ",\n{\"name\":\"scheduled\",\"cat\":\"job\""));
+  assert(test_file_contains(PATH_TRACE,
+                            ",\n{\"name\":\"spawn\",\"cat\":\"job\""));
+  assert(test_file_contains(PATH_TRACE,
+                            ",\n{\"name\":\"running\",\"cat\":\"job\""));
+  assert(test_file_contains(PATH_TRACE, "\"args\":{\"exit_code\":0}}"));
+  assert(test_file_contains(PATH_TRACE,
+                            ",\n{\"name\":\"output\",\"cat\":\"job\""));
+  assert(test_file_contains(PATH_TRACE, "\"args\":{\"bytes\":52}}"));
+  assert(test_file_contains(PATH_TRACE,
+                            ",\n{\"name\":\"running\",\"ph\":\"C\""));
+  assert(remove(PATH_TRACE) == 0);
+
+  test_describe("trace directory does not exist");
+  pid = test_crond_fork_opt("-t", "/tmp/test-cron-noexist/trace.json");
+  test_crond_wait(pid, EXIT_FAILURE);
+
+  test_describe("failed to allocate the trace buffer");
+  g_argc = 3;
+  strcpy(g_argv[0], "crond");
+  strcpy(g_argv[1], "-t");
+  strcpy(g_argv[2], PATH_TRACE);
+  g_test_seam_err_ctr_malloc = 2;
   test_crond_main(EXIT_FAILURE);
-  g_test_seam_err_ctr_clock_gettime = -1;
+  g_test_seam_err_ctr_malloc = -1;
+  assert(test_file_exists(PATH_TRACE) == false);
 
-  g_test_seam_err_ctr_localtime = 0;
-  test_crond_main(EXIT_FAILURE);
-  g_test_seam_err_ctr_localtime = -1;
+  g_test_seam_localtime_tm = NULL;
+}
+
+/**
+ * Send a command to crond through the control socket.
+ *
+ * Usage: crontab -c command
+ *
+ * @param[in] command            Command sent to crond.
+ * @param[in] expect_exit_status Expected exit code from @ref crontab_main.
+ * @param[in] expect_output      Expected string in the response, or NULL
+ *                               to skip checking the response.
+ */
+static void
+test_crontab_control(const char *const command,
+                     const int expect_exit_status,
+                     const char *const expect_output){
+  const char *const PATH_TMP_CONTROL = "/tmp/test-cron-control.out";
+  pid_t pid;
+  int wstatus;
+  FILE *fp;
+
+  pid = fork();
+  assert(pid >= 0);
+  if(pid == 0){
+    fp = freopen(PATH_TMP_CONTROL, "w", stdout);
+    assert(fp);
+    g_argc = 3;
+    strcpy(g_argv[0], "crontab");
+    strcpy(g_argv[1], "-c");
+    strcpy(g_argv[2], command);
+    test_crontab_main(expect_exit_status);
+    exit(EXIT_SUCCESS);
+  }
+  assert(waitpid(pid, &wstatus, 0) == pid);
+  assert(WEXITSTATUS(wstatus) == EXIT_SUCCESS);
+  if(expect_output){
+    assert(test_file_contains(PATH_TMP_CONTROL, expect_output));
+  }
+  assert(remove(PATH_TMP_CONTROL) == 0);
+}
+
+/**
+ * Test the crond control socket.
+ */
+static void
+test_crond_control(void){
+  const char *const PATH_TMP_CONTROL = "/tmp/test-cron-control.txt";
+  char long_command[CRON_CONTROL_REQUEST_SZ + 1];
+  const char *old_env;
+  pid_t pid;
+
+  test_crontab_add("test/crontabs/control.txt", EXIT_SUCCESS);
+  test_crond_set_tm(0, 1, 1, 1, 1, 1);
+
+  test_describe("crond not running");
+  test_crontab_control("list", EXIT_FAILURE, NULL);
+
+  pid = test_crond_fork();
+  test_sleep_max_file();
+  test_simple_file_verify_remove(true);
+
+  test_describe("list jobs with the next run time");
+  test_crontab_control("list",
+                       EXIT_SUCCESS,
+                       "0 active 0 1900-01-01T01:02 "
+                       "touch /tmp/test-cron-simple.txt\n"
+                       "1 active 0 1901-01-01T00:00 "
+                       "touch /tmp/test-cron-control.txt\n");
+
+  test_describe("pause and resume a job");
+  test_crontab_control("pause 0", EXIT_SUCCESS, "ok\n");
+  test_crontab_control("list", EXIT_SUCCESS, "0 paused 0 ");
+  test_crontab_control("resume 0", EXIT_SUCCESS, "ok\n");
+  test_crontab_control("list", EXIT_SUCCESS, "0 active 0 ");
+
+  test_describe("run a job now");
+  assert(test_file_exists(PATH_TMP_CONTROL) == false);
+  test_crontab_control("run 1", EXIT_SUCCESS, "ok\n");
+  test_sleep_max_file();
+  assert(test_file_exists(PATH_TMP_CONTROL));
+  assert(remove(PATH_TMP_CONTROL) == 0);
+
+  test_describe("reload the crontab and print the statistics");
+  test_crontab_control("reload", EXIT_SUCCESS, "ok\n");
+  test_crontab_control("stats", EXIT_SUCCESS, "crond_jobs 2\n");
+  test_crontab_control("stats",
+                       EXIT_SUCCESS,
+                       "crond_reload_duration_seconds_count 2\n");
+
+  test_describe("invalid control commands");
+  test_crontab_control("run 2", EXIT_FAILURE, "error: no such job\n");
+  test_crontab_control("pause", EXIT_FAILURE, "error: no such job\n");
+  test_crontab_control("resume x", EXIT_FAILURE, "error: no such job\n");
+  test_crontab_control("invalid", EXIT_FAILURE, "error: unknown command\n");
+  test_crontab_control("list\nlist", EXIT_FAILURE, NULL);
+  memset(long_command, 'a', sizeof(long_command) - 1);
+  long_command[sizeof(long_command) - 1] = '\0';
+  test_crontab_control(long_command, EXIT_FAILURE, NULL);
+
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  test_simple_file_verify_remove(false);
+
+  test_describe("control socket removed when crond exits");
+  test_crontab_control("list", EXIT_FAILURE, NULL);
+
+  test_describe("control socket path too long");
+  old_env = getenv("HOME");
+  assert(old_env);
+  memset(long_command, 'a', sizeof(long_command) - 1);
+  long_command[0] = '/';
+  assert(setenv("HOME", long_command, 1) == 0);
+  test_crontab_control("list", EXIT_FAILURE, NULL);
+  assert(setenv("HOME", old_env, 1) == 0);
+
+  g_test_seam_localtime_tm = NULL;
+}
+
+/**
+ * Write a persisted ephemeral job file used by @ref test_crond_ephemeral.
+ *
+ * @param[in] path     Path to the job file.
+ * @param[in] contents Contents of the job file.
+ */
+static void
+test_crond_ephemeral_write(const char *const path,
+                           const char *const contents){
+  FILE *fp;
+
+  fp = fopen(path, "w");
+  assert(fp);
+  assert(fputs(contents, fp) >= 0);
+  assert(fclose(fp) == 0);
+}
+
+/**
+ * Test adding and removing ephemeral jobs through the control socket.
+ */
+static void
+test_crond_ephemeral(void){
+  const char *const PATH_TMP_EPHEMERAL = "/tmp/test-cron-ephemeral.txt";
+  const char *const PATH_EPHEMERAL_DIR = "/tmp/test-cron-ephemeral.d";
+  int i;
+  pid_t pid;
+
+  test_crontab_add("test/crontabs/control.txt", EXIT_SUCCESS);
+  test_crond_set_tm(59, 1, 1, 1, 1, 1);
+
+  pid = test_crond_fork();
+  test_sleep_max_file();
+
+  test_describe("add an ephemeral job");
+  test_crontab_control("add 0 * * * * * touch /tmp/test-cron-ephemeral.txt",
+                       EXIT_SUCCESS,
+                       "ok 2.0\n");
+  test_crontab_control("list", EXIT_SUCCESS, "\n2.0 active ");
+  for(i = 0; i < 6 && test_file_exists(PATH_TMP_EPHEMERAL) == false; i++){
+    test_sleep_max_file();
+  }
+  assert(remove(PATH_TMP_EPHEMERAL) == 0);
+
+  test_describe("ephemeral jobs survive a crontab reload");
+  test_crontab_control("reload", EXIT_SUCCESS, "ok\n");
+  test_crontab_control("stats", EXIT_SUCCESS, "crond_jobs 3\n");
+  test_crontab_control("list", EXIT_SUCCESS, "\n2.0 active ");
+
+  test_describe("remove an ephemeral job");
+  test_crontab_control("remove 2.1", EXIT_FAILURE, "error: no such job\n");
+  test_crontab_control("remove 0", EXIT_FAILURE,
+                       "error: not an ephemeral job\n");
+  test_crontab_control("remove 2.0", EXIT_SUCCESS, "ok\n");
+  test_crontab_control("stats", EXIT_SUCCESS, "crond_jobs 2\n");
+  test_crontab_control("remove 2.0", EXIT_FAILURE, "error: no such job\n");
+  test_crontab_control("run 2", EXIT_FAILURE, "error: no such job\n");
+
+  test_describe("reuse the slot of a removed ephemeral job");
+  test_crontab_control("add 0 0 0 1 1 * true", EXIT_SUCCESS, "ok 2.1\n");
+  test_crontab_control("pause 2.1", EXIT_SUCCESS, "ok\n");
+  test_crontab_control("list", EXIT_SUCCESS, "\n2.1 paused ");
+  test_crontab_control("remove 2.1", EXIT_SUCCESS, "ok\n");
+
+  test_describe("invalid ephemeral jobs");
+  test_crontab_control("add 0 invalid", EXIT_FAILURE, "error: invalid job\n");
+  test_crontab_control("add x", EXIT_FAILURE, "error: invalid ttl\n");
+  test_crontab_control("add 5", EXIT_FAILURE, "error: invalid ttl\n");
+  test_crontab_control("add", EXIT_FAILURE, "error: invalid ttl\n");
+
+  test_describe("ephemeral job expires after the TTL");
+  test_crontab_control("add 1 0 0 1 1 * true", EXIT_SUCCESS, "ok 2.2\n");
+  for(i = 0; i < 6; i++){
+    test_sleep_max_file();
+  }
+  test_crontab_control("remove 2.2", EXIT_FAILURE, "error: no such job\n");
+
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  remove(PATH_TMP_EPHEMERAL);
+  test_simple_file_verify_remove(true);
+
+  test_describe("persist the ephemeral jobs");
+  assert(mkdir(PATH_EPHEMERAL_DIR, 0700) == 0);
+  test_crond_ephemeral_write("/tmp/test-cron-ephemeral.d/5",
+                             "1\n0 0 1 1 * true\n");
+  test_crond_ephemeral_write("/tmp/test-cron-ephemeral.d/6",
+                             "0\ninvalid\n");
+  test_crond_ephemeral_write("/tmp/test-cron-ephemeral.d/x",
+                             "0\n0 0 1 1 * true\n");
+  pid = test_crond_fork_opt("-p", PATH_EPHEMERAL_DIR);
+  test_sleep_max_file();
+  assert(test_file_exists("/tmp/test-cron-ephemeral.d/5") == false);
+  test_crontab_control("stats", EXIT_SUCCESS, "crond_jobs 2\n");
+  test_crontab_control("add 0 0 0 1 1 * true", EXIT_SUCCESS, "ok 2.7\n");
+  assert(test_file_contains("/tmp/test-cron-ephemeral.d/7",
+                            "0\n0 0 1 1 * true\n"));
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+
+  test_describe("load the persisted ephemeral jobs on startup");
+  pid = test_crond_fork_opt("-p", PATH_EPHEMERAL_DIR);
+  test_sleep_max_file();
+  test_crontab_control("list", EXIT_SUCCESS, "0.7 active ");
+  test_crontab_control("add 0 0 0 1 1 * true", EXIT_SUCCESS, "ok 3.8\n");
+  test_crontab_control("remove 0.7", EXIT_SUCCESS, "ok\n");
+  assert(test_file_exists("/tmp/test-cron-ephemeral.d/7") == false);
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  test_simple_file_verify_remove(true);
+  assert(remove("/tmp/test-cron-ephemeral.d/6") == 0);
+  assert(remove("/tmp/test-cron-ephemeral.d/8") == 0);
+  assert(remove("/tmp/test-cron-ephemeral.d/x") == 0);
+  assert(rmdir(PATH_EPHEMERAL_DIR) == 0);
+
+  test_describe("ephemeral job directory does not exist");
+  pid = test_crond_fork_opt("-p", "/tmp/test-cron-noexist");
+  test_crond_wait(pid, EXIT_FAILURE);
+
+  g_test_seam_localtime_tm = NULL;
+}
+
+/**
+ * Test the at jobs queued through the control socket.
+ */
+static void
+test_crond_at(void){
+  const char *const PATH_TMP_AT = "/tmp/test-cron-at.txt";
+  char *path_at;
+  char *path_file;
+  struct tm tm;
+  time_t when;
+  char expect[100];
+  int i;
+  pid_t pid;
+  FILE *fp;
+
+  path_at = malloc(strlen(g_path_crontab) + 100);
+  assert(path_at);
+  path_file = malloc(strlen(g_path_crontab) + 100);
+  assert(path_file);
+  sprintf(path_at, "%s.at", g_path_crontab);
+  memset(&tm, 0, sizeof(tm));
+  tm.tm_year = 2999 - 1900;
+  tm.tm_mday = 1;
+  tm.tm_isdst = -1;
+  when = mktime(&tm);
+  assert(when > 0);
+
+  test_crontab_add("test/crontabs/control.txt", EXIT_SUCCESS);
+  test_crond_set_tm(59, 1, 1, 1, 1, 1);
+
+  test_describe("skip invalid at job spool files");
+  assert(mkdir(path_at, 0700) == 0);
+  sprintf(path_file, "%s/1.99", path_at);
+  fp = fopen(path_file, "w");
+  assert(fp);
+  assert(fclose(fp) == 0);
+  pid = test_crond_fork();
+  test_sleep_max_file();
+  assert(remove(path_file) == 0);
+
+  test_describe("run an at job once");
+  test_crontab_control("at 2000-01-01T00:00 touch /tmp/test-cron-at.txt",
+                       EXIT_SUCCESS,
+                       "ok 946");
+  for(i = 0; i < 6 && test_file_exists(PATH_TMP_AT) == false; i++){
+    test_sleep_max_file();
+  }
+  assert(remove(PATH_TMP_AT) == 0);
+  test_sleep_max_file();
+  test_sleep_max_file();
+  assert(test_file_exists(PATH_TMP_AT) == false);
+  test_crontab_control("stats", EXIT_SUCCESS, "crond_jobs 2\n");
+  test_crontab_control("stats", EXIT_SUCCESS, "crond_at_jobs_pending 0\n");
+
+  test_describe("queue an at job in the future");
+  sprintf(expect, "ok %ld.101\n", (long)when);
+  test_crontab_control("at 2999-01-01T00:00 true", EXIT_SUCCESS, expect);
+  sprintf(expect, "%ld.101 2999-01-01T00:00\n", (long)when);
+  test_crontab_control("atq", EXIT_SUCCESS, expect);
+  test_crontab_control("stats", EXIT_SUCCESS, "crond_at_jobs_pending 1\n");
+
+  test_describe("invalid at jobs");
+  test_crontab_control("at 2000-13-01T00:00 true",
+                       EXIT_FAILURE,
+                       "error: invalid time\n");
+  test_crontab_control("at 2027-02-31T10:00 true",
+                       EXIT_FAILURE,
+                       "error: invalid time\n");
+  test_crontab_control("at 2000-01-01T00:00",
+                       EXIT_FAILURE,
+                       "error: invalid time\n");
+  test_crontab_control("at", EXIT_FAILURE, "error: invalid time\n");
+  test_crontab_control("at 2000-01-01T00:00  ",
+                       EXIT_FAILURE,
+                       "error: invalid job\n");
+  test_crontab_control("atrm x", EXIT_FAILURE, "error: no such job\n");
+  test_crontab_control("atrm 1.1", EXIT_FAILURE, "error: no such job\n");
+
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  test_simple_file_verify_remove(true);
+
+  test_describe("load the pending at jobs on startup");
+  pid = test_crond_fork();
+  test_sleep_max_file();
+  test_crontab_control("atq", EXIT_SUCCESS, expect);
+
+  test_describe("remove a pending at job");
+  sprintf(expect, "atrm %ld.101", (long)when);
+  test_crontab_control(expect, EXIT_SUCCESS, "ok\n");
+  test_crontab_control(expect, EXIT_FAILURE, "error: no such job\n");
+  test_crontab_control("stats", EXIT_SUCCESS, "crond_at_jobs_pending 0\n");
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  test_simple_file_verify_remove(true);
+  assert(rmdir(path_at) == 0);
+
+  free(path_at);
+  free(path_file);
+  g_test_seam_localtime_tm = NULL;
+}
+
+/**
+ * Set the last run time of every job in the job state file.
+ *
+ * @param[in] path_state Path to the job state file.
+ * @param[in] last_run   New last run time.
+ */
+static void
+test_crond_state_set(const char *const path_state,
+                     const time_t last_run){
+  FILE *fp;
+  unsigned long hash;
+  long old_last_run;
+
+  fp = fopen(path_state, "r");
+  assert(fp);
+  assert(fscanf(fp, "%lx %ld", &hash, &old_last_run) == 2);
+  assert(fclose(fp) == 0);
+  fp = fopen(path_state, "w");
+  assert(fp);
+  assert(fprintf(fp, "%08lx %ld\n", hash, (long)last_run) > 0);
+  assert(fclose(fp) == 0);
+}
+
+/**
+ * Get the last run time of the first job in the job state file.
+ *
+ * @param[in] path_state Path to the job state file.
+ * @return               Last run time.
+ */
+static time_t
+test_crond_state_get(const char *const path_state){
+  FILE *fp;
+  unsigned long hash;
+  long last_run;
+
+  fp = fopen(path_state, "r");
+  assert(fp);
+  assert(fscanf(fp, "%lx %ld", &hash, &last_run) == 2);
+  assert(fclose(fp) == 0);
+  return (time_t)last_run;
+}
+
+/**
+ * Test the catch-up of jobs that missed a scheduled run.
+ */
+static void
+test_crond_catchup(void){
+  const char *const PATH_TMP_CATCHUP = "/tmp/test-cron-catchup.txt";
+  const time_t DAY_SEC = 24 * 60 * 60;
+  char *path_state;
+  time_t now;
+  pid_t pid;
+  int i;
+
+  path_state = malloc(strlen(g_path_crontab) + 100);
+  assert(path_state);
+  sprintf(path_state, "%s.state", g_path_crontab);
+  remove(path_state);
+  remove(PATH_TMP_CATCHUP);
+  test_crontab_add("test/crontabs/catchup.txt", EXIT_SUCCESS);
+  test_crond_set_tm(0, 1, 1, 1, 1, 1);
+
+  test_describe("invalid catch-up lookback");
+  pid = test_crond_fork_opt("-c", "x");
+  test_crond_wait(pid, EXIT_FAILURE);
+  assert(test_file_exists(path_state) == false);
+
+  test_describe("record new jobs in the state file without catching up");
+  now = time(NULL);
+  pid = test_crond_fork_opt("-c", "24");
+  test_sleep_max_file();
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  assert(test_file_exists(PATH_TMP_CATCHUP) == false);
+  assert(test_crond_state_get(path_state) >= now);
+
+  test_describe("skip missed runs older than the lookback");
+  test_crond_state_set(path_state, now - 400 * DAY_SEC);
+  pid = test_crond_fork_opt("-c", "1");
+  test_sleep_max_file();
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  assert(test_file_exists(PATH_TMP_CATCHUP) == false);
+  assert(test_crond_state_get(path_state) == now - 400 * DAY_SEC);
+
+  test_describe("catch up a missed run within the lookback");
+  pid = test_crond_fork_opt("-c", "19200");
+  for(i = 0; i < 6 && test_file_exists(PATH_TMP_CATCHUP) == false; i++){
+    test_sleep_max_file();
+  }
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  assert(remove(PATH_TMP_CATCHUP) == 0);
+  assert(test_crond_state_get(path_state) >= now);
+
+  test_describe("do not catch up the same run twice");
+  pid = test_crond_fork_opt("-c", "19200");
+  test_sleep_max_file();
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  assert(test_file_exists(PATH_TMP_CATCHUP) == false);
+
+  assert(remove(path_state) == 0);
+  free(path_state);
+  g_test_seam_localtime_tm = NULL;
+}
+
+/**
+ * Test draining and handing off the running jobs when crond exits.
+ */
+static void
+test_crond_drain(void){
+  const char *const PATH_TMP_DRAIN = "/tmp/test-cron-drain.txt";
+  char *path_handoff;
+  FILE *fp;
+  long pid_jobmon;
+  unsigned long hash;
+  long start_sec;
+  unsigned long proc_start;
+  pid_t pid;
+  int i;
+
+  path_handoff = malloc(strlen(g_path_crontab) + 100);
+  assert(path_handoff);
+  sprintf(path_handoff, "%s.running", g_path_crontab);
+  remove(path_handoff);
+  remove(PATH_TMP_DRAIN);
+  test_crontab_add("test/crontabs/drain.txt", EXIT_SUCCESS);
+  test_crond_set_tm(0, 1, 1, 1, 1, 1);
+
+  test_describe("invalid drain time");
+  pid = test_crond_fork_opt("-g", "-1");
+  test_crond_wait(pid, EXIT_FAILURE);
+
+  test_describe("wait for the running jobs before exiting");
+  pid = test_crond_fork_opt("-g", "10");
+  test_sleep_max_file();
+  test_crontab_control("run 0", EXIT_SUCCESS, "ok\n");
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  assert(remove(PATH_TMP_DRAIN) == 0);
+  assert(test_file_exists(path_handoff) == false);
+
+  test_describe("hand off the running jobs to the next crond");
+  /* Reap the orphaned job monitor here instead of relying on init. */
+  assert(prctl(PR_SET_CHILD_SUBREAPER, 1) == 0);
+  pid = test_crond_fork_opt("-g", "0");
+  test_sleep_max_file();
+  test_crontab_control("run 0", EXIT_SUCCESS, "ok\n");
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  assert(test_file_exists(PATH_TMP_DRAIN) == false);
+  fp = fopen(path_handoff, "r");
+  assert(fp);
+  assert(fscanf(fp,
+                "%ld %lx %ld %lu",
+                &pid_jobmon,
+                &hash,
+                &start_sec,
+                &proc_start) == 4);
+  assert(proc_start > 0);
+  assert(fclose(fp) == 0);
+  pid = test_crond_fork_opt("-g", "0");
+  test_sleep_max_file();
+  assert(test_file_exists(path_handoff) == false);
+  test_crontab_control("list", EXIT_SUCCESS, "0 active 1 ");
+
+  test_describe("stop tracking the adopted job when it exits");
+  assert(waitpid((pid_t)pid_jobmon, NULL, 0) == (pid_t)pid_jobmon);
+  assert(prctl(PR_SET_CHILD_SUBREAPER, 0) == 0);
+  assert(remove(PATH_TMP_DRAIN) == 0);
+  for(i = 0; i < 3; i++){
+    test_sleep_max_file();
+  }
+  test_crontab_control("list", EXIT_SUCCESS, "0 active 0 ");
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  assert(test_file_exists(path_handoff) == false);
+
+  test_describe("do not adopt a process that reused the job monitor ID");
+  fp = fopen(path_handoff, "w");
+  assert(fp);
+  assert(fprintf(fp,
+                 "%ld %08lx %ld %lu\n",
+                 (long)getpid(),
+                 hash,
+                 start_sec,
+                 proc_start) > 0);
+  assert(fclose(fp) == 0);
+  pid = test_crond_fork_opt("-g", "0");
+  test_sleep_max_file();
+  assert(test_file_exists(path_handoff) == false);
+  test_crontab_control("list", EXIT_SUCCESS, "0 active 0 ");
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+
+  free(path_handoff);
+  g_test_seam_localtime_tm = NULL;
+}
+
+/**
+ * Test restarting crond after it got killed while a job was running.
+ */
+static void
+test_crond_kill(void){
+  const char *const PATH_TMP_DRAIN = "/tmp/test-cron-drain.txt";
+  pid_t pid;
+
+  remove(PATH_TMP_DRAIN);
+  test_crontab_add("test/crontabs/drain.txt", EXIT_SUCCESS);
+  test_crond_set_tm(0, 1, 1, 1, 1, 1);
+
+  test_describe("restart right after crond got killed while a job runs");
+  /* Reap the orphaned job monitor here instead of relying on init. */
+  assert(prctl(PR_SET_CHILD_SUBREAPER, 1) == 0);
+  pid = test_crond_fork();
+  test_sleep_max_file();
+  test_crontab_control("run 0", EXIT_SUCCESS, "ok\n");
+  assert(kill(pid, SIGKILL) == 0);
+  assert(waitpid(pid, NULL, 0) == pid);
+  pid = test_crond_fork();
+  test_sleep_max_file();
+  assert(test_file_exists(PATH_TMP_DRAIN) == false);
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  while(waitpid(-1, NULL, 0) > 0){
+    /* Reap the job monitor of the killed crond. */
+  }
+  assert(prctl(PR_SET_CHILD_SUBREAPER, 0) == 0);
+  assert(remove(PATH_TMP_DRAIN) == 0);
+  g_test_seam_localtime_tm = NULL;
+}
+
+/**
+ * Fork a new crond process that executes @p path on SIGUSR2.
+ *
+ * @param[in] path Program path passed to crond in argv[0].
+ * @return         Child process ID.
+ */
+static pid_t
+test_crond_fork_reexec(const char *const path){
+  pid_t pid;
+  int exit_status;
+
+  pid = fork();
+  assert(pid >= 0);
+  if(pid == 0){
+    g_argc = 2;
+    strcpy(g_argv[0], path);
+    strcpy(g_argv[1], "-v");
+    /* The argument list passed to execvp must end with NULL. */
+    g_argv[g_argc] = NULL;
+    exit_status = crond_main(g_argc, g_argv);
+    exit(exit_status);
+  }
+  return pid;
+}
+
+/**
+ * Test executing crond again on SIGUSR2.
+ */
+static void
+test_crond_reexec(void){
+  const char *const PATH_TMP_REEXEC = "/tmp/test-cron-reexec.txt";
+  char *path_lock_file;
+  pid_t pid;
+  int i;
+
+  path_lock_file = crond_get_path_lock_file(g_path_crontab);
+  assert(path_lock_file);
+  remove(PATH_TMP_REEXEC);
+  test_crontab_add("test/crontabs/reexec.txt", EXIT_SUCCESS);
+  test_crond_set_tm(0, 1, 1, 1, 1, 1);
+
+  test_describe("keep running if the exec fails");
+  pid = test_crond_fork_reexec("/nonexistent/crond");
+  test_sleep_max_file();
+  assert(kill(pid, SIGUSR2) == 0);
+  test_sleep_max_file();
+  test_crontab_control("list", EXIT_SUCCESS, "0 active 0 ");
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  assert(test_file_exists(path_lock_file) == false);
+
+  test_describe("keep the running jobs and control socket across the exec");
+  pid = test_crond_fork_reexec("build/debug/crond");
+  test_sleep_max_file();
+  test_crontab_control("run 0", EXIT_SUCCESS, "ok\n");
+  assert(kill(pid, SIGUSR2) == 0);
+  test_sleep_max_file();
+  assert(test_file_exists(path_lock_file));
+  test_crontab_control("list", EXIT_SUCCESS, "0 active 1 ");
+  for(i = 0; i < 4; i++){
+    test_sleep_max_file();
+  }
+  assert(remove(PATH_TMP_REEXEC) == 0);
+
+  test_describe("reap the inherited job monitor");
+  test_crontab_control("list", EXIT_SUCCESS, "0 active 0 ");
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  assert(test_file_exists(path_lock_file) == false);
+
+  free(path_lock_file);
+  g_test_seam_localtime_tm = NULL;
+}
+
+/**
+ * Test system mode and the user job limit.
+ */
+static void
+test_crond_system(void){
+  const char *const PATH_TMP_SYSTEM_0 = "/tmp/test-cron-system-0.txt";
+  const char *const PATH_TMP_SYSTEM_1 = "/tmp/test-cron-system-1.txt";
+  const struct passwd *pwd;
+  char home[1024];
+  struct crond crond;
+  pid_t pid;
+  int i;
+
+  pwd = getpwuid(geteuid());
+  assert(pwd);
+  sprintf(home, "%s\n", pwd->pw_dir);
+  remove(PATH_TMP_SYSTEM_0);
+  remove(PATH_TMP_SYSTEM_1);
+  test_crontab_add("test/crontabs/system.txt", EXIT_SUCCESS);
+  test_crond_set_tm(0, 1, 1, 1, 1, 1);
+
+  test_describe("invalid user job limit");
+  pid = test_crond_fork_opt("-u", "x");
+  test_crond_wait(pid, EXIT_FAILURE);
+
+  test_describe("run the jobs of each user in the home directory");
+  pid = test_crond_fork_opt("-s", NULL);
+  test_sleep_max_file();
+  test_crontab_control("list", EXIT_SUCCESS, "1 active 0 ");
+  test_crontab_control("run 0", EXIT_SUCCESS, "ok\n");
+  for(i = 0; i < 4; i++){
+    test_sleep_max_file();
+  }
+  assert(test_file_contains(PATH_TMP_SYSTEM_0, home));
+  assert(remove(PATH_TMP_SYSTEM_0) == 0);
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+
+  test_describe("do not start more jobs than the user job limit");
+  pid = test_crond_fork_opt("-u", "1");
+  test_sleep_max_file();
+  test_crontab_control("run 0", EXIT_SUCCESS, "ok\n");
+  test_crontab_control("run 1", EXIT_SUCCESS, "ok\n");
+  test_crontab_control("list", EXIT_SUCCESS, "1 active 0 ");
+  for(i = 0; i < 4; i++){
+    test_sleep_max_file();
+  }
+  assert(remove(PATH_TMP_SYSTEM_0) == 0);
+  assert(test_file_exists(PATH_TMP_SYSTEM_1) == false);
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+
+  test_describe("only run jobs without a user crontab as the crond user");
+  memset(&crond, 0, sizeof(crond));
+  crond.flags = CROND_FLAG_SYSTEM;
+  assert(crond_user_switch(&crond, geteuid()) == 0);
+  assert(crond_user_switch(&crond, geteuid() + 1) == -1);
+
+  test_describe("do not block on a crontab replaced by a FIFO");
+  assert(remove(g_path_crontab) == 0);
+  assert(mkfifo(g_path_crontab, S_IRUSR | S_IWUSR) == 0);
+  test_crond_fork_main(EXIT_SUCCESS);
+  assert(remove(g_path_crontab) == 0);
+
+  g_test_seam_localtime_tm = NULL;
+}
+
+/**
+ * Replace the contents of a file in the crontab drop-in directory.
+ *
+ * @param[in] path_dropin Path to the drop-in directory.
+ * @param[in] name        File name in the drop-in directory.
+ * @param[in] contents    Crontab lines to write to the file.
+ */
+static void
+test_crond_dropin_write(const char *const path_dropin,
+                        const char *const name,
+                        const char *const contents){
+  char path[1024];
+  FILE *fp;
+
+  sprintf(path, "%s/%s", path_dropin, name);
+  fp = fopen(path, "w");
+  assert(fp);
+  assert(fputs(contents, fp) >= 0);
+  assert(fclose(fp) == 0);
+}
+
+/**
+ * Test the crontab drop-in directory and the per-file reload.
+ */
+static void
+test_crond_dropin(void){
+  const char *const PATH_TMP_DROPIN = "/tmp/test-cron-dropin.txt";
+  char path_dropin[512];
+  char path[1024];
+  pid_t pid;
+  int i;
+
+  sprintf(path_dropin, "%s.d", g_path_crontab);
+  remove(PATH_TMP_DROPIN);
+  assert(mkdir(path_dropin, 0700) == 0 || errno == EEXIST);
+  test_crontab_add("test/crontabs/dropin.txt", EXIT_SUCCESS);
+  test_crond_dropin_write(path_dropin, "backup", "0 0 1 1 * echo backup\n");
+  test_crond_dropin_write(path_dropin, ".hidden", "0 0 1 1 * echo hidden\n");
+  test_crond_dropin_write(path_dropin, "backup~", "0 0 1 1 * echo old\n");
+  test_crond_set_tm(0, 1, 1, 1, 1, 1);
+
+  test_describe("load the files in the drop-in directory");
+  pid = test_crond_fork();
+  test_sleep_max_file();
+  test_crontab_control("stats", EXIT_SUCCESS, "crond_jobs 2\n");
+  test_crontab_control("stats",
+                       EXIT_SUCCESS,
+                       "{job=\"1\",source=\"backup\",command=\"echo backup\"}");
+  test_crontab_control("run 0", EXIT_SUCCESS, "ok\n");
+  for(i = 0; i < 4 && test_file_exists(PATH_TMP_DROPIN) == false; i++){
+    test_sleep_max_file();
+  }
+  assert(remove(PATH_TMP_DROPIN) == 0);
+
+  test_describe("only reload the drop-in file that changed");
+  test_crond_dropin_write(path_dropin,
+                          "backup",
+                          "0 0 1 1 * echo backup 2\n"
+                          "0 0 1 1 * echo backup 3\n");
+  test_sleep_max_file();
+  test_crontab_control("stats", EXIT_SUCCESS, "crond_jobs 3\n");
+  test_crontab_control("stats",
+                       EXIT_SUCCESS,
+                       "crond_job_runs_total{job=\"0\",source=\"crontab\","
+                       "command=\"sleep 1 && touch /tmp/test-cron-dropin.txt\"}"
+                       " 1\n");
+  test_crontab_control("stats",
+                       EXIT_SUCCESS,
+                       "source=\"backup\",command=\"echo backup 3\"");
+
+  test_describe("unload a removed drop-in file");
+  sprintf(path, "%s/backup", path_dropin);
+  assert(remove(path) == 0);
+  test_sleep_max_file();
+  test_crontab_control("stats", EXIT_SUCCESS, "crond_jobs 1\n");
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+
+  sprintf(path, "%s/.hidden", path_dropin);
+  assert(remove(path) == 0);
+  sprintf(path, "%s/backup~", path_dropin);
+  assert(remove(path) == 0);
+  assert(rmdir(path_dropin) == 0);
+  g_test_seam_localtime_tm = NULL;
+}
+
+/**
+ * Test that the jobs due in the same minute get started one owner at a
+ * time.
+ */
+static void
+test_crond_fairshare(void){
+  const char *const PATH_TMP_FAIRSHARE_0 = "/tmp/test-cron-fairshare-0.txt";
+  const char *const PATH_TMP_FAIRSHARE_1 = "/tmp/test-cron-fairshare-1.txt";
+  const char *const PATH_TMP_FAIRSHARE_2 = "/tmp/test-cron-fairshare-2.txt";
+  char path_dropin[512];
+  char path[1024];
+  pid_t pid;
+  int i;
+
+  sprintf(path_dropin, "%s.d", g_path_crontab);
+  remove(PATH_TMP_FAIRSHARE_0);
+  remove(PATH_TMP_FAIRSHARE_1);
+  remove(PATH_TMP_FAIRSHARE_2);
+  assert(mkdir(path_dropin, 0700) == 0 || errno == EEXIST);
+  test_crontab_add("test/crontabs/fairshare.txt", EXIT_SUCCESS);
+  test_crond_dropin_write(path_dropin,
+                          "other",
+                          "* * * * * touch /tmp/test-cron-fairshare-2.txt\n");
+  test_crond_set_tm(0, 1, 1, 1, 1, 1);
+
+  test_describe("start the first job of each file before the second job");
+  pid = test_crond_fork_opt("-u", "2");
+  for(i = 0; i < 4 && test_file_exists(PATH_TMP_FAIRSHARE_2) == false; i++){
+    test_sleep_max_file();
+  }
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  assert(remove(PATH_TMP_FAIRSHARE_0) == 0);
+  assert(test_file_exists(PATH_TMP_FAIRSHARE_1) == false);
+  assert(remove(PATH_TMP_FAIRSHARE_2) == 0);
+
+  sprintf(path, "%s/other", path_dropin);
+  assert(remove(path) == 0);
+  assert(rmdir(path_dropin) == 0);
+  g_test_seam_localtime_tm = NULL;
+}
+
+/**
+ * Test the CRON_TZ lines that set the time zone of the following jobs.
+ */
+static void
+test_crond_zone(void){
+  const char *const PATH_TMP_ZONE_CRONTAB = "/tmp/test-cron-zone.txt";
+  const char *const PATH_TMP_ZONE_0 = "/tmp/test-cron-zone-0.txt";
+  const char *const PATH_TMP_ZONE_1 = "/tmp/test-cron-zone-1.txt";
+  const char *const PATH_TMP_ZONE_2 = "/tmp/test-cron-zone-2.txt";
+  time_t now;
+  struct tm tm_zone;
+  FILE *fp;
+  pid_t pid;
+  int i;
+
+  remove(PATH_TMP_ZONE_0);
+  remove(PATH_TMP_ZONE_1);
+  remove(PATH_TMP_ZONE_2);
+
+  /* Avoid the job minute passing before crond starts. */
+  now = time(NULL);
+  if(now % 60 >= 50){
+    sleep((unsigned int)(60 - now % 60));
+    now = time(NULL);
+  }
+
+  /* Etc/GMT-14 is 14 hours ahead of UTC. */
+  now += 14 * 60 * 60;
+  assert(gmtime_r(&now, &tm_zone));
+  fp = fopen(PATH_TMP_ZONE_CRONTAB, "w");
+  assert(fp);
+  assert(fprintf(fp,
+                 "CRON_TZ=Etc/GMT-14\n"
+                 "%d %d * * * echo $TZ > %s\n"
+                 "CRON_TZ=Invalid/Zone\n"
+                 "* * * * * touch %s\n"
+                 "CRON_TZ=\n"
+                 "%d %d * * * touch %s\n",
+                 tm_zone.tm_min,
+                 tm_zone.tm_hour,
+                 PATH_TMP_ZONE_0,
+                 PATH_TMP_ZONE_1,
+                 tm_zone.tm_min,
+                 tm_zone.tm_hour,
+                 PATH_TMP_ZONE_2) > 0);
+  assert(fclose(fp) == 0);
+  test_crontab_add(PATH_TMP_ZONE_CRONTAB, EXIT_SUCCESS);
+  test_crond_set_tm(0, (tm_zone.tm_min + 1) % 60, 1, 1, 1, 1);
+
+  test_describe("run the jobs in the time zone set by CRON_TZ");
+  pid = test_crond_fork();
+  for(i = 0; i < 4 && test_file_exists(PATH_TMP_ZONE_0) == false; i++){
+    test_sleep_max_file();
+  }
+  test_crontab_control("stats", EXIT_SUCCESS, "crond_jobs 2\n");
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  assert(test_file_contains(PATH_TMP_ZONE_0, "Etc/GMT-14\n"));
+  assert(remove(PATH_TMP_ZONE_0) == 0);
+  assert(test_file_exists(PATH_TMP_ZONE_1) == false);
+  assert(test_file_exists(PATH_TMP_ZONE_2) == false);
+
+  assert(remove(PATH_TMP_ZONE_CRONTAB) == 0);
+  g_test_seam_localtime_tm = NULL;
+}
+
+/**
+ * Start crond right after a daylight saving time change in
+ * America/New_York and check which jobs from dst.txt run.
+ *
+ * @param[in] at             Time of the change.
+ * @param[in] policy         Argument of the -d option, or NULL for the
+ *                           default policy.
+ * @param[in] expect_gap     Expect the job in the skipped hour to run.
+ * @param[in] expect_overlap Expect the job in the repeated hour to run.
+ */
+static void
+test_crond_dst_run(const time_t at,
+                   const char *const policy,
+                   const bool expect_gap,
+                   const bool expect_overlap){
+  const char *const PATH_TMP_DST_GAP = "/tmp/test-cron-dst-gap.txt";
+  const char *const PATH_TMP_DST_OVERLAP = "/tmp/test-cron-dst-overlap.txt";
+  const char *const PATH_TMP_DST_MINUTE = "/tmp/test-cron-dst-minute.txt";
+  const char *const PATH_TMP_DST_HOURLY = "/tmp/test-cron-dst-hourly.txt";
+  pid_t pid;
+  int i;
+
+  remove(PATH_TMP_DST_GAP);
+  remove(PATH_TMP_DST_OVERLAP);
+  remove(PATH_TMP_DST_MINUTE);
+  remove(PATH_TMP_DST_HOURLY);
+  g_test_seam_clock_realtime_offset = at + 1 - time(NULL);
+  if(policy){
+    pid = test_crond_fork_opt("-d", policy);
+  }
+  else{
+    pid = test_crond_fork();
+  }
+  for(i = 0; i < 4; i++){
+    test_sleep_max_file();
+  }
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  g_test_seam_clock_realtime_offset = 0;
+  assert(test_file_exists(PATH_TMP_DST_GAP) == expect_gap);
+  assert(test_file_exists(PATH_TMP_DST_OVERLAP) == expect_overlap);
+  /* The job that runs every minute keeps running with every policy. */
+  assert(test_file_exists(PATH_TMP_DST_MINUTE));
+  /* The hourly job does not catch up on the skipped 02:30. */
+  assert(test_file_exists(PATH_TMP_DST_HOURLY) == false);
+  remove(PATH_TMP_DST_GAP);
+  remove(PATH_TMP_DST_OVERLAP);
+  remove(PATH_TMP_DST_MINUTE);
+}
+
+/**
+ * Test the jobs scheduled around daylight saving time changes.
+ */
+static void
+test_crond_dst(void){
+  /* 2024-03-10T02:00 EST, clocks go forward to 03:00 EDT. */
+  const time_t AT_GAP = 1710054000;
+  /* 2024-11-03T02:00 EDT, clocks go back to 01:00 EST. */
+  const time_t AT_OVERLAP = 1730613600;
+  char *tz_orig;
+  pid_t pid;
+
+  tz_orig = getenv("TZ");
+  if(tz_orig){
+    tz_orig = strdup(tz_orig);
+    assert(tz_orig);
+  }
+  assert(setenv("TZ", "America/New_York", 1) == 0);
+  test_crontab_add("test/crontabs/dst.txt", EXIT_SUCCESS);
+  g_test_seam_localtime_tm = NULL;
+
+  test_describe("invalid DST policy");
+  pid = test_crond_fork_opt("-d", "run,never");
+  test_crond_wait(pid, EXIT_FAILURE);
+
+  test_describe("run the jobs of the skipped hour after the clocks go forward");
+  test_crond_dst_run(AT_GAP, NULL, true, false);
+
+  test_describe("skip the jobs of the skipped hour");
+  test_crond_dst_run(AT_GAP, "skip,once", false, false);
+
+  test_describe("do not run the jobs of the repeated hour twice");
+  test_crond_dst_run(AT_OVERLAP, NULL, false, false);
+
+  test_describe("run the jobs of the repeated hour twice");
+  test_crond_dst_run(AT_OVERLAP, "run,twice", false, true);
+
+  if(tz_orig){
+    assert(setenv("TZ", tz_orig, 1) == 0);
+  }
+  else{
+    assert(unsetenv("TZ") == 0);
+  }
+  free(tz_orig);
+}
+
+/**
+ * Test replaying the jobs of a time range on a virtual clock.
+ */
+static void
+test_crond_warp(void){
+  const char *const PATH_TMP_WARP = "/tmp/test-cron-warp.txt";
+  char expect[64];
+  char *tz_orig;
+  pid_t pid;
+  int i;
+
+  tz_orig = getenv("TZ");
+  if(tz_orig){
+    tz_orig = strdup(tz_orig);
+    assert(tz_orig);
+  }
+  assert(setenv("TZ", "UTC", 1) == 0);
+  g_test_seam_localtime_tm = NULL;
+
+  test_describe("invalid virtual clock time range");
+  pid = test_crond_fork_opt("-w", "2024-01-01T00:00");
+  test_crond_wait(pid, EXIT_FAILURE);
+  pid = test_crond_fork_opt("-w", "2024-01-01T00:00,2023-12-31T23:59");
+  test_crond_wait(pid, EXIT_FAILURE);
+  pid = test_crond_fork_opt("-w", "2024-01-01T00:00,2024-01-01T24:00");
+  test_crond_wait(pid, EXIT_FAILURE);
+  pid = test_crond_fork_opt("-w", "2024-01-01T00:00,2024-01-01T23:59x");
+  test_crond_wait(pid, EXIT_FAILURE);
+  pid = test_crond_fork_opt("-w", "2024-02-30T00:00,2024-03-01T23:59");
+  test_crond_wait(pid, EXIT_FAILURE);
+
+  test_describe("replay a day of hourly jobs on the virtual clock");
+  remove(PATH_TMP_WARP);
+  test_crontab_add("test/crontabs/warp.txt", EXIT_SUCCESS);
+  pid = test_crond_fork_opt("-w", "2024-01-01T00:00,2024-01-01T23:59");
+  test_crond_wait(pid, EXIT_SUCCESS);
+  strcpy(expect, "");
+  for(i = 0; i < 24; i++){
+    strcat(expect, "x\n");
+  }
+  assert(test_file_contains(PATH_TMP_WARP, expect));
+  strcat(expect, "x\n");
+  assert(test_file_contains(PATH_TMP_WARP, expect) == false);
+  remove(PATH_TMP_WARP);
+
+  test_describe("replay the clocks going forward on the virtual clock");
+  assert(setenv("TZ", "America/New_York", 1) == 0);
+  remove("/tmp/test-cron-dst-gap.txt");
+  remove("/tmp/test-cron-dst-hourly.txt");
+  test_crontab_add("test/crontabs/dst.txt", EXIT_SUCCESS);
+  pid = test_crond_fork_opt("-w", "2024-03-10T00:00,2024-03-10T03:59");
+  test_crond_wait(pid, EXIT_SUCCESS);
+  assert(test_file_exists("/tmp/test-cron-dst-gap.txt"));
+  /* The hourly job runs at 00:30, 01:30, and 03:30 only. */
+  assert(test_file_contains("/tmp/test-cron-dst-hourly.txt", "x\nx\nx\n"));
+  assert(test_file_contains("/tmp/test-cron-dst-hourly.txt",
+                            "x\nx\nx\nx\n") == false);
+  remove("/tmp/test-cron-dst-gap.txt");
+  remove("/tmp/test-cron-dst-overlap.txt");
+  remove("/tmp/test-cron-dst-minute.txt");
+  remove("/tmp/test-cron-dst-hourly.txt");
+
+  if(tz_orig){
+    assert(setenv("TZ", tz_orig, 1) == 0);
+  }
+  else{
+    assert(unsetenv("TZ") == 0);
+  }
+  free(tz_orig);
+}
+
+/**
+ * Run a crond process with -n and -w and wait for it to exit.
+ *
+ * The process gets forked so that it does not reap the other crond
+ * processes started by the test.
+ *
+ * @param[in] path_log           Dry run log passed to -n.
+ * @param[in] range              Time range passed to -w.
+ * @param[in] path_metrics       Metrics file passed to -m along with -c
+ *                               and -g, or NULL to leave those out.
+ * @param[in] expect_exit_status Expected exit code from @ref crond_main.
+ */
+static void
+test_crond_dry_run_main(const char *const path_log,
+                        const char *const range,
+                        const char *const path_metrics,
+                        const int expect_exit_status){
+  pid_t pid;
+
+  pid = fork();
+  assert(pid >= 0);
+  if(pid == 0){
+    g_argc = 5;
+    strcpy(g_argv[0], "crond");
+    strcpy(g_argv[1], "-n");
+    strcpy(g_argv[2], path_log);
+    strcpy(g_argv[3], "-w");
+    strcpy(g_argv[4], range);
+    if(path_metrics){
+      g_argc = 11;
+      strcpy(g_argv[5], "-c");
+      strcpy(g_argv[6], "1");
+      strcpy(g_argv[7], "-g");
+      strcpy(g_argv[8], "1");
+      strcpy(g_argv[9], "-m");
+      strcpy(g_argv[10], path_metrics);
+    }
+    exit(crond_main(g_argc, g_argv));
+  }
+  test_crond_wait(pid, expect_exit_status);
+}
+
+/**
+ * Test recording the jobs instead of running them.
+ */
+static void
+test_crond_dry_run(void){
+  const char *const PATH_TMP_LOG = "/tmp/test-cron-dry-run.txt";
+  const char *const RANGE = "2024-01-01T00:00,2024-01-01T02:59";
+  const char *const PATH_TMP_METRICS = "/tmp/test-cron-dry-run.prom";
+  char *tz_orig;
+  char *path_lock_file;
+  char *path_state;
+  char *path_handoff;
+  FILE *fp;
+  struct stat sb;
+  char pid_str[32];
+  pid_t pid;
+
+  tz_orig = getenv("TZ");
+  if(tz_orig){
+    tz_orig = strdup(tz_orig);
+    assert(tz_orig);
+  }
+  assert(setenv("TZ", "UTC", 1) == 0);
+  g_test_seam_localtime_tm = NULL;
+  remove(PATH_TMP_LOG);
+  remove("/tmp/test-cron-warp.txt");
+  test_crontab_add("test/crontabs/warp.txt", EXIT_SUCCESS);
+
+  test_describe("fail to open the dry run log");
+  g_test_seam_err_ctr_fopen = 0;
+  test_crond_dry_run_main(PATH_TMP_LOG, RANGE, NULL, EXIT_FAILURE);
+  g_test_seam_err_ctr_fopen = -1;
+
+  test_describe("fail to write the dry run log");
+  g_test_seam_err_ctr_ferror = 1;
+  test_crond_dry_run_main(PATH_TMP_LOG, RANGE, NULL, EXIT_FAILURE);
+  g_test_seam_err_ctr_ferror = -1;
+  remove(PATH_TMP_LOG);
+
+  test_describe("record the jobs next to a running crond");
+  pid = test_crond_fork();
+  test_sleep_max_file();
+  test_crond_dry_run_main(PATH_TMP_LOG, RANGE, NULL, EXIT_SUCCESS);
+  assert(test_file_contains(PATH_TMP_LOG,
+                            "1704067200 0 echo x >> /tmp/test-cron-warp.txt\n"
+                            "1704070800 0 echo x >> /tmp/test-cron-warp.txt\n"
+                            "1704074400 0 echo x >> /tmp/test-cron-warp.txt"
+                            "\n"));
+  assert(test_file_exists("/tmp/test-cron-warp.txt") == false);
+  path_lock_file = crond_get_path_lock_file(g_path_crontab);
+  assert(path_lock_file);
+  sprintf(pid_str, "%ld\n", (long)pid);
+  assert(test_file_contains(path_lock_file, pid_str));
+  free(path_lock_file);
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  remove(PATH_TMP_LOG);
+
+  test_describe("leave the state, handoff, and metrics files alone");
+  path_state = malloc(strlen(g_path_crontab) + 100);
+  assert(path_state);
+  sprintf(path_state, "%s.state", g_path_crontab);
+  path_handoff = malloc(strlen(g_path_crontab) + 100);
+  assert(path_handoff);
+  sprintf(path_handoff, "%s.running", g_path_crontab);
+  fp = fopen(path_state, "w");
+  assert(fp);
+  assert(fputs("00000000 0\n", fp) >= 0);
+  assert(fclose(fp) == 0);
+  fp = fopen(path_handoff, "w");
+  assert(fp);
+  assert(fputs("1 0 0 0\n", fp) >= 0);
+  assert(fclose(fp) == 0);
+  remove(PATH_TMP_METRICS);
+  test_crond_dry_run_main(PATH_TMP_LOG, RANGE, PATH_TMP_METRICS, EXIT_SUCCESS);
+  assert(stat(path_state, &sb) == 0 && sb.st_size == 11);
+  assert(test_file_contains(path_state, "00000000 0\n"));
+  assert(test_file_contains(path_handoff, "1 0 0 0\n"));
+  assert(test_file_exists(PATH_TMP_METRICS) == false);
+  assert(test_file_contains(PATH_TMP_LOG,
+                            "1704067200 0 echo x >> /tmp/test-cron-warp.txt"
+                            "\n"));
+  assert(remove(path_state) == 0);
+  assert(remove(path_handoff) == 0);
+  free(path_state);
+  free(path_handoff);
+  remove(PATH_TMP_LOG);
+
+  if(tz_orig){
+    assert(setenv("TZ", tz_orig, 1) == 0);
+  }
+  else{
+    assert(unsetenv("TZ") == 0);
+  }
+  free(tz_orig);
+}
+
+/**
+ * Run all test cases for crond.
+ */
+static void
+test_crond_all(void){
+  int i;
+  pid_t pid;
+  char *path_lock_file;
+  char pid_str[32];
+
+  test_crond_remove_lock_file();
+  test_crontab_remove(EXIT_SUCCESS);
+
+  test_describe("invalid argument");
+  g_argc = 2;
+  strcpy(g_argv[0], "crond");
+  strcpy(g_argv[1], "-a");
+  test_crond_main(EXIT_FAILURE);
+  strcpy(g_argv[1], "-v");
+
+  g_test_seam_err_ctr_sigemptyset = 0;
+  test_crond_main(EXIT_FAILURE);
+  g_test_seam_err_ctr_sigemptyset = -1;
+  for(i = 0; i < 3; i++){
+    g_test_seam_err_ctr_sigaction = i;
+    test_crond_main(EXIT_FAILURE);
+    g_test_seam_err_ctr_sigaction = -1;
+  }
+
+  for(i = 0; i < 2; i++){
+    g_test_seam_err_ctr_si_add_size_t = i;
+    test_crond_main(EXIT_FAILURE);
+    g_test_seam_err_ctr_si_add_size_t = -1;
+  }
+
+  for(i = 0; i < 2; i++){
+    g_test_seam_err_ctr_malloc = i;
+    test_crond_main(EXIT_FAILURE);
+    g_test_seam_err_ctr_malloc = -1;
+  }
+
+  g_test_seam_err_ctr_clock_gettime = 0;
+  test_crond_main(EXIT_FAILURE);
+  g_test_seam_err_ctr_clock_gettime = -1;
+
+  g_test_seam_err_ctr_localtime = 0;
+  test_crond_main(EXIT_FAILURE);
+  g_test_seam_err_ctr_localtime = -1;
 
   test_describe("fail to create lock file");
   g_test_seam_err_ctr_open = 0;
@@ -1065,10 +3071,21 @@ test_crond_all(void){
   g_test_seam_err_ctr_remove = -1;
   g_test_seam_err_ctr_localtime = -1;
 
-  test_describe("fail because the lock file still exists (from previous step)");
-  test_crond_main(EXIT_FAILURE);
+  test_describe("take over the stale lock file (from previous step)");
+  pid = test_crond_fork();
+  test_sleep_max_file();
+  path_lock_file = crond_get_path_lock_file(g_path_crontab);
+  assert(path_lock_file);
+  sprintf(pid_str, "%ld\n", (long)pid);
+  assert(test_file_contains(path_lock_file, pid_str));
 
-  test_crond_remove_lock_file();
+  test_describe("fail because another crond holds the lock");
+  test_crond_main(EXIT_FAILURE);
+  assert(test_file_contains(path_lock_file, pid_str));
+  assert(kill(pid, SIGTERM) == 0);
+  test_crond_wait(pid, EXIT_SUCCESS);
+  assert(test_file_exists(path_lock_file) == false);
+  free(path_lock_file);
 
   test_describe("failed to close lock file");
   g_test_seam_err_ctr_close = 0;
@@ -1090,6 +3107,11 @@ test_crond_all(void){
   test_crond_wait(pid, EXIT_SUCCESS);
   test_crond_remove_lock_file();
 
+  test_describe("sleep when the clock is on a whole second");
+  g_test_seam_clock_realtime_whole_sec = true;
+  test_crond_fork_main(EXIT_SUCCESS);
+  g_test_seam_clock_realtime_whole_sec = false;
+
   test_describe("stat call failed");
   g_test_seam_err_ctr_stat = 0;
   g_test_seam_err_force_errno = ENOMEM;
@@ -1101,8 +3123,26 @@ test_crond_all(void){
   test_crond_remove_crontab();
   test_crond_stdin_lines();
   test_crond_mailx();
+  test_crond_output_large();
   test_crond_special_strings();
   test_crond_field_ints();
+  test_crond_mem();
+  test_crond_metrics();
+  test_crond_trace();
+  test_crond_control();
+  test_crond_ephemeral();
+  test_crond_at();
+  test_crond_catchup();
+  test_crond_drain();
+  test_crond_kill();
+  test_crond_reexec();
+  test_crond_system();
+  test_crond_dropin();
+  test_crond_fairshare();
+  test_crond_zone();
+  test_crond_dst();
+  test_crond_warp();
+  test_crond_dry_run();
 }
 
 /**
@@ -1124,8 +3164,8 @@ test_cron_all(void){
  */
 int
 main(void){
-  const size_t MAX_ARGS = 4;
-  const size_t MAX_ARG_LENGTH = 255;
+  const size_t MAX_ARGS = 11;
+  const size_t MAX_ARG_LENGTH = 2048;
   size_t i;
 
   g_path_crontab = cron_get_path_crontab();
@@ -139,6 +139,8 @@ extern bool g_test_seam_err_req_fork_mailx;
 extern bool g_test_seam_err_in_fork_mailx;
 
 extern int g_test_seam_err_ctr_clock_gettime;
+extern time_t g_test_seam_clock_realtime_offset;
+extern bool g_test_seam_clock_realtime_whole_sec;
 extern int g_test_seam_err_ctr_close;
 extern int g_test_seam_err_ctr_dup2;
 extern int g_test_seam_err_ctr_execle;